@@ -0,0 +1,304 @@
+// ApClientRegistry.cpp
+// NEW_STATION / DEL_STATION / CONN_FAILED events into a client registry,
+// see ApClientRegistry.h.
+
+#include "ApClientRegistry.h"
+
+ApClientRegistry::ApClientRegistry() : Log("ApClientRegistry") { }
+
+ApClientRegistry::~ApClientRegistry()
+{
+	CloseConnection();
+}
+
+int64_t ApClientRegistry::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+bool ApClientRegistry::OpenConnection(const char *interfaceName)
+{
+	CloseConnection();
+	m_interfaceIndex = if_nametoindex(interfaceName);
+	if (m_interfaceIndex == 0)
+	{
+		LogErr(AT, string("OpenConnection(): no interface ") + interfaceName);
+		return false;
+	}
+	m_isOpen = true;
+	auto onEvent = [this](uint8_t cmd, struct nlattr **tb)
+	{
+		OnStationEvent(cmd, tb);
+	};
+	m_listener.AddGroup("mlme");
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_NEW_STATION, onEvent));
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_DEL_STATION, onEvent));
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_CONN_FAILED, onEvent));
+	if (!m_listener.Start())
+	{
+		LogErr(AT, "OpenConnection(): can't listen for station events.");
+		CloseConnection();
+		return false;
+	}
+	// Listening first, then the dump: a client joining in between is in
+	// one or the other (or both, Lookup() doesn't mind). A client with an
+	// event since the dump started is left as the event put it: the dump
+	// may be older news (e.g. a DEL_STATION right after it).
+	StationPoller poller;
+	vector<StationStats> stations;
+	int64_t dumpStartNs = NowNs();
+	if (!poller.OpenConnection(interfaceName) || !poller.Poll())
+	{
+		LogErr(AT, "OpenConnection(): can't read the current stations, events only.");
+	}
+	else
+	{
+		poller.GetStations(stations);
+	}
+	poller.CloseConnection();
+	int64_t now = NowNs();
+	lock_guard<mutex> lock(m_mutex);
+	for (const StationStats& st : stations)
+	{
+		auto it = m_clients.find(st.key);
+		if (it != m_clients.end() && max(it->second.joinedNs,
+			max(it->second.leftNs, it->second.failedNs)) >= dumpStartNs)
+		{
+			continue;
+		}
+		ApClient& client = Lookup(st.mac, now);
+		if (!client.associated)
+		{
+			client.associated = true;
+			// (Joined before we started: back-date it by its connected time.)
+			client.joinedNs = now - (int64_t)st.connectedSec * 1000000000LL;
+			client.joins++;
+			m_associated++;
+		}
+	}
+	stringstream s;
+	s << "OpenConnection(): " << interfaceName << ", " << m_associated << " clients associated";
+	LogInfo(s);
+	return true;
+}
+
+bool ApClientRegistry::CloseConnection()
+{
+	m_listener.Stop();
+	for (int id : m_handlerIds)
+	{
+		m_listener.RemoveHandler(id);
+	}
+	m_handlerIds.clear();
+	m_isOpen = false;
+	return true;
+}
+
+int ApClientRegistry::AddSubscriber(ApClientHandler handler)
+{
+	lock_guard<mutex> lock(m_subscribersMutex);
+	Subscriber s;
+	s.id = m_nextSubscriberId++;
+	s.handler = handler;
+	m_subscribers.push_back(s);
+	return s.id;
+}
+
+void ApClientRegistry::RemoveSubscriber(int id)
+{
+	lock_guard<mutex> lock(m_subscribersMutex);
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it)
+	{
+		if (it->id == id)
+		{
+			m_subscribers.erase(it);
+			return;
+		}
+	}
+}
+
+// Listener thread.
+void ApClientRegistry::OnStationEvent(uint8_t cmd, struct nlattr **tb)
+{
+	if (!tb[NL80211_ATTR_IFINDEX] || nla_get_u32(tb[NL80211_ATTR_IFINDEX]) != m_interfaceIndex
+		|| !tb[NL80211_ATTR_MAC] || nla_len(tb[NL80211_ATTR_MAC]) < 6)
+	{
+		return;
+	}
+	const uint8_t *mac = (const uint8_t *)nla_data(tb[NL80211_ATTR_MAC]);
+	ApClientEvent event;
+	event.timeNs = NowNs();
+	{
+		lock_guard<mutex> lock(m_mutex);
+		ApClient& client = Lookup(mac, event.timeNs);
+		switch (cmd)
+		{
+			case NL80211_CMD_NEW_STATION:
+				event.change = ApClientChange::Joined;
+				if (!client.associated)
+				{
+					client.associated = true;
+					m_associated++;
+				}
+				client.joinedNs = event.timeNs;
+				client.joins++;
+				break;
+			case NL80211_CMD_DEL_STATION:
+				event.change = ApClientChange::Left;
+				if (client.associated)
+				{
+					client.associated = false;
+					m_associated--;
+				}
+				client.leftNs = event.timeNs;
+				break;
+			case NL80211_CMD_CONN_FAILED:
+				event.change = ApClientChange::ConnectFailed;
+				client.failedNs = event.timeNs;
+				client.failures++;
+				client.lastFailReason = tb[NL80211_ATTR_CONN_FAILED_REASON] ?
+					nla_get_u32(tb[NL80211_ATTR_CONN_FAILED_REASON]) : 0;
+				break;
+			default:
+				return;
+		}
+		event.client = client;
+		m_events++;
+		Trim(PackMac(mac));
+	}
+	Publish(event);
+}
+
+ApClient& ApClientRegistry::Lookup(const uint8_t *mac, int64_t nowNs)
+{
+	uint64_t key = PackMac(mac);
+	auto it = m_clients.find(key);
+	if (it != m_clients.end())
+	{
+		return it->second;
+	}
+	ApClient& client = m_clients[key];
+	memcpy(client.mac, mac, sizeof(client.mac));
+	client.firstSeenNs = nowNs;
+	return client;
+}
+
+// Over MaxClients: forget the client that was last heard from longest
+// ago: its latest join, leave or failure, whichever came last (a client
+// that never associated has no leftNs, only its failures). Associated
+// ones, and 'keep', are never dropped.
+void ApClientRegistry::Trim(uint64_t keep)
+{
+	auto lastActivity = [](const ApClient& c)
+	{
+		return max(c.joinedNs, max(c.leftNs, c.failedNs));
+	};
+	while (m_clients.size() > MaxClients)
+	{
+		auto oldest = m_clients.end();
+		for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
+		{
+			if (!it->second.associated && it->first != keep
+				&& (oldest == m_clients.end() || lastActivity(it->second) < lastActivity(oldest->second)))
+			{
+				oldest = it;
+			}
+		}
+		if (oldest == m_clients.end())
+		{
+			return;
+		}
+		m_clients.erase(oldest);
+	}
+}
+
+void ApClientRegistry::Publish(const ApClientEvent& event)
+{
+	lock_guard<mutex> lock(m_subscribersMutex);
+	for (const Subscriber& s : m_subscribers)
+	{
+		s.handler(event);
+	}
+}
+
+size_t ApClientRegistry::AssociatedCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_associated;
+}
+
+void ApClientRegistry::GetClients(vector<ApClient>& clients, bool associatedOnly)
+{
+	clients.clear();
+	lock_guard<mutex> lock(m_mutex);
+	for (const auto& c : m_clients)
+	{
+		if (c.second.associated || !associatedOnly)
+		{
+			clients.push_back(c.second);
+		}
+	}
+}
+
+bool ApClientRegistry::GetClient(const uint8_t *mac, ApClient& client)
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_clients.find(PackMac(mac));
+	if (it == m_clients.end())
+	{
+		return false;
+	}
+	client = it->second;
+	return true;
+}
+
+string ApClientRegistry::FailReasonString(uint32_t reason)
+{
+	switch (reason)
+	{
+		case NL80211_CONN_FAIL_MAX_CLIENTS:
+			return "max clients";
+		case NL80211_CONN_FAIL_BLOCKED_CLIENT:
+			return "blocked";
+		default:
+			return "reason " + to_string(reason);
+	}
+}
+
+string ApClientRegistry::Summary()
+{
+	vector<ApClient> clients;
+	GetClients(clients, false);
+	int64_t now = NowNs();
+	stringstream s;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		s << "AP clients: " << m_associated << " associated, " << clients.size()
+			<< " known, " << m_events << " events" << endl;
+	}
+	for (const ApClient& c : clients)
+	{
+		s << "  " << c.MacString() << ": ";
+		if (c.associated)
+		{
+			s << "associated " << (now - c.joinedNs) / 1000000000LL << " s";
+		}
+		else if (c.leftNs)
+		{
+			s << "left " << (now - c.leftNs) / 1000000000LL << " s ago";
+		}
+		else
+		{
+			s << "never associated";
+		}
+		s << ", " << c.joins << " join(s)";
+		if (c.failures)
+		{
+			s << ", " << c.failures << " failure(s), last: " << FailReasonString(c.lastFailReason);
+		}
+		s << endl;
+	}
+	return s.str();
+}
@@ -0,0 +1,122 @@
+// ApClientRegistry.h
+// Who is associated with the AP interface, event driven: the "mlme"
+// multicast group (Nl80211EventListener) carries NL80211_CMD_NEW_STATION
+// when a client joins, DEL_STATION when it leaves and CONN_FAILED when
+// the AP turned one away (max clients, ACL; only from drivers that do
+// the AP's association handling in firmware, mac80211 leaves that to
+// hostapd). No hostapd log parsing, no polling.
+// OpenConnection() seeds the registry with one GET_STATION dump
+// (StationPoller), so clients that joined before we started are in it.
+// Clients that left stay in the registry (Associated() false) with their
+// history, up to MaxClients; the ones heard from longest ago (joined,
+// left or failed) are dropped first.
+// Subscribers run on the listener thread: keep them short and don't
+// call AddSubscriber() / RemoveSubscriber() from inside one.
+
+#ifndef APCLIENTREGISTRY_H_
+#define APCLIENTREGISTRY_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+
+#include <stdint.h>
+#include <time.h>
+#include <net/if.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+#include "Nl80211EventListener.h"
+#include "StationPoller.h"
+#include "MacAddress.h"
+
+using namespace std;
+
+class ApClient
+{
+public:
+	uint8_t mac[6] = { 0, 0, 0, 0, 0, 0 };
+	bool associated = false;
+	// CLOCK_MONOTONIC, 0 = never:
+	int64_t firstSeenNs = 0;
+	int64_t joinedNs = 0;     // Latest NEW_STATION (or the seed dump)
+	int64_t leftNs = 0;       // Latest DEL_STATION
+	int64_t failedNs = 0;     // Latest CONN_FAILED
+	uint32_t joins = 0;
+	uint32_t failures = 0;
+	uint32_t lastFailReason = 0;  // enum nl80211_connect_failed_reason
+	string MacString() const
+	{
+		return MacToString(mac);
+	}
+};
+
+enum class ApClientChange
+{
+	Joined = 1,
+	Left,
+	ConnectFailed
+};
+
+class ApClientEvent
+{
+public:
+	ApClientChange change = ApClientChange::Joined;
+	int64_t timeNs = 0;
+	ApClient client;  // (State after the event)
+};
+
+typedef function<void(const ApClientEvent& event)> ApClientHandler;
+
+class ApClientRegistry : protected Log
+{
+public:
+	// Clients remembered, associated or not:
+	static const size_t MaxClients = 1024;
+	ApClientRegistry();
+	~ApClientRegistry();
+	bool OpenConnection(const char *interfaceName);
+	bool CloseConnection();
+	// Any time; returns an id for RemoveSubscriber():
+	int AddSubscriber(ApClientHandler handler);
+	void RemoveSubscriber(int id);
+	// Any thread:
+	size_t AssociatedCount();
+	void GetClients(vector<ApClient>& clients, bool associatedOnly);
+	bool GetClient(const uint8_t *mac, ApClient& client);
+	string Summary();
+	static int64_t NowNs();
+private:
+	void OnStationEvent(uint8_t cmd, struct nlattr **tb);
+	// (m_mutex held.)
+	ApClient& Lookup(const uint8_t *mac, int64_t nowNs);
+	// (Never drops 'keep': the client the current event is about.)
+	void Trim(uint64_t keep);
+	void Publish(const ApClientEvent& event);
+	static string FailReasonString(uint32_t reason);
+	bool m_isOpen = false;
+	uint32_t m_interfaceIndex = 0;
+	Nl80211EventListener m_listener;
+	vector<int> m_handlerIds;
+	mutex m_mutex;
+	unordered_map<uint64_t, ApClient> m_clients;  // PackMac() -> client
+	size_t m_associated = 0;
+	uint64_t m_events = 0;
+	class Subscriber
+	{
+	public:
+		int id;
+		ApClientHandler handler;
+	};
+	mutex m_subscribersMutex;
+	vector<Subscriber> m_subscribers;
+	int m_nextSubscriberId = 1;
+};
+
+#endif  // APCLIENTREGISTRY_H_
@@ -0,0 +1,581 @@
+// ChannelHopper.cpp
+// Runs a HopPlan on the monitor interface from its own thread,
+// dwell deadlines come from a CLOCK_MONOTONIC timerfd.
+
+#include "ChannelHopper.h"
+#include "ChannelSetterProbe.h"
+
+string HopStats::Summary() const
+{
+	stringstream s;
+	s << "Hops: " << hops << ", failed: " << failedHops << ", overruns: " << overruns
+		<< ", jitter (us) min/mean/max: " << jitterMinUs << "/" << JitterMeanUs()
+		<< "/" << jitterMaxUs << ", dwell error (us) min/mean/max: " << dwellErrorMinUs
+		<< "/" << DwellErrorMeanUs() << "/" << dwellErrorMaxUs
+		<< ", acked: " << acked << ", unmatched ACKs: " << unmatchedAcks
+		<< ", ACK latency (us) min/mean/max: " << ackLatencyMinUs << "/"
+		<< AckLatencyMeanUs() << "/" << ackLatencyMaxUs;
+	return s.str();
+}
+
+ChannelHopper::ChannelHopper() : Log("ChannelHopper")
+{
+	m_running = false;
+}
+
+ChannelHopper::~ChannelHopper()
+{
+	Stop();
+	Close();
+}
+
+bool ChannelHopper::Open(const char *interfaceName)
+{
+	if (m_isOpen)
+	{
+		return m_interfaceName == interfaceName;
+	}
+	m_interfaceName = interfaceName;
+	return Open();
+}
+
+bool ChannelHopper::Open()
+{
+	if (m_isOpen)
+	{
+		return true;
+	}
+	m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (m_timerFd < 0)
+	{
+		int myErr = errno;
+		string s("Open(): timerfd_create failed: ");
+		s += strerror(myErr);
+		LogErr(AT, s);
+		return false;
+	}
+	m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_wakeFd < 0)
+	{
+		int myErr = errno;
+		string s("Open(): eventfd failed: ");
+		s += strerror(myErr);
+		LogErr(AT, s);
+		close(m_timerFd);
+		m_timerFd = -1;
+		return false;
+	}
+	bool connected = m_interfaceName.empty() ? m_setter.OpenConnection()
+		: m_setter.OpenConnection(m_interfaceName.c_str());
+	if (!connected)
+	{
+		LogErr(AT, "Open(): ChannelSetter can't open the monitor interface.");
+		close(m_timerFd);
+		close(m_wakeFd);
+		m_timerFd = -1;
+		m_wakeFd = -1;
+		return false;
+	}
+	m_isOpen = true;
+	return true;
+}
+
+bool ChannelHopper::Close()
+{
+	if (!m_isOpen)
+	{
+		return true;
+	}
+	Stop();
+	m_external.reset();
+	m_backend = SetterBackend::Nl80211SetChannel;
+	m_setter.CloseConnection();
+	close(m_timerFd);
+	close(m_wakeFd);
+	m_timerFd = -1;
+	m_wakeFd = -1;
+	m_isOpen = false;
+	return true;
+}
+
+bool ChannelHopper::Start(const HopPlan& plan)
+{
+	HopPlan checked(plan);
+	string why;
+	if (!checked.Validate(why))
+	{
+		LogErr(AT, "Start(): hop plan rejected, " + why);
+		return false;
+	}
+	if (!m_isOpen && !Open())
+	{
+		return false;
+	}
+	if (m_running)
+	{
+		return UpdatePlan(checked);
+	}
+	// The hop thread can give up on its own (bad policy entry, timer or
+	// poll() failure): it's finished but still joinable, and assigning
+	// over a joinable std::thread is std::terminate().
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+	{
+		lock_guard<mutex> lock(m_planMutex);
+		m_pendingPlan = checked;
+		m_planChanged = true;
+	}
+	if (m_external)
+	{
+		m_ackMode = AckMode::WaitForAck;  // (synchronous backend)
+	}
+	m_setter.SetAckMode(m_ackMode);
+	// Drain any left-over wake up from a previous Stop():
+	uint64_t junk;
+	while (read(m_wakeFd, &junk, sizeof(junk)) > 0) { }
+	m_running = true;
+	m_thread = thread(&ChannelHopper::HopThread, this);
+	return true;
+}
+
+bool ChannelHopper::Stop()
+{
+	if (!m_running && !m_thread.joinable())
+	{
+		return true;
+	}
+	m_running = false;
+	uint64_t one = 1;
+	if (write(m_wakeFd, &one, sizeof(one)) < 0)
+	{
+		LogErr(AT, "Stop(): can't wake the hop thread, waiting for current dwell.");
+	}
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+	return true;
+}
+
+bool ChannelHopper::UpdatePlan(const HopPlan& plan)
+{
+	// Rejected here, on the caller's thread, never mid-hop:
+	HopPlan checked(plan);
+	string why;
+	if (!checked.Validate(why))
+	{
+		LogErr(AT, "UpdatePlan(): hop plan rejected, " + why);
+		return false;
+	}
+	lock_guard<mutex> lock(m_planMutex);
+	m_pendingPlan = checked;
+	m_planChanged = true;
+	return true;
+}
+
+bool ChannelHopper::IsRunning()
+{
+	return m_running;
+}
+
+void ChannelHopper::GetStats(HopStats& stats)
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	stats = m_stats;
+}
+
+void ChannelHopper::ResetStats()
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats = HopStats();
+}
+
+void ChannelHopper::SetAckMode(AckMode mode)
+{
+	m_ackMode = mode;
+}
+
+bool ChannelHopper::SetBackend(SetterBackend backend)
+{
+	if (m_running)
+	{
+		LogErr(AT, "SetBackend(): hopper running, ignored.");
+		return false;
+	}
+	if (!m_isOpen && !Open())
+	{
+		return false;
+	}
+	if (backend == SetterBackend::Wext)
+	{
+		unique_ptr<IChannelSetter> wext(ChannelSetterProbe::Create(backend));
+		bool opened = m_interfaceName.empty() ? wext->OpenConnection()
+			: wext->OpenConnection(m_interfaceName.c_str());
+		if (!opened)
+		{
+			LogErr(AT, "SetBackend(): can't open WEXT on the monitor interface.");
+			return false;
+		}
+		m_external = move(wext);
+		m_ackMode = AckMode::WaitForAck;
+	}
+	else
+	{
+		m_external.reset();
+		m_setter.SetChannelCommand(backend == SetterBackend::Nl80211SetWiphy ?
+			ChannelCommand::SetWiphy : ChannelCommand::SetChannel);
+	}
+	m_backend = backend;
+	return true;
+}
+
+SetterBackend ChannelHopper::GetBackend()
+{
+	return m_backend;
+}
+
+void ChannelHopper::SetDwellPolicy(IDwellPolicy *policy)
+{
+	if (m_running)
+	{
+		LogErr(AT, "SetDwellPolicy(): hopper running, ignored.");
+		return;
+	}
+	m_policy = policy;
+}
+
+void ChannelHopper::SetDwellEndCallback(DwellEndCallback callback)
+{
+	if (m_running)
+	{
+		LogErr(AT, "SetDwellEndCallback(): hopper running, ignored.");
+		return;
+	}
+	m_dwellEnd = callback;
+}
+
+void ChannelHopper::ReportActivity(const ChannelActivity& activity)
+{
+	lock_guard<mutex> lock(m_activityMutex);
+	m_activity.frames += activity.frames;
+	m_activity.bssCount = activity.bssCount;
+	m_activity.busyFraction = activity.busyFraction;
+}
+
+void ChannelHopper::GetFailedHops(vector<HopRecord>& failed)
+{
+	failed.clear();
+	lock_guard<mutex> lock(m_statsMutex);
+	for (size_t i = 0; i < HopLogSize; i++)
+	{
+		if (m_hopLog[i].hopNumber != 0 && m_hopLog[i].status == HopStatus::Failed)
+		{
+			failed.push_back(m_hopLog[i]);
+		}
+	}
+}
+
+uint64_t ChannelHopper::RecordHop(uint32_t channel, uint32_t seq, int64_t sentNs, bool sentOk)
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	m_hopNumber++;
+	HopRecord& r = m_hopLog[m_hopNumber % HopLogSize];
+	r.hopNumber = m_hopNumber;
+	r.seq = seq;
+	r.channel = channel;
+	r.sentNs = sentNs;
+	r.ackNs = 0;
+	r.error = 0;
+	m_stats.hops++;
+	if (!sentOk)
+	{
+		r.status = HopStatus::Failed;
+		m_stats.failedHops++;
+		return m_hopNumber;
+	}
+	switch (m_ackMode)
+	{
+		case AckMode::Pipelined:
+			r.status = HopStatus::Pending;
+			break;
+		case AckMode::WaitForAck:
+			r.status = HopStatus::Acked;
+			r.ackNs = NowNs();
+			m_stats.acked++;
+			break;
+		default:
+			r.status = HopStatus::Unverified;
+			break;
+	}
+	return m_hopNumber;
+}
+
+// ReconcileAcks(): the kernel's ACKs / errors for pipelined hops, matched
+// back to the hop log by sequence number. Runs on the hop thread when
+// the netlink socket is readable, never blocks.
+void ChannelHopper::ReconcileAcks()
+{
+	nl80211Ack acks[32];
+	size_t count;
+	while ((count = m_setter.ReadHopAcks(acks, 32)) > 0)
+	{
+		int64_t nowNs = NowNs();
+		lock_guard<mutex> lock(m_statsMutex);
+		for (size_t a = 0; a < count; a++)
+		{
+			HopRecord *r = nullptr;
+			// Newest first; the ACK is almost always for the latest hop:
+			for (size_t back = 0; back < HopLogSize && back < m_hopNumber; back++)
+			{
+				HopRecord& candidate = m_hopLog[(m_hopNumber - back) % HopLogSize];
+				if (candidate.seq == acks[a].seq && candidate.status == HopStatus::Pending)
+				{
+					r = &candidate;
+					break;
+				}
+			}
+			if (r == nullptr)
+			{
+				m_stats.unmatchedAcks++;
+				continue;
+			}
+			r->ackNs = nowNs;
+			m_timeline.Record(acks[a].error == 0 ? TimelineEventType::HopAcked
+				: TimelineEventType::HopFailed, nowNs, r->hopNumber, r->channel);
+			int64_t latencyUs = (nowNs - r->sentNs) / 1000;
+			if (acks[a].error == 0)
+			{
+				r->status = HopStatus::Acked;
+				if (m_stats.acked == 0)
+				{
+					m_stats.ackLatencyMinUs = m_stats.ackLatencyMaxUs = latencyUs;
+				}
+				m_stats.acked++;
+				m_stats.ackLatencyMinUs = min(m_stats.ackLatencyMinUs, latencyUs);
+				m_stats.ackLatencyMaxUs = max(m_stats.ackLatencyMaxUs, latencyUs);
+				m_stats.ackLatencySumUs += latencyUs;
+			}
+			else
+			{
+				r->status = HopStatus::Failed;
+				r->error = acks[a].error;
+				m_stats.failedHops++;
+				stringstream s;
+				s << "Hop #" << r->hopNumber << " to channel " << r->channel
+					<< " FAILED: " << strerror(r->error);
+				LogErr(AT, s);
+			}
+		}
+	}
+}
+
+int64_t ChannelHopper::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+bool ChannelHopper::ArmTimer(int64_t deadlineNs)
+{
+	struct itimerspec its;
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = deadlineNs / 1000000000LL;
+	its.it_value.tv_nsec = deadlineNs % 1000000000LL;
+	if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &its, nullptr) < 0)
+	{
+		int myErr = errno;
+		string s("ArmTimer(): timerfd_settime failed: ");
+		s += strerror(myErr);
+		LogErr(AT, s);
+		return false;
+	}
+	return true;
+}
+
+void ChannelHopper::RecordDwell(int64_t jitterUs, int64_t dwellErrorUs)
+{
+	lock_guard<mutex> lock(m_statsMutex);
+	if (m_stats.samples == 0)
+	{
+		m_stats.jitterMinUs = m_stats.jitterMaxUs = jitterUs;
+		m_stats.dwellErrorMinUs = m_stats.dwellErrorMaxUs = dwellErrorUs;
+	}
+	m_stats.jitterMinUs = min(m_stats.jitterMinUs, jitterUs);
+	m_stats.jitterMaxUs = max(m_stats.jitterMaxUs, jitterUs);
+	m_stats.jitterSumUs += jitterUs;
+	m_stats.dwellErrorMinUs = min(m_stats.dwellErrorMinUs, dwellErrorUs);
+	m_stats.dwellErrorMaxUs = max(m_stats.dwellErrorMaxUs, dwellErrorUs);
+	m_stats.dwellErrorSumUs += dwellErrorUs;
+	m_stats.samples++;
+}
+
+// HopThread(): set channel, arm the timer for (last deadline + dwell),
+// wait for it (or for Stop()), repeat.
+void ChannelHopper::HopThread()
+{
+	HopPlan plan;
+	size_t index = 0;
+	bool haveTemplates = false;
+	int64_t deadlineNs = NowNs();
+	struct pollfd fds[3];
+	fds[0].fd = m_timerFd;
+	fds[0].events = POLLIN;
+	fds[1].fd = m_wakeFd;
+	fds[1].events = POLLIN;
+	// Pipelined: ACKs / errors arrive on the setter's socket while we
+	// dwell (poll() ignores a negative fd).
+	fds[2].fd = (m_ackMode == AckMode::Pipelined) ? m_setter.GetSocketFd() : -1;
+	fds[2].events = POLLIN;
+
+	while (m_running)
+	{
+		{
+			lock_guard<mutex> lock(m_planMutex);
+			if (m_planChanged)
+			{
+				plan = m_pendingPlan;
+				m_planChanged = false;
+				index = 0;
+				// Pre-encode this plan's messages (the only allocation):
+				haveTemplates = !m_external && m_setter.LoadHopPlan(plan);
+				if (!haveTemplates && !m_external)
+				{
+					LogErr(AT, "HopThread(): LoadHopPlan() failed, building messages per hop.");
+				}
+				if (m_policy != nullptr)
+				{
+					m_policy->Reset(plan);
+				}
+			}
+		}
+		milliseconds dwell;
+		if (m_policy != nullptr)
+		{
+			index = m_policy->Next(dwell);
+			if (index >= plan.Size() || dwell.count() <= 0)
+			{
+				LogErr(AT, "HopThread(): dwell policy returned a bad entry, stopping.");
+				break;
+			}
+		}
+		const HopEntry& entry = plan.entries[index];
+		if (m_policy == nullptr)
+		{
+			dwell = entry.dwell;
+		}
+		uint32_t seq = 0;
+		int64_t sentNs = NowNs();
+		// (m_hopNumber only changes on this thread.)
+		m_timeline.Record(TimelineEventType::HopRequested, sentNs, m_hopNumber + 1,
+			entry.channel, entry.freq, entry.width, entry.centerFreq1);
+		// (The plan was validated, entry.freq is already filled in.)
+		bool ok = m_external ? m_external->SetChannel(entry)
+			: haveTemplates ? m_setter.HopTo(index, seq)
+			: m_setter.SetChannel(entry, seq);
+		int64_t landedNs = NowNs();
+		uint64_t hopNumber = RecordHop(entry.channel, seq, sentNs, ok);
+		if (!ok)
+		{
+			m_timeline.Record(TimelineEventType::HopFailed, landedNs, hopNumber, entry.channel);
+		}
+		else
+		{
+			if (m_ackMode == AckMode::WaitForAck)
+			{
+				m_timeline.Record(TimelineEventType::HopAcked, landedNs, hopNumber, entry.channel);
+			}
+			m_timeline.Record(TimelineEventType::DwellStart, landedNs, hopNumber,
+				entry.channel, entry.freq, entry.width, entry.centerFreq1);
+		}
+		{
+			// Whatever was reported before the hop belongs to the last channel:
+			lock_guard<mutex> lock(m_activityMutex);
+			m_activity = ChannelActivity();
+		}
+		int64_t dwellNs = (int64_t)duration_cast<nanoseconds>(dwell).count();
+		deadlineNs += dwellNs;
+		if (deadlineNs < landedNs)
+		{
+			// More than a whole dwell behind (SetChannel() stalled?);
+			// don't fire a burst of catch-up hops, start over from now.
+			deadlineNs = landedNs + dwellNs;
+			lock_guard<mutex> lock(m_statsMutex);
+			m_stats.overruns++;
+		}
+		if (!ArmTimer(deadlineNs))
+		{
+			m_running = false;
+			break;
+		}
+		// Wait for the dwell deadline, reconciling ACKs as they come in:
+		bool timerFired = false;
+		bool stop = false;
+		while (!timerFired && !stop)
+		{
+			int rv = poll(fds, 3, -1);
+			if (rv < 0)
+			{
+				stop = (errno != EINTR);
+				continue;
+			}
+			if ((fds[1].revents & POLLIN) || !m_running)
+			{
+				stop = true;
+				continue;
+			}
+			if (fds[2].revents & POLLIN)
+			{
+				ReconcileAcks();
+			}
+			timerFired = (fds[0].revents & POLLIN) != 0;
+		}
+		if (stop)
+		{
+			m_timeline.Record(TimelineEventType::DwellEnd, NowNs(), hopNumber,
+				entry.channel, entry.freq, entry.width, entry.centerFreq1);
+			break;
+		}
+		// (poll() said the deadline passed: a failed read still ends the
+		// dwell, else the same entry would be hopped again.)
+		uint64_t expirations;
+		ssize_t got;
+		do
+		{
+			got = read(m_timerFd, &expirations, sizeof(expirations));
+		} while (got < 0 && errno == EINTR);
+		if (got < 0)
+		{
+			int myErr = errno;
+			string s("HopThread(): timerfd read failed, ending the dwell anyway: ");
+			s += strerror(myErr);
+			LogErr(AT, s);
+		}
+		int64_t wokeNs = NowNs();
+		m_timeline.Record(TimelineEventType::DwellEnd, wokeNs, hopNumber,
+			entry.channel, entry.freq, entry.width, entry.centerFreq1);
+		RecordDwell((wokeNs - deadlineNs) / 1000,
+			(wokeNs - landedNs - dwellNs) / 1000);
+		if (ok && m_dwellEnd)
+		{
+			m_dwellEnd(entry, hopNumber, landedNs, wokeNs);
+		}
+		if (m_policy != nullptr)
+		{
+			ChannelActivity activity;
+			{
+				lock_guard<mutex> lock(m_activityMutex);
+				activity = m_activity;
+			}
+			m_policy->Observe(index, activity,
+				duration_cast<milliseconds>(nanoseconds(wokeNs - landedNs)));
+		}
+		else
+		{
+			index = (index + 1) % plan.Size();
+		}
+	}
+	m_running = false;
+}
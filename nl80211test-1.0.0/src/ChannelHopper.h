@@ -0,0 +1,170 @@
+// ChannelHopper.h
+// Owns the monitor (survey) interface's ChannelSetter and runs a
+// HopPlan on its own thread.
+// Each dwell ends at an ABSOLUTE deadline (timerfd, CLOCK_MONOTONIC,
+// TFD_TIMER_ABSTIME) = previous deadline + dwell, so scheduling jitter
+// does not accumulate the way sleep_for(dwell) does.
+
+#ifndef CHANNELHOPPER_H_
+#define CHANNELHOPPER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <memory>
+#include <functional>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+
+#include "Log.h"
+#include "HopPlan.h"
+#include "IDwellPolicy.h"
+#include "ChannelTimeline.h"
+#include "IChannelSetter.h"
+#include "ChannelSetterNl80211.h"
+
+using namespace std;
+using namespace chrono;
+
+// One hop, as sent and (in pipelined mode) as later ACKed or rejected.
+enum class HopStatus
+{
+	Pending = 1,  // Pipelined: sent, no ACK / error yet
+	Acked,
+	Failed,       // Send failed, or the kernel returned an error
+	Unverified    // AckMode::NoAck: we'll never know
+};
+
+class HopRecord
+{
+public:
+	uint64_t hopNumber = 0;
+	uint32_t seq = 0;
+	uint32_t channel = 0;
+	int64_t sentNs = 0;   // CLOCK_MONOTONIC
+	int64_t ackNs = 0;
+	HopStatus status = HopStatus::Pending;
+	int error = 0;        // errno from the kernel (Failed)
+};
+
+// All times in microseconds.
+// Jitter: how late the hop thread woke up after a dwell deadline.
+// Dwell error: achieved dwell (channel set -> next hop) minus planned dwell.
+class HopStats
+{
+public:
+	uint64_t hops = 0;
+	uint64_t failedHops = 0;
+	// Fell more than a whole dwell behind, schedule was re-anchored:
+	uint64_t overruns = 0;
+	int64_t jitterMinUs = 0;
+	int64_t jitterMaxUs = 0;
+	int64_t jitterSumUs = 0;
+	int64_t dwellErrorMinUs = 0;
+	int64_t dwellErrorMaxUs = 0;
+	int64_t dwellErrorSumUs = 0;
+	uint64_t samples = 0;
+	// Pipelined ACK reconciliation:
+	uint64_t acked = 0;
+	uint64_t unmatchedAcks = 0;  // (ACK for a hop already out of the hop log)
+	int64_t ackLatencyMinUs = 0;
+	int64_t ackLatencyMaxUs = 0;
+	int64_t ackLatencySumUs = 0;
+	int64_t JitterMeanUs() const { return samples ? jitterSumUs / (int64_t)samples : 0; }
+	int64_t AckLatencyMeanUs() const { return acked ? ackLatencySumUs / (int64_t)acked : 0; }
+	int64_t DwellErrorMeanUs() const { return samples ? dwellErrorSumUs / (int64_t)samples : 0; }
+	string Summary() const;
+};
+
+class ChannelHopper : protected Log
+{
+public:
+	ChannelHopper();
+	~ChannelHopper();
+	// Connects the ChannelSetter to the monitor interface, or (multiple
+	// capture radios) to 'interfaceName'.
+	bool Open();
+	bool Open(const char *interfaceName);
+	bool Close();
+	// Start(), Stop(), UpdatePlan() and GetStats() may be called from
+	// any thread. A new plan takes effect at the next hop.
+	bool Start(const HopPlan& plan);
+	bool Stop();
+	bool UpdatePlan(const HopPlan& plan);
+	bool IsRunning();
+	void GetStats(HopStats& stats);
+	void ResetStats();
+	// Set before Start(); default AckMode::Pipelined: hops never block
+	// on the kernel but failures are still caught and reported.
+	void SetAckMode(AckMode mode);
+	// Set after Open(), before Start() (see ChannelSetterProbe); default
+	// nl80211 SET_CHANNEL. Wext hops are synchronous ioctls: no templates,
+	// AckMode becomes WaitForAck.
+	bool SetBackend(SetterBackend backend);
+	SetterBackend GetBackend();
+	// Failed hops still in the hop log (the last HopLogSize hops):
+	void GetFailedHops(vector<HopRecord>& failed);
+	// Set before Start(): the policy picks each next entry and its dwell
+	// (not owned; nullptr = plan order and plan dwells, the default).
+	void SetDwellPolicy(IDwellPolicy *policy);
+	// Capture / survey side, any thread: what was seen on the current
+	// channel. Frames add up; BSS count and busy fraction are the latest.
+	// Handed to the policy when the dwell ends.
+	void ReportActivity(const ChannelActivity& activity);
+	// Set before Start(): called on the hop thread when a dwell on 'entry'
+	// ends (channel set at startNs, timer fired at endNs), before the next
+	// hop and before the policy sees the activity. The place to read
+	// per-channel counters (SurveyCollector) while still on the channel,
+	// and to ReportActivity() what they say. Keep it short: it comes out
+	// of the next channel's dwell. (Not called for failed hops.)
+	typedef function<void(const HopEntry& entry, uint64_t hopNumber,
+		int64_t startNs, int64_t endNs)> DwellEndCallback;
+	void SetDwellEndCallback(DwellEndCallback callback);
+	// Every hop / dwell as it happened, for tagging captured frames with
+	// the channel (lock-free, any thread; see ChannelTimeline.h):
+	const ChannelTimeline& GetTimeline() const { return m_timeline; }
+private:
+	void HopThread();
+	uint64_t RecordHop(uint32_t channel, uint32_t seq, int64_t sentNs, bool sentOk);
+	void ReconcileAcks();
+	bool ArmTimer(int64_t deadlineNs);
+	static int64_t NowNs();
+	void RecordDwell(int64_t jitterUs, int64_t dwellErrorUs);
+	ChannelSetterNl80211 m_setter;
+	// Non-nl80211 backend (nullptr: m_setter does the hops):
+	unique_ptr<IChannelSetter> m_external;
+	SetterBackend m_backend = SetterBackend::Nl80211SetChannel;
+	string m_interfaceName;  // (empty: InterfaceManager's monitor interface)
+	bool m_isOpen = false;
+	thread m_thread;
+	atomic<bool> m_running;
+	int m_timerFd = -1;
+	int m_wakeFd = -1;  // eventfd, Stop() wakes the hop thread
+	mutex m_planMutex;
+	HopPlan m_pendingPlan;
+	bool m_planChanged = false;
+	AckMode m_ackMode = AckMode::Pipelined;
+	mutex m_statsMutex;  // (also guards m_hopLog)
+	HopStats m_stats;
+	static const size_t HopLogSize = 256;
+	HopRecord m_hopLog[HopLogSize];
+	uint64_t m_hopNumber = 0;
+	IDwellPolicy *m_policy = nullptr;
+	DwellEndCallback m_dwellEnd;
+	mutex m_activityMutex;
+	ChannelActivity m_activity;
+	ChannelTimeline m_timeline;  // (written by the hop thread only)
+};
+
+#endif  // CHANNELHOPPER_H_
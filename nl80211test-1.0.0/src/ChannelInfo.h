@@ -0,0 +1,45 @@
+// ChannelInfo.h
+// An interface's current channel as reported by nl80211
+// (NL80211_CMD_GET_INTERFACE): frequency, width, center
+// frequencies and TX power. SIOCGIWFREQ (WEXT) always returns
+// EINVAL on our radios, this is the replacement.
+
+#ifndef CHANNELINFO_H_
+#define CHANNELINFO_H_
+
+#include <chrono>
+
+#include <stdint.h>
+
+using namespace std;
+using namespace chrono;
+
+class ChannelInfo
+{
+public:
+	bool valid;             // false: never read / interface has no channel
+	uint32_t freq;          // NL80211_ATTR_WIPHY_FREQ (MHz)
+	uint32_t width;         // NL80211_ATTR_CHANNEL_WIDTH (enum nl80211_chan_width)
+	uint32_t centerFreq1;   // NL80211_ATTR_CENTER_FREQ1 (MHz, 0 if none)
+	uint32_t centerFreq2;   // NL80211_ATTR_CENTER_FREQ2 (MHz, 0 if none)
+	bool txPowerKnown;
+	int32_t txPowerMbm;     // NL80211_ATTR_WIPHY_TX_POWER_LEVEL (mBm, 100 * dBm)
+	steady_clock::time_point readAt;
+	ChannelInfo()
+	{
+		Clear();
+	}
+	void Clear()
+	{
+		valid = false;
+		freq = 0;
+		width = 0;
+		centerFreq1 = 0;
+		centerFreq2 = 0;
+		txPowerKnown = false;
+		txPowerMbm = 0;
+		readAt = steady_clock::time_point();
+	}
+};
+
+#endif  // CHANNELINFO_H_
@@ -4,44 +4,110 @@
 
 #include "ChannelSetterNl80211.h"
 
-ChannelSetterNl80211::ChannelSetterNl80211() : Nl80211Base("ChannelSetterNl80211")
-{ }
+ChannelSetterNl80211::ChannelSetterNl80211() : Nl80211Base("ChannelSetterNl80211"),
+	m_readBack("ChannelSetterNl80211 read-back")
+{
+	ClearHopPlan();
+}
+
+ChannelSetterNl80211::ChannelSetterNl80211(ChannelCommand command) :
+	Nl80211Base("ChannelSetterNl80211"), m_readBack("ChannelSetterNl80211 read-back")
+{
+	ClearHopPlan();
+	m_command = command;
+}
+
+const char *ChannelSetterNl80211::Name()
+{
+	return (m_command == ChannelCommand::SetWiphy) ? "nl80211 SET_WIPHY" : "nl80211 SET_CHANNEL";
+}
 
 bool ChannelSetterNl80211::OpenConnection()
 {
 	InterfaceManagerNl80211 *im;
-	const char *interfaceName;
+	im = InterfaceManagerNl80211::GetInstance();
+	// Get Survey Interface Name from InterfaceManager (const char *):
+	// Currently this ALWAYS "mon0" but this may change if re-creating
+	// a troubled iface name does not succeed.
+	return OpenConnection(im->GetMonitorInterfaceName());
+}
+
+// (Benchmarks and tests name the interface directly.)
+bool ChannelSetterNl80211::OpenConnection(const char *interfaceName)
+{
 	if (!Open())
 	{
 		LogErr(AT, "Can't connect to NL80211.");
 		return false;
 	}
-	im = InterfaceManagerNl80211::GetInstance();
-	// Get Survey Interface Name from InterfaceManager (const char *):
-	// Currently this ALWAYS "mon0" but this may change if re-creating
-	// a troubled iface name does not succeed.
-	interfaceName = im->GetMonitorInterfaceName();
 cout << "Channel Setter using interface: " << interfaceName << endl;
-	im->GetInterfaceIndex(interfaceName, m_interfaceIndex);
+	// NLM_F_ACK only when the ack mode asks for it (else the ACKs we
+	// never read pile up and overrun the socket's receive buffer):
+	DisableAutoAck();
+	if (!GetInterfaceIndex(interfaceName, m_interfaceIndex))
+	{
+		Close();
+		return false;
+	}
 	return true;
 }
 
-uint32_t ChannelSetterNl80211::ChannelToFrequency(uint32_t channel)
+void ChannelSetterNl80211::SetAckMode(AckMode mode)
+{
+	m_ackMode = mode;
+}
+
+AckMode ChannelSetterNl80211::GetAckMode()
+{
+	return m_ackMode;
+}
+
+// (Call before LoadHopPlan(), templates are encoded with the command.)
+void ChannelSetterNl80211::SetChannelCommand(ChannelCommand command)
 {
-	if (channel < 14)
+	m_command = command;
+}
+
+ChannelCommand ChannelSetterNl80211::GetChannelCommand()
+{
+	return m_command;
+}
+
+uint32_t ChannelSetterNl80211::Nl80211Width(ChannelWidth width)
+{
+	switch (width)
 	{
-		return 2407 + channel * 5;
+		case ChannelWidth::HT20:
+			return NL80211_CHAN_WIDTH_20;
+		case ChannelWidth::HT40:
+			return NL80211_CHAN_WIDTH_40;
+		case ChannelWidth::VHT80:
+			return NL80211_CHAN_WIDTH_80;
+		case ChannelWidth::VHT160:
+			return NL80211_CHAN_WIDTH_160;
+		case ChannelWidth::VHT80P80:
+			return NL80211_CHAN_WIDTH_80P80;
+		default:
+			return NL80211_CHAN_WIDTH_20_NOHT;
 	}
-	if (channel == 14)
+}
+
+// ChannelToFrequency(): 0 if 'channel' isn't in ChannelTables.
+uint32_t ChannelSetterNl80211::ChannelToFrequency(uint32_t channel)
+{
+	uint32_t freq;
+	if (!ChannelTables::ChannelToFrequency(ChannelTables::LegacyBand(channel), channel, freq))
 	{
-		return 2484;
+		return 0;
 	}
-	return (channel + 1000) * 5;
+	return freq;
 }
 
-bool ChannelSetterNl80211::SetChannel(uint32_t channel)
+// BuildChannelMessage(): leaves the SET_CHANNEL (or SET_WIPHY) message in
+// m_msg, for SetChannel() to send or LoadHopPlan() to pre-encode.
+bool ChannelSetterNl80211::BuildChannelMessage(uint32_t freq, ChannelWidth width,
+	uint32_t centerFreq1, uint32_t centerFreq2)
 {
-	uint32_t freq = ChannelToFrequency(channel);
 	uint32_t htval = NL80211_CHAN_NO_HT;
 /***
 Shouldn't this use (newer):
@@ -58,23 +124,257 @@ Shouldn't this use (newer):
  *	However, for setting the channel, see %NL80211_CMD_SET_CHANNEL  <=== THIS
  *	instead, the support here is for backward compatibility only.
 See /usr/include/linux/nl80211.h
+Yes: ChannelCommand::SetChannel (the default) now does.
 ****/
-	if (!SetupMessage(0, NL80211_CMD_SET_WIPHY))
+	bool legacy = (m_command == ChannelCommand::SetWiphy && width == ChannelWidth::NoHT20);
+	uint8_t cmd = (m_command == ChannelCommand::SetWiphy) ? NL80211_CMD_SET_WIPHY : NL80211_CMD_SET_CHANNEL;
+	if (!SetupMessage(m_ackMode == AckMode::NoAck ? 0 : NLM_F_ACK, cmd))
 	{
 		return false;
 	}
 
-	if (!AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex)
-		||
-		!AddMessageParameterU32(NL80211_ATTR_WIPHY_FREQ, freq)
-		||
-		!AddMessageParameterU32(NL80211_ATTR_WIPHY_CHANNEL_TYPE, htval))
+	bool ok = AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex)
+		&& AddMessageParameterU32(NL80211_ATTR_WIPHY_FREQ, freq);
+	if (legacy)
+	{
+		ok = ok && AddMessageParameterU32(NL80211_ATTR_WIPHY_CHANNEL_TYPE, htval);
+	}
+	else
+	{
+		// The kernel wants CENTER_FREQ1 for 40 MHz and up; for 20 MHz it
+		// must equal WIPHY_FREQ, so always sending it is fine.
+		ok = ok && AddMessageParameterU32(NL80211_ATTR_CHANNEL_WIDTH, Nl80211Width(width))
+			&& AddMessageParameterU32(NL80211_ATTR_CENTER_FREQ1, centerFreq1);
+		if (width == ChannelWidth::VHT80P80)
+		{
+			ok = ok && AddMessageParameterU32(NL80211_ATTR_CENTER_FREQ2, centerFreq2);
+		}
+	}
+	if (!ok)
 	{
 		LogErr(AT, "SetChannel() aborted, AddParam() failed.");
+		FreeMessage();
 		return false;
 	}
+	return true;
+}
 
-	return SendAndFreeMessage(false);
+// SetChannel() / SetFrequency() build a new message; HopTo() sends the
+// loaded hop plan's pre-encoded template (no allocation).
+// AckMode::NoAck:      don't ask for an ACK (aircrack-ng style, errors lost).
+// AckMode::WaitForAck: block until the kernel ACKs (a full round trip).
+// AckMode::Pipelined:  ask for an ACK but don't wait; 'seq' identifies the
+//                      hop, ReadHopAcks() collects the result later.
+bool ChannelSetterNl80211::SetChannel(uint32_t channel)
+{
+	uint32_t seq;
+	return SetChannel(channel, seq);
+}
+
+bool ChannelSetterNl80211::SetChannel(const HopEntry& entry)
+{
+	uint32_t seq;
+	return SetChannel(entry, seq);
+}
+
+bool ChannelSetterNl80211::GetFrequency(uint32_t& freq)
+{
+	ChannelInfo info;
+	if (!ReadBackChannel(info) || !info.valid)
+	{
+		return false;
+	}
+	freq = info.freq;
+	return true;
+}
+
+bool ChannelSetterNl80211::SetChannel(uint32_t channel, uint32_t& seq)
+{
+	uint32_t freq = ChannelToFrequency(channel);
+	if (freq == 0)
+	{
+		stringstream s;
+		s << "SetChannel(" << channel << "): not a valid channel.";
+		LogErr(AT, s);
+		return false;
+	}
+	return SetFrequency(freq, seq);
+}
+
+bool ChannelSetterNl80211::SetFrequency(uint32_t freq, uint32_t& seq)
+{
+	if (!BuildChannelMessage(freq, ChannelWidth::NoHT20, freq, 0))
+	{
+		return false;
+	}
+	return SendBuiltMessage(freq, freq, seq);
+}
+
+bool ChannelSetterNl80211::SetChannel(const HopEntry& entry, uint32_t& seq)
+{
+	if (entry.freq == 0)
+	{
+		LogErr(AT, "SetChannel(): hop entry was not validated (HopPlan::Validate()).");
+		return false;
+	}
+	if (!BuildChannelMessage(entry.freq, entry.width, entry.centerFreq1, entry.centerFreq2))
+	{
+		return false;
+	}
+	return SendBuiltMessage(entry.freq, entry.centerFreq1, seq);
+}
+
+bool ChannelSetterNl80211::SendBuiltMessage(uint32_t freq, uint32_t centerFreq1, uint32_t& seq)
+{
+	if (!SendNoWait(seq))
+	{
+		return false;
+	}
+	if (m_ackMode == AckMode::WaitForAck && !WaitForAck(seq))
+	{
+		return false;
+	}
+	return VerifyHop(freq, centerFreq1);
+}
+
+bool ChannelSetterNl80211::HopTo(size_t entryIndex, uint32_t& seq)
+{
+	if (entryIndex >= m_templateForEntry.size())
+	{
+		LogErr(AT, "HopTo(): no such entry in the loaded hop plan.");
+		return false;
+	}
+	const HopTemplate& t = m_templates[m_templateForEntry[entryIndex]];
+	if (!SendRaw(&m_templateBuf[t.offset], t.length, m_ackMode != AckMode::NoAck, seq))
+	{
+		return false;
+	}
+	if (m_ackMode == AckMode::WaitForAck && !WaitForAck(seq))
+	{
+		return false;
+	}
+	return VerifyHop(t.freq, t.centerFreq1);
+}
+
+size_t ChannelSetterNl80211::ReadHopAcks(nl80211Ack *acks, size_t maxAcks)
+{
+	return ReadAcks(acks, maxAcks);
+}
+
+int ChannelSetterNl80211::GetSocketFd()
+{
+	return SocketFd();
+}
+
+bool ChannelSetterNl80211::VerifyHop(uint32_t freq, uint32_t centerFreq1)
+{
+	if (m_verifyEvery == 0 || (++m_hopCount % m_verifyEvery) != 0)
+	{
+		return true;
+	}
+	// Verification / sampling: did the hop actually land?
+	ChannelInfo info;
+	if (!ReadBackChannel(info))
+	{
+		return false;
+	}
+	// (Older drivers don't report CENTER_FREQ1, only check it if present.)
+	if (!info.valid || info.freq != freq
+		|| (info.centerFreq1 != 0 && info.centerFreq1 != centerFreq1))
+	{
+		stringstream s;
+		s << "VerifyHop(): asked for " << freq << " MHz (center " << centerFreq1
+			<< "), radio reports " << info.freq << " MHz (center " << info.centerFreq1 << ").";
+		LogErr(AT, s);
+		return false;
+	}
+	return true;
+}
+
+void ChannelSetterNl80211::SetVerifyMode(uint32_t sampleEvery)
+{
+	m_verifyEvery = sampleEvery;
+	m_hopCount = 0;
+}
+
+// ReadBackChannel(): GET_INTERFACE on the read-back connection, then
+// update the InterfaceManager's cached copy. Not on the hop connection:
+// receiving the reply there would consume (and skip) the ACKs of
+// pipelined hops still in flight, leaving them pending forever.
+bool ChannelSetterNl80211::ReadBackChannel(ChannelInfo& info)
+{
+	if (!m_readBackOpen)
+	{
+		if (!m_readBack.Open())
+		{
+			LogErr(AT, "ReadBackChannel(): can't connect to NL80211.");
+			return false;
+		}
+		m_readBackOpen = true;
+	}
+	if (!m_readBack.GetInterfaceChannel(m_interfaceIndex, info))
+	{
+		LogErr(AT, "ReadBackChannel(): GET_INTERFACE failed.");
+		return false;
+	}
+	InterfaceManagerNl80211::GetInstance()->CacheInterfaceChannel(m_interfaceIndex, info);
+	return true;
+}
+
+// LoadHopPlan(): validate the plan against ChannelTables, then pre-encode
+// one message per distinct channel (frequency + width), all in one buffer.
+// HopTo() then only patches the sequence number and does one sendto().
+bool ChannelSetterNl80211::LoadHopPlan(const HopPlan& plan)
+{
+	ClearHopPlan();
+	HopPlan checked(plan);
+	string why;
+	if (!checked.Validate(why))
+	{
+		LogErr(AT, "LoadHopPlan(): plan rejected, " + why);
+		return false;
+	}
+	for (const HopEntry& entry : checked.entries)
+	{
+		size_t found = m_templates.size();
+		for (size_t i = 0; i < m_templates.size(); i++)
+		{
+			const HopTemplate& t = m_templates[i];
+			if (t.freq == entry.freq && t.width == entry.width
+				&& t.centerFreq1 == entry.centerFreq1 && t.centerFreq2 == entry.centerFreq2)
+			{
+				// Already have it (channel appears more than once in plan)
+				found = i;
+				break;
+			}
+		}
+		if (found == m_templates.size())
+		{
+			HopTemplate t;
+			t.freq = entry.freq;
+			t.width = entry.width;
+			t.centerFreq1 = entry.centerFreq1;
+			t.centerFreq2 = entry.centerFreq2;
+			t.offset = m_templateBuf.size();
+			if (!BuildChannelMessage(t.freq, t.width, t.centerFreq1, t.centerFreq2)
+				|| !EncodeMessage(m_templateBuf, t.length, 0))
+			{
+				LogErr(AT, "LoadHopPlan(): can't encode channel template.");
+				ClearHopPlan();
+				return false;
+			}
+			m_templates.push_back(t);
+		}
+		m_templateForEntry.push_back((uint16_t)found);
+	}
+	return true;
+}
+
+void ChannelSetterNl80211::ClearHopPlan()
+{
+	m_templates.clear();
+	m_templateForEntry.clear();
+	m_templateBuf.clear();
 }
 
 // This is how aircrack sets channel:
@@ -176,8 +476,12 @@ nla_put_failure:
 
 bool ChannelSetterNl80211::CloseConnection()
 {
-cout << "TODO: Close nl80211 Connection!!" << endl;
-	return true;
+	if (m_readBackOpen)
+	{
+		m_readBack.Close();
+		m_readBackOpen = false;
+	}
+	return Close();
 }
 
 ChannelSetterNl80211::~ChannelSetterNl80211()
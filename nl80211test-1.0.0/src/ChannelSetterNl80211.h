@@ -8,12 +8,15 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <stdint.h>
 
 #include "Log.h"
 #include "Nl80211Base.h"
 #include "InterfaceManagerNl80211.h"
+#include "HopPlan.h"
+#include "IChannelSetter.h"
 
 using namespace std;
 
@@ -23,12 +26,68 @@ struct nl80211_state {
     struct genl_family *nl80211;
 };
 
-class ChannelSetterNl80211 : public Nl80211Base
+// How SetChannel() deals with the kernel's ACK (see SetChannel()):
+enum class AckMode
+{
+	NoAck = 1,
+	WaitForAck,
+	Pipelined
+};
+
+// Which nl80211 command sets the channel:
+// SetWiphy:   NL80211_CMD_SET_WIPHY, the backward compatible path. 20 MHz
+//             no-HT hops send only CHANNEL_TYPE, exactly as before.
+// SetChannel: NL80211_CMD_SET_CHANNEL, always with CHANNEL_WIDTH and
+//             CENTER_FREQ1 (and CENTER_FREQ2 for 80+80).
+// (Wider than 20 MHz always sends the width attributes, either way.)
+enum class ChannelCommand
+{
+	SetWiphy = 1,
+	SetChannel
+};
+
+class ChannelSetterNl80211 : public Nl80211Base, public IChannelSetter
 {
 public:
 	ChannelSetterNl80211();
+	ChannelSetterNl80211(ChannelCommand command);
+	// "nl80211 SET_CHANNEL" or "nl80211 SET_WIPHY":
+	const char *Name();
 	bool OpenConnection();
+	bool OpenConnection(const char *interfaceName);
+	void SetAckMode(AckMode mode);
+	AckMode GetAckMode();
+	void SetChannelCommand(ChannelCommand command);
+	ChannelCommand GetChannelCommand();
+	// Plain channel number (1-14: 2.4 GHz, else 5 GHz), checked against
+	// ChannelTables; an unknown channel fails without reaching the kernel.
 	bool SetChannel(uint32_t channel);
+	// 'seq' is the hop's netlink sequence number (matches ReadHopAcks()):
+	bool SetChannel(uint32_t channel, uint32_t& seq);
+	bool SetFrequency(uint32_t freq, uint32_t& seq);
+	// Any width; 'entry' must come from a HopPlan that passed Validate().
+	bool SetChannel(const HopEntry& entry, uint32_t& seq);
+	bool SetChannel(const HopEntry& entry);
+	// (ReadBackChannel()'s frequency.)
+	bool GetFrequency(uint32_t& freq);
+	// Hop to entry 'entryIndex' of the loaded hop plan (its template):
+	bool HopTo(size_t entryIndex, uint32_t& seq);
+	// Pipelined mode: non-blocking, returns # of ACKs / errors read.
+	// Poll GetSocketFd() for POLLIN to know when to call it.
+	size_t ReadHopAcks(nl80211Ack *acks, size_t maxAcks);
+	int GetSocketFd();
+	// Verification / sampling mode: read the channel back from nl80211
+	// after every 'sampleEvery'th SetChannel() and fail the SetChannel()
+	// if the radio is not on the requested frequency. 0 = off (default).
+	// The read-back is cached in InterfaceManager's interface list.
+	// It uses a second nl80211 socket of its own, so it never reads (and
+	// drops) the ACKs of pipelined hops waiting for ReadHopAcks().
+	void SetVerifyMode(uint32_t sampleEvery);
+	bool ReadBackChannel(ChannelInfo& info);
+	// Validate the plan and pre-encode the channel message for every
+	// entry (zero-allocation hops with HopTo()). False: plan rejected.
+	bool LoadHopPlan(const HopPlan& plan);
+	void ClearHopPlan();
 
 	// SetChannel2() is how aircrack sets channel:
 	bool OpenConnection2();
@@ -39,8 +98,34 @@ public:
 	~ChannelSetterNl80211();
 private:
 	uint32_t ChannelToFrequency(uint32_t channel);
+	static uint32_t Nl80211Width(ChannelWidth width);
+	bool BuildChannelMessage(uint32_t freq, ChannelWidth width,
+		uint32_t centerFreq1, uint32_t centerFreq2);
+	bool SendBuiltMessage(uint32_t freq, uint32_t centerFreq1, uint32_t& seq);
+	bool VerifyHop(uint32_t freq, uint32_t centerFreq1);
+	// One ready-to-send message per distinct channel (frequency + width),
+	// in m_templateBuf; m_templateForEntry maps plan entry -> m_templates:
+	struct HopTemplate
+	{
+		uint32_t freq;
+		ChannelWidth width;
+		uint32_t centerFreq1;
+		uint32_t centerFreq2;
+		size_t offset;
+		uint32_t length;
+	};
+	vector<HopTemplate> m_templates;
+	vector<uint16_t> m_templateForEntry;
+	vector<uint8_t> m_templateBuf;
 	uint32_t m_interfaceIndex;
+	// ReadBackChannel()'s connection (opened on first use):
+	Nl80211Base m_readBack;
+	bool m_readBackOpen = false;
 	struct nl80211_state m_state;
+	uint32_t m_verifyEvery = 0;
+	uint32_t m_hopCount = 0;
+	AckMode m_ackMode = AckMode::NoAck;
+	ChannelCommand m_command = ChannelCommand::SetChannel;
 };
 
 #endif  // CHANNELSETTERNL80211_H_
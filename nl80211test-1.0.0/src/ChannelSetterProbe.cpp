@@ -0,0 +1,159 @@
+// ChannelSetterProbe.cpp
+// Times each channel setter backend on a radio, see ChannelSetterProbe.h.
+
+#include "ChannelSetterProbe.h"
+
+string SetterProbeResult::Summary() const
+{
+	stringstream s;
+	s << ChannelSetterProbe::BackendName(backend) << ": ";
+	if (!opened)
+	{
+		s << "can't open";
+		return s.str();
+	}
+	s << (works ? "works" : "FAILS") << ", " << hops << " hops, failed: " << failed
+		<< ", wrong frequency: " << wrongFreq << ", latency (us) p50/p90/max: "
+		<< p50Us << "/" << p90Us << "/" << maxUs;
+	return s.str();
+}
+
+ChannelSetterProbe::ChannelSetterProbe() : Log("ChannelSetterProbe") { }
+
+IChannelSetter *ChannelSetterProbe::Create(SetterBackend backend)
+{
+	switch (backend)
+	{
+		case SetterBackend::Nl80211SetChannel:
+		case SetterBackend::Nl80211SetWiphy:
+		{
+			ChannelSetterNl80211 *setter = new ChannelSetterNl80211(
+				backend == SetterBackend::Nl80211SetWiphy ? ChannelCommand::SetWiphy
+				: ChannelCommand::SetChannel);
+			setter->SetAckMode(AckMode::WaitForAck);
+			return setter;
+		}
+		case SetterBackend::Wext:
+			return new ChannelSetterWext();
+	}
+	return nullptr;
+}
+
+const char *ChannelSetterProbe::BackendName(SetterBackend backend)
+{
+	switch (backend)
+	{
+		case SetterBackend::Nl80211SetChannel:
+			return "nl80211 SET_CHANNEL";
+		case SetterBackend::Nl80211SetWiphy:
+			return "nl80211 SET_WIPHY";
+		case SetterBackend::Wext:
+			return "WEXT SIOCSIWFREQ";
+	}
+	return "?";
+}
+
+int64_t ChannelSetterProbe::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+bool ChannelSetterProbe::Probe(const char *interfaceName, const HopPlan& plan, uint32_t rounds,
+	vector<SetterProbeResult>& results, SetterBackend& best)
+{
+	results.clear();
+	HopPlan checked;
+	for (const HopEntry& e : plan.entries)
+	{
+		if (e.width == ChannelWidth::NoHT20 || e.width == ChannelWidth::HT20)
+		{
+			checked.entries.push_back(e);
+		}
+	}
+	string why;
+	if (!checked.Validate(why))
+	{
+		LogErr(AT, "Probe(): no usable 20 MHz entries, " + why);
+		return false;
+	}
+	const SetterBackend backends[] = { SetterBackend::Nl80211SetChannel,
+		SetterBackend::Nl80211SetWiphy, SetterBackend::Wext };
+	// WEXT can't hop the plan's wider entries, don't let it win:
+	bool all20 = checked.Size() == plan.Size();
+	const SetterProbeResult *fastest = nullptr;
+	for (SetterBackend backend : backends)
+	{
+		if (backend == SetterBackend::Wext && !all20)
+		{
+			continue;
+		}
+		SetterProbeResult result;
+		result.backend = backend;
+		ProbeOne(interfaceName, checked, rounds, result);
+		results.push_back(result);
+	}
+	for (const SetterProbeResult& r : results)
+	{
+		if (r.works && (fastest == nullptr || r.p50Us < fastest->p50Us
+			|| (r.p50Us == fastest->p50Us && r.p90Us < fastest->p90Us)))
+		{
+			fastest = &r;
+		}
+	}
+	if (fastest == nullptr)
+	{
+		LogErr(AT, string("Probe(): no channel setter backend works on ") + interfaceName);
+		return false;
+	}
+	best = fastest->backend;
+	stringstream s;
+	s << "Probe(): " << interfaceName << " uses " << BackendName(best)
+		<< " (p50 " << fastest->p50Us << " us)";
+	LogInfo(s);
+	return true;
+}
+
+void ChannelSetterProbe::ProbeOne(const char *interfaceName, const HopPlan& plan, uint32_t rounds,
+	SetterProbeResult& result)
+{
+	unique_ptr<IChannelSetter> setter(Create(result.backend));
+	if (!setter || !setter->OpenConnection(interfaceName))
+	{
+		return;
+	}
+	result.opened = true;
+	vector<int64_t> latencyNs;
+	for (uint32_t round = 0; round < rounds; round++)
+	{
+		for (const HopEntry& entry : plan.entries)
+		{
+			int64_t startNs = NowNs();
+			bool ok = setter->SetChannel(entry);
+			int64_t doneNs = NowNs();
+			result.hops++;
+			if (!ok)
+			{
+				result.failed++;
+				continue;
+			}
+			latencyNs.push_back(doneNs - startNs);
+			// (Not timed: only whether the radio really went there.)
+			uint32_t freq = 0;
+			if (!setter->GetFrequency(freq) || freq != entry.freq)
+			{
+				result.wrongFreq++;
+			}
+		}
+	}
+	setter->CloseConnection();
+	if (!latencyNs.empty())
+	{
+		sort(latencyNs.begin(), latencyNs.end());
+		result.p50Us = latencyNs[latencyNs.size() / 2] / 1000;
+		result.p90Us = latencyNs[latencyNs.size() * 9 / 10] / 1000;
+		result.maxUs = latencyNs.back() / 1000;
+	}
+	result.works = result.hops > 0 && result.failed == 0 && result.wrongFreq == 0;
+}
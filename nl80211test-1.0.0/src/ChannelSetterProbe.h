@@ -0,0 +1,64 @@
+// ChannelSetterProbe.h
+// Startup probe: times every channel setter backend on a radio and picks
+// the fastest one that works (some drivers handle SET_WIPHY, SET_CHANNEL
+// and WEXT very differently). Each backend hops over the plan's 20 MHz
+// entries (all backends can do those), every hop synchronous and read
+// back: "works" = no failed hop and the radio always ended up on the
+// requested frequency. (WEXT is only tried for all-20 MHz plans.)
+
+#ifndef CHANNELSETTERPROBE_H_
+#define CHANNELSETTERPROBE_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <stdint.h>
+#include <time.h>
+
+#include "Log.h"
+#include "HopPlan.h"
+#include "IChannelSetter.h"
+#include "ChannelSetterNl80211.h"
+#include "ChannelSetterWext.h"
+
+using namespace std;
+
+class SetterProbeResult
+{
+public:
+	SetterBackend backend = SetterBackend::Nl80211SetChannel;
+	bool opened = false;
+	bool works = false;
+	uint32_t hops = 0;
+	uint32_t failed = 0;     // SetChannel() returned false
+	uint32_t wrongFreq = 0;  // Read back some other frequency
+	// Hop latency (SetChannel() call, synchronous), microseconds:
+	int64_t p50Us = 0;
+	int64_t p90Us = 0;
+	int64_t maxUs = 0;
+	string Summary() const;
+};
+
+class ChannelSetterProbe : protected Log
+{
+public:
+	ChannelSetterProbe();
+	// A new, closed setter for 'backend' (caller owns it). nl80211
+	// backends come set to AckMode::WaitForAck (synchronous SetChannel()).
+	static IChannelSetter *Create(SetterBackend backend);
+	static const char *BackendName(SetterBackend backend);
+	// Every backend on 'interfaceName', 'rounds' passes over the plan's
+	// 20 MHz entries. False if none works ('best' unchanged).
+	bool Probe(const char *interfaceName, const HopPlan& plan, uint32_t rounds,
+		vector<SetterProbeResult>& results, SetterBackend& best);
+private:
+	void ProbeOne(const char *interfaceName, const HopPlan& plan, uint32_t rounds,
+		SetterProbeResult& result);
+	static int64_t NowNs();
+};
+
+#endif  // CHANNELSETTERPROBE_H_
@@ -0,0 +1,144 @@
+// ChannelSetterWext.cpp
+// Set Channel using Wireless Extensions (SIOCSIWFREQ).
+
+#include "ChannelSetterWext.h"
+
+ChannelSetterWext::ChannelSetterWext() : Log("ChannelSetterWext")
+{
+	memset(m_interfaceName, 0, sizeof(m_interfaceName));
+}
+
+ChannelSetterWext::~ChannelSetterWext()
+{
+	CloseConnection();
+}
+
+bool ChannelSetterWext::OpenConnection()
+{
+	InterfaceManagerNl80211 *im = InterfaceManagerNl80211::GetInstance();
+	return OpenConnection(im->GetMonitorInterfaceName());
+}
+
+bool ChannelSetterWext::OpenConnection(const char *interfaceName)
+{
+	CloseConnection();
+	if (strlen(interfaceName) >= sizeof(m_interfaceName))
+	{
+		LogErr(AT, string("OpenConnection(): interface name too long: ") + interfaceName);
+		return false;
+	}
+	strncpy(m_interfaceName, interfaceName, sizeof(m_interfaceName) - 1);
+	m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (m_fd < 0)
+	{
+		int myErr = errno;
+		string s("OpenConnection(): Can't get socket: ");
+		s += strerror(myErr);
+		LogErr(AT, s);
+		return false;
+	}
+	// Not a wireless interface (or no WEXT support): fail now, not per hop.
+	uint32_t freq;
+	if (!GetFrequency(freq))
+	{
+		CloseConnection();
+		return false;
+	}
+	return true;
+}
+
+bool ChannelSetterWext::CloseConnection()
+{
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+	return true;
+}
+
+bool ChannelSetterWext::SetChannel(uint32_t channel)
+{
+	uint32_t freq;
+	if (!ChannelTables::ChannelToFrequency(ChannelTables::LegacyBand(channel), channel, freq))
+	{
+		stringstream s;
+		s << "SetChannel(" << channel << "): not a valid channel.";
+		LogErr(AT, s);
+		return false;
+	}
+	return SetFrequency(freq);
+}
+
+bool ChannelSetterWext::SetChannel(const HopEntry& entry)
+{
+	if (entry.freq == 0)
+	{
+		LogErr(AT, "SetChannel(): entry not validated.");
+		return false;
+	}
+	if (entry.width != ChannelWidth::NoHT20 && entry.width != ChannelWidth::HT20)
+	{
+		LogErr(AT, "SetChannel(): WEXT can only set 20 MHz channels.");
+		return false;
+	}
+	return SetFrequency(entry.freq);
+}
+
+// m * 10^e Hz: e = 6 gives m in MHz (cfg80211_wext_freq()).
+bool ChannelSetterWext::SetFrequency(uint32_t freq)
+{
+	if (m_fd < 0)
+	{
+		LogErr(AT, "SetFrequency(): not open.");
+		return false;
+	}
+	shx_iwreq wrq;
+	memset(&wrq, 0, sizeof(shx_iwreq));
+	strncpy(wrq.ifr_name, m_interfaceName, sizeof(wrq.ifr_name));
+	wrq.u.freq.m = (int32_t)freq;
+	wrq.u.freq.e = 6;
+	wrq.u.freq.flags = SHX_IW_FREQ_FIXED;
+	if (ioctl(m_fd, SHX_SIOCSIWFREQ, &wrq) < 0)
+	{
+		int myErr = errno;
+		stringstream s;
+		s << "SetFrequency(" << freq << "): Can't SIOCSIWFREQ: " << strerror(myErr);
+		LogErr(AT, s);
+		return false;
+	}
+	return true;
+}
+
+bool ChannelSetterWext::GetFrequency(uint32_t& freq)
+{
+	if (m_fd < 0)
+	{
+		LogErr(AT, "GetFrequency(): not open.");
+		return false;
+	}
+	shx_iwreq wrq;
+	memset(&wrq, 0, sizeof(shx_iwreq));
+	strncpy(wrq.ifr_name, m_interfaceName, sizeof(wrq.ifr_name));
+	if (ioctl(m_fd, SHX_SIOCGIWFREQ, &wrq) < 0)
+	{
+		int myErr = errno;
+		string s("GetFrequency(): Can't SIOCGIWFREQ: ");
+		s += strerror(myErr);
+		LogErr(AT, s);
+		return false;
+	}
+	// e == 0: a channel number; else m * 10^e Hz.
+	if (wrq.u.freq.e == 0)
+	{
+		uint32_t channel = (uint32_t)wrq.u.freq.m;
+		return ChannelTables::ChannelToFrequency(ChannelTables::LegacyBand(channel), channel, freq);
+	}
+	double hz = wrq.u.freq.m;
+	for (int16_t i = 0; i < wrq.u.freq.e; i++)
+	{
+		hz *= 10.0;
+	}
+	freq = (uint32_t)(hz / 1e6 + 0.5);
+	return freq != 0;
+}
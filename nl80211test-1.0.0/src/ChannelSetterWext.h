@@ -0,0 +1,48 @@
+// ChannelSetterWext.h
+// Set Channel with the (deprecated) Wireless Extensions SIOCSIWFREQ
+// ioctl. cfg80211 still translates it (cfg80211_wext_siwfreq() ->
+// set monitor channel), and on some drivers it is the faster path.
+// 20 MHz only: WEXT has no channel width. One ioctl socket, opened once.
+
+#ifndef CHANNELSETTERWEXT_H_
+#define CHANNELSETTERWEXT_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <cstring>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+
+#include "Log.h"
+#include "IChannelSetter.h"
+#include "ChannelTables.h"
+#include "InterfaceManagerNl80211.h"
+// ShadowX's version of linux/wireless.h:
+#include "ShxWireless.h"
+
+using namespace std;
+
+class ChannelSetterWext : public IChannelSetter, protected Log
+{
+public:
+	ChannelSetterWext();
+	~ChannelSetterWext();
+	const char *Name() { return "WEXT SIOCSIWFREQ"; }
+	bool OpenConnection();
+	bool OpenConnection(const char *interfaceName);
+	bool SetChannel(uint32_t channel);
+	bool SetChannel(const HopEntry& entry);
+	bool GetFrequency(uint32_t& freq);
+	bool CloseConnection();
+private:
+	bool SetFrequency(uint32_t freq);
+	int m_fd = -1;
+	char m_interfaceName[SHX_IFNAMESIZE];
+};
+
+#endif  // CHANNELSETTERWEXT_H_
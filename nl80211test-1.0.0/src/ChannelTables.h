@@ -0,0 +1,252 @@
+// ChannelTables.h
+// (band, channel) <-> center frequency for 2.4, 5 and 6 GHz, and the
+// 40 / 80 / 160 MHz segment each 20 MHz channel belongs to.
+// Every entry of g_channelDefs is computed at compile time from the
+// channel number (see the static_asserts at the bottom); HopPlan uses
+// these to validate a plan once, at load time, so a hop itself is
+// just an index into the plan.
+
+#ifndef CHANNELTABLES_H_
+#define CHANNELTABLES_H_
+
+#include <stdint.h>
+
+enum class Band : uint8_t
+{
+	Band2GHz = 0,
+	Band5GHz,
+	Band6GHz
+};
+
+enum class ChannelWidth : uint8_t
+{
+	NoHT20 = 0,  // 20 MHz, legacy (what SetChannel() always used)
+	HT20,
+	HT40,
+	VHT80,
+	VHT160,
+	VHT80P80   // two 80 MHz segments, the second one given separately
+};
+
+// 20 MHz channel center frequency, MHz (no validity check):
+constexpr uint32_t ChannelCenterFreq(Band band, uint32_t ch)
+{
+	return band == Band::Band2GHz ? (ch == 14 ? 2484 : 2407 + 5 * ch)
+		: band == Band::Band5GHz ? 5000 + 5 * ch
+		: (ch == 2 ? 5935 : 5950 + 5 * ch);
+}
+
+// Segment centers, as CHANNEL numbers (0: channel can't use that width).
+// 2.4 GHz HT40: secondary above (HT40+) when possible, else below.
+// 5 GHz: 36-64 / 100-144 pair up in blocks of 8 (40), 16 (80) and 32
+// (160) from channel 36; 149-177 likewise from channel 149.
+// 6 GHz: fixed grid from channel 1: 40 = 3 + 8k, 80 = 7 + 16k, 160 = 15 + 32k.
+constexpr uint32_t Center40(Band band, uint32_t ch)
+{
+	return band == Band::Band2GHz
+			? (ch <= 9 ? ch + 2 : (ch <= 13 ? ch - 2 : 0))
+		: band == Band::Band5GHz
+			? ((ch >= 36 && ch <= 64) || (ch >= 100 && ch <= 144) ? ((ch - 36) / 8) * 8 + 38
+				: (ch >= 149 && ch <= 177) ? ((ch - 149) / 8) * 8 + 151 : 0)
+		: (ch != 2 && ch <= 229 ? ((ch - 1) / 8) * 8 + 3 : 0);
+}
+
+constexpr uint32_t Center80(Band band, uint32_t ch)
+{
+	return band == Band::Band2GHz ? 0
+		: band == Band::Band5GHz
+			? ((ch >= 36 && ch <= 64) || (ch >= 100 && ch <= 144) ? ((ch - 36) / 16) * 16 + 42
+				: (ch >= 149 && ch <= 177) ? ((ch - 149) / 16) * 16 + 155 : 0)
+		: (ch != 2 && ch <= 221 ? ((ch - 1) / 16) * 16 + 7 : 0);
+}
+
+constexpr uint32_t Center160(Band band, uint32_t ch)
+{
+	return band == Band::Band2GHz ? 0
+		: band == Band::Band5GHz
+			? ((ch >= 36 && ch <= 64) || (ch >= 100 && ch <= 128) ? ((ch - 36) / 32) * 32 + 50
+				: (ch >= 149 && ch <= 177) ? 163 : 0)
+		: (ch != 2 && ch <= 221 ? ((ch - 1) / 32) * 32 + 15 : 0);
+}
+
+class ChannelDef
+{
+public:
+	Band band;
+	uint8_t channel;
+	uint16_t freq;
+	uint8_t center40;
+	uint8_t center80;
+	uint8_t center160;
+	constexpr ChannelDef(Band b, uint8_t ch)
+		: band(b), channel(ch), freq((uint16_t)ChannelCenterFreq(b, ch)),
+		center40((uint8_t)Center40(b, ch)), center80((uint8_t)Center80(b, ch)),
+		center160((uint8_t)Center160(b, ch)) { }
+};
+
+#define CH2(c) ChannelDef(Band::Band2GHz, c)
+#define CH5(c) ChannelDef(Band::Band5GHz, c)
+#define CH6(c) ChannelDef(Band::Band6GHz, c)
+#define CH6x8(c) CH6(c), CH6(c + 4)
+#define CH6x32(c) CH6x8(c), CH6x8(c + 8), CH6x8(c + 16), CH6x8(c + 24)
+
+static constexpr ChannelDef g_channelDefs[] =
+{
+	CH2(1), CH2(2), CH2(3), CH2(4), CH2(5), CH2(6), CH2(7),
+	CH2(8), CH2(9), CH2(10), CH2(11), CH2(12), CH2(13), CH2(14),
+
+	CH5(32), CH5(36), CH5(40), CH5(44), CH5(48), CH5(52), CH5(56),
+	CH5(60), CH5(64), CH5(68), CH5(96), CH5(100), CH5(104), CH5(108),
+	CH5(112), CH5(116), CH5(120), CH5(124), CH5(128), CH5(132), CH5(136),
+	CH5(140), CH5(144), CH5(149), CH5(153), CH5(157), CH5(161), CH5(165),
+	CH5(169), CH5(173), CH5(177),
+
+	CH6(2),
+	CH6x32(1), CH6x32(33), CH6x32(65), CH6x32(97),
+	CH6x32(129), CH6x32(161), CH6x32(193), CH6(225), CH6(229), CH6(233)
+};
+
+#undef CH2
+#undef CH5
+#undef CH6
+#undef CH6x8
+#undef CH6x32
+
+static constexpr uint32_t g_numChannelDefs = sizeof(g_channelDefs) / sizeof(g_channelDefs[0]);
+
+// Compile-time spot checks against IEEE 802.11 / nl80211 values:
+static_assert(ChannelCenterFreq(Band::Band2GHz, 1) == 2412, "2.4 GHz ch 1");
+static_assert(ChannelCenterFreq(Band::Band2GHz, 14) == 2484, "2.4 GHz ch 14");
+static_assert(ChannelCenterFreq(Band::Band5GHz, 36) == 5180, "5 GHz ch 36");
+static_assert(ChannelCenterFreq(Band::Band5GHz, 165) == 5825, "5 GHz ch 165");
+static_assert(ChannelCenterFreq(Band::Band6GHz, 1) == 5955, "6 GHz ch 1");
+static_assert(ChannelCenterFreq(Band::Band6GHz, 233) == 7115, "6 GHz ch 233");
+static_assert(Center80(Band::Band5GHz, 64) == 58 && Center80(Band::Band5GHz, 149) == 155, "VHT80");
+static_assert(Center160(Band::Band5GHz, 120) == 114 && Center160(Band::Band5GHz, 132) == 0, "VHT160");
+static_assert(Center40(Band::Band6GHz, 5) == 3 && Center80(Band::Band6GHz, 29) == 23, "6 GHz segments");
+static_assert(g_channelDefs[13].freq == 2484 && g_numChannelDefs == 14 + 31 + 60, "table layout");
+
+class ChannelTables
+{
+public:
+	// All return false for a channel / frequency not in the table.
+	static const ChannelDef *Find(Band band, uint32_t channel)
+	{
+		for (uint32_t i = 0; i < g_numChannelDefs; i++)
+		{
+			if (g_channelDefs[i].band == band && g_channelDefs[i].channel == channel)
+			{
+				return &g_channelDefs[i];
+			}
+		}
+		return nullptr;
+	}
+	static bool ChannelToFrequency(Band band, uint32_t channel, uint32_t& freq)
+	{
+		const ChannelDef *def = Find(band, channel);
+		if (def == nullptr)
+		{
+			return false;
+		}
+		freq = def->freq;
+		return true;
+	}
+	static bool FrequencyToChannel(uint32_t freq, Band& band, uint32_t& channel)
+	{
+		for (uint32_t i = 0; i < g_numChannelDefs; i++)
+		{
+			if (g_channelDefs[i].freq == freq)
+			{
+				band = g_channelDefs[i].band;
+				channel = g_channelDefs[i].channel;
+				return true;
+			}
+		}
+		return false;
+	}
+	// Center frequency of the whole (width) channel whose primary 20 MHz
+	// channel is 'channel' (NL80211_ATTR_CENTER_FREQ1):
+	static bool CenterFrequency(Band band, uint32_t channel, ChannelWidth width, uint32_t& centerFreq)
+	{
+		const ChannelDef *def = Find(band, channel);
+		if (def == nullptr)
+		{
+			return false;
+		}
+		uint32_t center;
+		switch (width)
+		{
+			case ChannelWidth::NoHT20:
+			case ChannelWidth::HT20:
+				center = def->channel;
+				break;
+			case ChannelWidth::HT40:
+				center = def->center40;
+				break;
+			case ChannelWidth::VHT80:
+			case ChannelWidth::VHT80P80:
+				center = def->center80;
+				break;
+			case ChannelWidth::VHT160:
+				center = def->center160;
+				break;
+			default:
+				center = 0;
+				break;
+		}
+		if (center == 0)
+		{
+			return false;
+		}
+		centerFreq = ChannelCenterFreq(band, center);
+		return true;
+	}
+	// 80+80: 'centerChannel' must be some 80 MHz segment's center in
+	// 'band' (NL80211_ATTR_CENTER_FREQ2); the kernel rejects a second
+	// segment adjacent to the first (that's just a 160 MHz channel).
+	static bool SecondSegmentFrequency(Band band, uint32_t primaryChannel, uint32_t centerChannel,
+		uint32_t& centerFreq2)
+	{
+		const ChannelDef *primary = Find(band, primaryChannel);
+		if (primary == nullptr || primary->center80 == 0)
+		{
+			return false;
+		}
+		uint32_t first = primary->center80;
+		if (centerChannel == first || centerChannel + 16 == first || first + 16 == centerChannel)
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < g_numChannelDefs; i++)
+		{
+			if (g_channelDefs[i].band == band && g_channelDefs[i].center80 == centerChannel)
+			{
+				centerFreq2 = ChannelCenterFreq(band, centerChannel);
+				return true;
+			}
+		}
+		return false;
+	}
+	static uint32_t WidthMhz(ChannelWidth width)
+	{
+		switch (width)
+		{
+			case ChannelWidth::HT40:
+				return 40;
+			case ChannelWidth::VHT80:
+				return 80;
+			case ChannelWidth::VHT160:
+			case ChannelWidth::VHT80P80:
+				return 160;
+			default:
+				return 20;
+		}
+	}
+	// Old style plain channel numbers: 1-14 are 2.4 GHz, the rest 5 GHz.
+	static Band LegacyBand(uint32_t channel)
+	{
+		return channel <= 14 ? Band::Band2GHz : Band::Band5GHz;
+	}
+};
+
+#endif  // CHANNELTABLES_H_
@@ -0,0 +1,208 @@
+// ChannelTimeline.cpp
+// Seqlock ring of hop events, see ChannelTimeline.h.
+
+#include "ChannelTimeline.h"
+
+// How far Lookup() walks back / forward from the event it found to put
+// a hop together (a hop is at most 5 events):
+static const uint64_t HopSpan = 8;
+
+ChannelTimeline::ChannelTimeline()
+{
+	for (size_t i = 0; i < TimelineSize; i++)
+	{
+		m_slots[i].seq.store(0, memory_order_relaxed);
+		m_slots[i].timeNs.store(0, memory_order_relaxed);
+		m_slots[i].hopNumber.store(0, memory_order_relaxed);
+		m_slots[i].freqs.store(0, memory_order_relaxed);
+		m_slots[i].channel.store(0, memory_order_relaxed);
+	}
+	m_head.store(0, memory_order_release);
+}
+
+void ChannelTimeline::Record(TimelineEventType type, int64_t timeNs, uint64_t hopNumber,
+	uint32_t channel, uint32_t freq, ChannelWidth width, uint32_t centerFreq1)
+{
+	uint64_t position = m_head.load(memory_order_relaxed);
+	Slot& s = m_slots[position & (TimelineSize - 1)];
+	// Odd: readers of this slot (old or new position) will retry / skip.
+	s.seq.store(2 * position + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	s.timeNs.store(timeNs, memory_order_relaxed);
+	s.hopNumber.store(hopNumber, memory_order_relaxed);
+	s.freqs.store((uint64_t)freq | ((uint64_t)centerFreq1 << 32), memory_order_relaxed);
+	s.channel.store((uint64_t)channel | ((uint64_t)type << 32) | ((uint64_t)width << 40),
+		memory_order_relaxed);
+	s.seq.store(2 * position + 2, memory_order_release);
+	m_head.store(position + 1, memory_order_release);
+}
+
+uint64_t ChannelTimeline::GetHead() const
+{
+	return m_head.load(memory_order_acquire);
+}
+
+// False: 'position' isn't in the slot (not written yet, being written or
+// already overwritten by a later lap).
+bool ChannelTimeline::ReadSlot(uint64_t position, TimelineEvent& event) const
+{
+	const Slot& s = m_slots[position & (TimelineSize - 1)];
+	uint64_t expect = 2 * position + 2;
+	if (s.seq.load(memory_order_acquire) != expect)
+	{
+		return false;
+	}
+	int64_t timeNs = s.timeNs.load(memory_order_relaxed);
+	uint64_t hopNumber = s.hopNumber.load(memory_order_relaxed);
+	uint64_t freqs = s.freqs.load(memory_order_relaxed);
+	uint64_t channel = s.channel.load(memory_order_relaxed);
+	atomic_thread_fence(memory_order_acquire);
+	if (s.seq.load(memory_order_relaxed) != expect)
+	{
+		return false;
+	}
+	event.timeNs = timeNs;
+	event.hopNumber = hopNumber;
+	event.freq = (uint32_t)freqs;
+	event.centerFreq1 = (uint32_t)(freqs >> 32);
+	event.channel = (uint32_t)channel;
+	event.type = (TimelineEventType)((channel >> 32) & 0xff);
+	event.width = (ChannelWidth)((channel >> 40) & 0xff);
+	return true;
+}
+
+// Timestamps only go up (one writer, one clock), so binary search.
+int64_t ChannelTimeline::FindAtOrBefore(int64_t timeNs, uint64_t oldest, uint64_t head) const
+{
+	int64_t found = -1;
+	uint64_t lo = oldest;
+	uint64_t hi = head;  // (exclusive)
+	TimelineEvent e;
+	while (lo < hi)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+		if (!ReadSlot(mid, e))
+		{
+			// Overwritten while we looked: everything up to here is gone.
+			lo = mid + 1;
+			found = -1;
+			continue;
+		}
+		if (e.timeNs <= timeNs)
+		{
+			found = (int64_t)mid;
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return found;
+}
+
+bool ChannelTimeline::Lookup(int64_t timeNs, ChannelAtTime& result) const
+{
+	result = ChannelAtTime();
+	uint64_t head = m_head.load(memory_order_acquire);
+	uint64_t oldest = (head > TimelineSize) ? head - TimelineSize : 0;
+	int64_t found = FindAtOrBefore(timeNs, oldest, head);
+	TimelineEvent e;
+	if (found < 0 || !ReadSlot((uint64_t)found, e))
+	{
+		return false;
+	}
+	uint64_t at = (uint64_t)found;
+	result.hop = e;
+	result.sinceNs = e.timeNs;
+	switch (e.type)
+	{
+		case TimelineEventType::HopRequested:
+			result.requestedNs = e.timeNs;
+			result.state = TunedState::Transition;
+			return true;
+		case TimelineEventType::DwellEnd:
+			result.state = TunedState::Transition;
+			return true;
+		case TimelineEventType::HopFailed:
+			result.state = TunedState::Failed;
+			return true;
+		default:
+			break;
+	}
+	// DwellStart, or HopAcked (WaitForAck: just before DwellStart;
+	// pipelined: during the dwell). Find the rest of this hop:
+	result.state = TunedState::OnChannel;
+	result.acked = (e.type == TimelineEventType::HopAcked);
+	TimelineEvent other;
+	for (uint64_t p = at; p > oldest && at - p < HopSpan; p--)
+	{
+		if (!ReadSlot(p - 1, other) || other.hopNumber != e.hopNumber)
+		{
+			break;
+		}
+		if (other.type == TimelineEventType::HopAcked)
+		{
+			result.acked = true;
+		}
+		else if (other.type == TimelineEventType::DwellStart ||
+			other.type == TimelineEventType::HopRequested)
+		{
+			// (HopRequested: ACKed before the dwell started, channel set.)
+			if (result.hop.type == TimelineEventType::HopAcked)
+			{
+				result.hop = other;
+				if (other.type == TimelineEventType::DwellStart)
+				{
+					result.sinceNs = other.timeNs;
+				}
+			}
+			if (other.type == TimelineEventType::HopRequested)
+			{
+				result.requestedNs = other.timeNs;
+				break;
+			}
+		}
+	}
+	// A pipelined ACK / error can come after 'timeNs', it still says
+	// whether the radio really was on that channel:
+	for (uint64_t p = at + 1; p < head && p - at <= HopSpan; p++)
+	{
+		if (!ReadSlot(p, other) || other.hopNumber != e.hopNumber)
+		{
+			break;
+		}
+		if (other.type == TimelineEventType::HopAcked)
+		{
+			result.acked = true;
+		}
+		else if (other.type == TimelineEventType::HopFailed)
+		{
+			result.state = TunedState::Failed;
+			result.acked = false;
+			break;
+		}
+	}
+	return true;
+}
+
+size_t ChannelTimeline::Read(uint64_t& position, TimelineEvent *out, size_t max) const
+{
+	uint64_t head = m_head.load(memory_order_acquire);
+	uint64_t oldest = (head > TimelineSize) ? head - TimelineSize : 0;
+	if (position < oldest)
+	{
+		position = oldest;
+	}
+	size_t count = 0;
+	while (position < head && count < max)
+	{
+		// (Lapped by the writer while copying: that one's lost, skip it.)
+		if (ReadSlot(position, out[count]))
+		{
+			count++;
+		}
+		position++;
+	}
+	return count;
+}
@@ -0,0 +1,103 @@
+// ChannelTimeline.h
+// When was the monitor radio actually on which channel?
+// ChannelHopper writes every hop event (requested, ACKed / failed, dwell
+// start / end, CLOCK_MONOTONIC ns) into a fixed ring; capture and
+// analytics threads ask "what was the radio tuned to at time T" for each
+// frame, to tag (or drop) frames captured mid-hop.
+// One writer (the hop thread), any number of readers. No locks and no
+// allocation on either side: every slot is its own seqlock (sequence odd
+// while being written), readers retry or give up, never block the writer.
+// Readers that fall a whole ring behind just lose the oldest events.
+
+#ifndef CHANNELTIMELINE_H_
+#define CHANNELTIMELINE_H_
+
+#include <atomic>
+
+#include <stdint.h>
+
+#include "ChannelTables.h"
+
+using namespace std;
+
+enum class TimelineEventType : uint8_t
+{
+	HopRequested = 1,  // Channel change sent (or about to be)
+	HopAcked,          // Kernel accepted it
+	HopFailed,         // Send failed / kernel rejected it
+	DwellStart,        // Channel set, listening
+	DwellEnd           // Leaving the channel (next hop or Stop())
+};
+
+class TimelineEvent
+{
+public:
+	int64_t timeNs = 0;        // CLOCK_MONOTONIC
+	uint64_t hopNumber = 0;    // Same number as the hopper's HopRecord
+	uint32_t channel = 0;
+	uint32_t freq = 0;         // MHz (0 in HopAcked / HopFailed)
+	uint32_t centerFreq1 = 0;
+	ChannelWidth width = ChannelWidth::NoHT20;
+	TimelineEventType type = TimelineEventType::HopRequested;
+};
+
+enum class TunedState : uint8_t
+{
+	Unknown = 0,  // Before the oldest event still in the ring
+	Transition,   // Between channels: frames can't be trusted
+	OnChannel,    // Dwelling on 'hop.channel'
+	Failed        // Hop failed: channel unknown
+};
+
+class ChannelAtTime
+{
+public:
+	TunedState state = TunedState::Unknown;
+	// The hop's DwellStart / HopRequested / DwellEnd (channel, width, ...):
+	TimelineEvent hop;
+	// When this state began:
+	int64_t sinceNs = 0;
+	// When this hop was requested (0: not in the ring / between hops):
+	int64_t requestedNs = 0;
+	// OnChannel: the kernel has ACKed the hop (so far, pipelined ACKs can
+	// arrive a little into the dwell; ask again later to be sure):
+	bool acked = false;
+};
+
+class ChannelTimeline
+{
+public:
+	ChannelTimeline();
+	// Writer (one thread only):
+	void Record(TimelineEventType type, int64_t timeNs, uint64_t hopNumber, uint32_t channel,
+		uint32_t freq = 0, ChannelWidth width = ChannelWidth::NoHT20, uint32_t centerFreq1 = 0);
+	// Readers (any thread):
+	// What the radio was doing at 'timeNs'; false (state Unknown) if
+	// that's older than the ring or before the first hop.
+	bool Lookup(int64_t timeNs, ChannelAtTime& result) const;
+	// Tail the ring: copies up to 'max' events from 'position' on, returns
+	// the count; 'position' is advanced past them (and past anything
+	// already overwritten). Start with position = 0.
+	size_t Read(uint64_t& position, TimelineEvent *out, size_t max) const;
+	// Events written so far (next position):
+	uint64_t GetHead() const;
+	static const size_t TimelineSize = 4096;  // Power of 2, ~1000 hops
+private:
+	class Slot
+	{
+	public:
+		// 2 * position + 2 once 'position' is written, odd while writing:
+		atomic<uint64_t> seq;
+		atomic<int64_t> timeNs;
+		atomic<uint64_t> hopNumber;
+		atomic<uint64_t> freqs;     // freq | centerFreq1 << 32
+		atomic<uint64_t> channel;   // channel | type << 32 | width << 40
+	};
+	bool ReadSlot(uint64_t position, TimelineEvent& event) const;
+	// Index of the newest event at or before timeNs, or -1:
+	int64_t FindAtOrBefore(int64_t timeNs, uint64_t oldest, uint64_t head) const;
+	Slot m_slots[TimelineSize];
+	atomic<uint64_t> m_head;
+};
+
+#endif  // CHANNELTIMELINE_H_
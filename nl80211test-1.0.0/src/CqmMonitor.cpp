@@ -0,0 +1,378 @@
+// CqmMonitor.cpp
+// NL80211_CMD_SET_CQM and NOTIFY_CQM events, see CqmMonitor.h.
+
+#include "CqmMonitor.h"
+
+string CqmEvent::Describe() const
+{
+	stringstream s;
+	switch (type)
+	{
+		case CqmEventType::RssiLow:
+			s << "RSSI low";
+			break;
+		case CqmEventType::RssiHigh:
+			s << "RSSI high";
+			break;
+		case CqmEventType::PacketLoss:
+			s << "packet loss, " << lostPackets << " packets";
+			break;
+		case CqmEventType::BeaconLoss:
+			s << "beacon loss";
+			break;
+		case CqmEventType::TxErrors:
+			s << "TX errors, " << txePackets << " packets failed (" << txeRatePercent
+				<< "%) over " << txeIntervals << " interval(s)";
+			break;
+	}
+	if (haveRssi)
+	{
+		s << ", " << rssiDbm << " dBm";
+	}
+	if (havePeer)
+	{
+		s << ", peer " << MacToString(peer);
+	}
+	return s.str();
+}
+
+CqmMonitor::CqmMonitor() : Nl80211Base("CqmMonitor")
+{
+	memset(m_counts, 0, sizeof(m_counts));
+}
+
+CqmMonitor::~CqmMonitor()
+{
+	CloseConnection();
+}
+
+void CqmMonitor::SetEventHandler(CqmEventHandler handler)
+{
+	if (m_isOpen)
+	{
+		LogErr(AT, "SetEventHandler(): already open, ignored.");
+		return;
+	}
+	m_handler = handler;
+}
+
+bool CqmMonitor::OpenConnection(const char *interfaceName)
+{
+	CloseConnection();
+	if (!Open())
+	{
+		LogErr(AT, "Can't connect to NL80211.");
+		return false;
+	}
+	if (!GetInterfaceIndex(interfaceName, m_interfaceIndex))
+	{
+		Close();
+		return false;
+	}
+	m_isOpen = true;
+	m_listener.AddGroup("mlme");
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_NOTIFY_CQM,
+		[this](uint8_t, struct nlattr **tb)
+		{
+			OnCqmEvent(tb);
+		}));
+	if (!m_listener.Start())
+	{
+		LogErr(AT, "OpenConnection(): can't listen for CQM events.");
+		CloseConnection();
+		return false;
+	}
+	return true;
+}
+
+bool CqmMonitor::CloseConnection()
+{
+	if (m_isOpen && (m_rssiOn || m_txeOn))
+	{
+		// (All zero: RSSI and TX error monitoring off, each that's on.)
+		SendConfig(CqmConfig());
+	}
+	m_rssiOn = m_txeOn = false;
+	m_listener.Stop();
+	for (int id : m_handlerIds)
+	{
+		m_listener.RemoveHandler(id);
+	}
+	m_handlerIds.clear();
+	if (m_isOpen)
+	{
+		Close();
+		m_isOpen = false;
+	}
+	return true;
+}
+
+bool CqmMonitor::Configure(const CqmConfig& config)
+{
+	if (!m_isOpen)
+	{
+		LogErr(AT, "Configure(): not open.");
+		return false;
+	}
+	for (size_t i = 1; i < config.rssiThresholdsDbm.size(); i++)
+	{
+		if (config.rssiThresholdsDbm[i] <= config.rssiThresholdsDbm[i - 1])
+		{
+			LogErr(AT, "Configure(): RSSI thresholds must be sorted low to high.");
+			return false;
+		}
+	}
+	if (!SendConfig(config))
+	{
+		return false;
+	}
+	stringstream s;
+	s << "Configure(): " << config.rssiThresholdsDbm.size() << " RSSI threshold(s), hysteresis "
+		<< config.rssiHysteresisDb << " dB, TX errors "
+		<< (config.txeIntervalSec ? "on" : "off");
+	LogInfo(s);
+	return true;
+}
+
+// The kernel takes either the RSSI settings or the TX error ones from a
+// SET_CQM (RSSI first, the rest of the nest is then ignored), so each
+// gets a message of its own. Only what's wanted, or on and to be turned
+// off, is sent: RSSI off would otherwise cost TX error only users their
+// beacon loss events, and drivers without TX status reporting reject the
+// TXE attributes, even zeroes.
+bool CqmMonitor::NeedRssi(const CqmConfig& config, bool rssiOn)
+{
+	return !config.rssiThresholdsDbm.empty() || rssiOn;
+}
+
+bool CqmMonitor::NeedTxe(const CqmConfig& config, bool txeOn)
+{
+	return config.txeIntervalSec != 0 || txeOn;
+}
+
+bool CqmMonitor::SendConfig(const CqmConfig& config)
+{
+	bool ok = true;
+	if (NeedRssi(config, m_rssiOn))
+	{
+		if (!BuildRssiMessage(config) || !SendAndFreeMessage(true))
+		{
+			stringstream s;
+			s << "SendConfig(): SET_CQM (RSSI) failed";
+			if (config.rssiThresholdsDbm.size() > 1)
+			{
+				s << " (" << config.rssiThresholdsDbm.size()
+					<< " RSSI thresholds need NL80211_EXT_FEATURE_CQM_RSSI_LIST)";
+			}
+			LogErr(AT, s);
+			ok = false;
+		}
+		else
+		{
+			m_rssiOn = !config.rssiThresholdsDbm.empty();
+		}
+	}
+	if (NeedTxe(config, m_txeOn))
+	{
+		if (!BuildTxeMessage(config) || !SendAndFreeMessage(true))
+		{
+			LogErr(AT, "SendConfig(): SET_CQM (TX errors) failed (driver without TX status reporting?)");
+			ok = false;
+		}
+		else
+		{
+			m_txeOn = config.txeIntervalSec != 0;
+		}
+	}
+	return ok;
+}
+
+bool CqmMonitor::BuildRssiMessage(const CqmConfig& config)
+{
+	FreeMessage();
+	// (RSSI_THOLD is one s32, or an array of them: same encoding.
+	// 0 turns RSSI monitoring off.)
+	vector<int32_t> thresholds = config.rssiThresholdsDbm;
+	if (thresholds.empty())
+	{
+		thresholds.push_back(0);
+	}
+	bool ok = SetupMessage(0, NL80211_CMD_SET_CQM)
+		&& AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex)
+		&& NestStart(NL80211_ATTR_CQM)
+		&& AddMessageParameterBinary((enum nl80211_attrs)NL80211_ATTR_CQM_RSSI_THOLD,
+			thresholds.data(), thresholds.size() * sizeof(int32_t))
+		&& AddMessageParameterU32((enum nl80211_attrs)NL80211_ATTR_CQM_RSSI_HYST,
+			config.rssiHysteresisDb)
+		&& NestEnd();
+	if (!ok)
+	{
+		FreeMessage();
+		LogErr(AT, "BuildRssiMessage(): can't build message.");
+	}
+	return ok;
+}
+
+// (All three 0: TX error monitoring off.)
+bool CqmMonitor::BuildTxeMessage(const CqmConfig& config)
+{
+	FreeMessage();
+	bool on = config.txeIntervalSec != 0;
+	bool ok = SetupMessage(0, NL80211_CMD_SET_CQM)
+		&& AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex)
+		&& NestStart(NL80211_ATTR_CQM)
+		&& AddMessageParameterU32((enum nl80211_attrs)NL80211_ATTR_CQM_TXE_RATE,
+			on ? config.txeRatePercent : 0)
+		&& AddMessageParameterU32((enum nl80211_attrs)NL80211_ATTR_CQM_TXE_PKTS,
+			on ? config.txePackets : 0)
+		&& AddMessageParameterU32((enum nl80211_attrs)NL80211_ATTR_CQM_TXE_INTVL,
+			config.txeIntervalSec)
+		&& NestEnd();
+	if (!ok)
+	{
+		FreeMessage();
+		LogErr(AT, "BuildTxeMessage(): can't build message.");
+	}
+	return ok;
+}
+
+bool CqmMonitor::EncodeConfig(const CqmConfig& config, bool rssiOn, bool txeOn,
+	vector<vector<uint8_t>>& messages)
+{
+	messages.clear();
+	uint32_t length;
+	if (NeedRssi(config, rssiOn))
+	{
+		messages.push_back(vector<uint8_t>());
+		if (!BuildRssiMessage(config) || !EncodeMessage(messages.back(), length, NLM_F_ACK))
+		{
+			return false;
+		}
+	}
+	if (NeedTxe(config, txeOn))
+	{
+		messages.push_back(vector<uint8_t>());
+		if (!BuildTxeMessage(config) || !EncodeMessage(messages.back(), length, NLM_F_ACK))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int64_t CqmMonitor::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Listener thread.
+void CqmMonitor::OnCqmEvent(struct nlattr **tb)
+{
+	struct nlattr *tb_cqm[NL80211_ATTR_CQM_MAX + 1];
+	if (!tb[NL80211_ATTR_IFINDEX] || nla_get_u32(tb[NL80211_ATTR_IFINDEX]) != m_interfaceIndex
+		|| !tb[NL80211_ATTR_CQM]
+		|| nla_parse_nested(tb_cqm, NL80211_ATTR_CQM_MAX, tb[NL80211_ATTR_CQM], NULL) != 0)
+	{
+		return;
+	}
+	CqmEvent event;
+	event.timeNs = NowNs();
+	if (tb_cqm[NL80211_ATTR_CQM_RSSI_THRESHOLD_EVENT])
+	{
+		uint32_t e = nla_get_u32(tb_cqm[NL80211_ATTR_CQM_RSSI_THRESHOLD_EVENT]);
+		if (e == NL80211_CQM_RSSI_THRESHOLD_EVENT_LOW)
+		{
+			event.type = CqmEventType::RssiLow;
+		}
+		else if (e == NL80211_CQM_RSSI_THRESHOLD_EVENT_HIGH)
+		{
+			event.type = CqmEventType::RssiHigh;
+		}
+		else
+		{
+			// (NL80211_CQM_RSSI_BEACON_LOSS_EVENT, old kernels)
+			event.type = CqmEventType::BeaconLoss;
+		}
+		if (tb_cqm[NL80211_ATTR_CQM_RSSI_LEVEL])
+		{
+			event.haveRssi = true;
+			event.rssiDbm = (int32_t)nla_get_u32(tb_cqm[NL80211_ATTR_CQM_RSSI_LEVEL]);
+		}
+	}
+	else if (tb_cqm[NL80211_ATTR_CQM_PKT_LOSS_EVENT])
+	{
+		event.type = CqmEventType::PacketLoss;
+		event.lostPackets = nla_get_u32(tb_cqm[NL80211_ATTR_CQM_PKT_LOSS_EVENT]);
+	}
+	else if (tb_cqm[NL80211_ATTR_CQM_BEACON_LOSS_EVENT])
+	{
+		event.type = CqmEventType::BeaconLoss;
+	}
+	else if (tb_cqm[NL80211_ATTR_CQM_TXE_PKTS])
+	{
+		event.type = CqmEventType::TxErrors;
+		event.txePackets = nla_get_u32(tb_cqm[NL80211_ATTR_CQM_TXE_PKTS]);
+		if (tb_cqm[NL80211_ATTR_CQM_TXE_RATE])
+		{
+			event.txeRatePercent = nla_get_u32(tb_cqm[NL80211_ATTR_CQM_TXE_RATE]);
+		}
+		if (tb_cqm[NL80211_ATTR_CQM_TXE_INTVL])
+		{
+			event.txeIntervals = nla_get_u32(tb_cqm[NL80211_ATTR_CQM_TXE_INTVL]);
+		}
+	}
+	else
+	{
+		return;
+	}
+	if (tb[NL80211_ATTR_MAC] && nla_len(tb[NL80211_ATTR_MAC]) >= 6)
+	{
+		event.havePeer = true;
+		memcpy(event.peer, nla_data(tb[NL80211_ATTR_MAC]), 6);
+	}
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_counts[(int)event.type - 1]++;
+		m_last = event;
+		m_haveLast = true;
+	}
+	if (m_handler)
+	{
+		m_handler(event);
+	}
+}
+
+uint64_t CqmMonitor::GetCount(CqmEventType type)
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_counts[(int)type - 1];
+}
+
+bool CqmMonitor::GetLast(CqmEvent& event)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!m_haveLast)
+	{
+		return false;
+	}
+	event = m_last;
+	return true;
+}
+
+string CqmMonitor::Summary()
+{
+	lock_guard<mutex> lock(m_mutex);
+	stringstream s;
+	s << "CQM events: " << m_counts[(int)CqmEventType::RssiLow - 1] << " RSSI low, "
+		<< m_counts[(int)CqmEventType::RssiHigh - 1] << " RSSI high, "
+		<< m_counts[(int)CqmEventType::PacketLoss - 1] << " packet loss, "
+		<< m_counts[(int)CqmEventType::BeaconLoss - 1] << " beacon loss, "
+		<< m_counts[(int)CqmEventType::TxErrors - 1] << " TX errors";
+	if (m_haveLast)
+	{
+		s << "; last: " << m_last.Describe();
+	}
+	return s.str();
+}
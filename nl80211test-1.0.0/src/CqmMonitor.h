@@ -0,0 +1,126 @@
+// CqmMonitor.h
+// Link quality of a managed (STA) interface, event driven: the kernel's
+// connection quality monitor (NL80211_CMD_SET_CQM) is told the RSSI
+// thresholds (with hysteresis) and, optionally, a TX error rate; crossing
+// one sends NL80211_CMD_NOTIFY_CQM on the "mlme" multicast group
+// (Nl80211EventListener), which goes to the event handler. No station
+// info polling.
+// Packet loss (N consecutive unacknowledged frames) is always reported
+// by mac80211. Beacon loss only comes as a CQM event from drivers that
+// filter beacons in firmware, and only while RSSI monitoring is on;
+// otherwise mac80211 handles it itself (probes the AP, then disconnects).
+// The handler runs on the listener thread: keep it short.
+// CQM settings belong to the interface (and are reset by the kernel on
+// disconnect): CloseConnection() turns them off again.
+
+#ifndef CQMMONITOR_H_
+#define CQMMONITOR_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <cstring>
+
+#include <stdint.h>
+#include <time.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+#include "Nl80211EventListener.h"
+#include "MacAddress.h"
+
+using namespace std;
+
+class CqmConfig
+{
+public:
+	// dBm, low to high. Empty: no RSSI monitoring. More than one needs
+	// NL80211_EXT_FEATURE_CQM_RSSI_LIST (otherwise EOPNOTSUPP).
+	vector<int32_t> rssiThresholdsDbm;
+	// An event, then no other until the RSSI moved this much (dB):
+	uint32_t rssiHysteresisDb = 2;
+	// TX error monitoring, 0 = off: an event when at least txeRatePercent
+	// of at least txePackets frames failed within txeIntervalSec.
+	uint32_t txeRatePercent = 0;
+	uint32_t txePackets = 0;
+	uint32_t txeIntervalSec = 0;
+};
+
+enum class CqmEventType
+{
+	RssiLow = 1,   // Fell below a threshold
+	RssiHigh,      // Rose above a threshold
+	PacketLoss,
+	BeaconLoss,
+	TxErrors
+};
+
+class CqmEvent
+{
+public:
+	CqmEventType type = CqmEventType::RssiLow;
+	int64_t timeNs = 0;        // CLOCK_MONOTONIC, when it arrived
+	bool haveRssi = false;     // RssiLow / RssiHigh (newer kernels)
+	int32_t rssiDbm = 0;
+	uint32_t lostPackets = 0;  // PacketLoss: consecutive frames unacknowledged
+	uint32_t txePackets = 0;   // TxErrors: packets failed ...
+	uint32_t txeRatePercent = 0;
+	uint32_t txeIntervals = 0; //   ... over this many TXE intervals
+	bool havePeer = false;     // (PacketLoss / TxErrors: the peer, our AP)
+	uint8_t peer[6] = { 0, 0, 0, 0, 0, 0 };
+	string Describe() const;
+};
+
+typedef function<void(const CqmEvent& event)> CqmEventHandler;
+
+class CqmMonitor : public Nl80211Base
+{
+public:
+	CqmMonitor();
+	~CqmMonitor();
+	// Before OpenConnection():
+	void SetEventHandler(CqmEventHandler handler);
+	// Starts listening ("mlme" group) for 'interfaceName's CQM events.
+	bool OpenConnection(const char *interfaceName);
+	// Turns monitoring off, stops listening.
+	bool CloseConnection();
+	// NL80211_CMD_SET_CQM; can be called again to move the thresholds.
+	bool Configure(const CqmConfig& config);
+	// Any thread: events so far (by type) and the latest one.
+	uint64_t GetCount(CqmEventType type);
+	bool GetLast(CqmEvent& event);
+	string Summary();
+	// The SET_CQM messages Configure() sends to get from RSSI / TX error
+	// monitoring being on (rssiOn, txeOn) to 'config', encoded, in
+	// sending order. Builds only, needs no connection (main's CQM message
+	// check looks at them).
+	bool EncodeConfig(const CqmConfig& config, bool rssiOn, bool txeOn,
+		vector<vector<uint8_t>>& messages);
+private:
+	static bool NeedRssi(const CqmConfig& config, bool rssiOn);
+	static bool NeedTxe(const CqmConfig& config, bool txeOn);
+	// One message per part, each ACKed on its own:
+	bool SendConfig(const CqmConfig& config);
+	bool BuildRssiMessage(const CqmConfig& config);
+	bool BuildTxeMessage(const CqmConfig& config);
+	void OnCqmEvent(struct nlattr **tb);
+	static int64_t NowNs();
+	static const int EventTypes = 5;
+	bool m_isOpen = false;
+	// What's on on the interface (CloseConnection() turns it off):
+	bool m_rssiOn = false;
+	bool m_txeOn = false;
+	uint32_t m_interfaceIndex = 0;
+	Nl80211EventListener m_listener;
+	vector<int> m_handlerIds;
+	CqmEventHandler m_handler;
+	mutex m_mutex;
+	uint64_t m_counts[EventTypes];
+	bool m_haveLast = false;
+	CqmEvent m_last;
+};
+
+#endif  // CQMMONITOR_H_
@@ -0,0 +1,160 @@
+// DwellPolicies.cpp
+// Uniform and activity-adaptive dwell scheduling.
+
+#include "DwellPolicies.h"
+
+void UniformDwellPolicy::Reset(const HopPlan& plan)
+{
+	m_dwells.clear();
+	for (const HopEntry& e : plan.entries)
+	{
+		m_dwells.push_back(e.dwell);
+	}
+	m_next = 0;
+}
+
+size_t UniformDwellPolicy::Next(milliseconds& dwell)
+{
+	if (m_dwells.empty())
+	{
+		dwell = milliseconds(0);
+		return 0;
+	}
+	size_t index = m_next;
+	m_next = (m_next + 1) % m_dwells.size();
+	dwell = m_dwells[index];
+	return index;
+}
+
+ActivityDwellPolicy::ActivityDwellPolicy() { }
+
+ActivityDwellPolicy::ActivityDwellPolicy(const ActivityPolicyConfig& config)
+{
+	m_config = config;
+}
+
+void ActivityDwellPolicy::Reset(const HopPlan& plan)
+{
+	m_channels.clear();
+	m_clock = milliseconds(0);
+	for (const HopEntry& e : plan.entries)
+	{
+		ChannelScore c;
+		c.planDwell = e.dwell;
+		m_channels.push_back(c);
+	}
+}
+
+double ActivityDwellPolicy::MeanScore()
+{
+	double sum = 0.0;
+	for (const ChannelScore& c : m_channels)
+	{
+		sum += c.score;
+	}
+	return m_channels.empty() ? 0.0 : sum / m_channels.size();
+}
+
+size_t ActivityDwellPolicy::Next(milliseconds& dwell)
+{
+	size_t n = m_channels.size();
+	if (n == 0)
+	{
+		dwell = milliseconds(0);
+		return 0;
+	}
+	// Nothing known about a channel yet: look at it (plan dwell) first.
+	for (size_t i = 0; i < n; i++)
+	{
+		if (!m_channels[i].visited)
+		{
+			m_channels[i].visited = true;
+			dwell = m_channels[i].planDwell;
+			return i;
+		}
+	}
+	double mean = MeanScore();
+	double sum = mean * n;
+	double floor = m_config.floorShare;
+	// Smooth weighted round robin: weights sum to 1, every pick costs 1.
+	size_t best = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		ChannelScore& c = m_channels[i];
+		double weight = floor / n;
+		weight += (sum > 0.0) ? (1.0 - floor) * c.score / sum : (1.0 - floor) / n;
+		c.credit += weight;
+		if (c.credit > m_channels[best].credit)
+		{
+			best = i;
+		}
+	}
+	// maxRevisit is a limit, not a trigger: any other channel that would
+	// pass it while we dwell on 'best' goes now instead (the one waiting
+	// longest first).
+	milliseconds d = DwellFor(best, mean);
+	size_t overdue = n;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (i != best && m_clock + d - m_channels[i].lastVisit > m_config.maxRevisit
+			&& (overdue == n || m_channels[i].lastVisit < m_channels[overdue].lastVisit))
+		{
+			overdue = i;
+		}
+	}
+	if (overdue < n)
+	{
+		// (No credit charged: a forced visit doesn't use up its share.)
+		best = overdue;
+		d = DwellFor(best, mean);
+	}
+	else
+	{
+		m_channels[best].credit -= 1.0;
+	}
+	// And no dwell so long that it makes another channel late (unless
+	// that would take it under minDwell):
+	for (size_t i = 0; i < n; i++)
+	{
+		milliseconds left = m_config.maxRevisit - (m_clock - m_channels[i].lastVisit);
+		if (i != best && d > left)
+		{
+			d = max(left, m_config.minDwell);
+		}
+	}
+	dwell = d;
+	return best;
+}
+
+milliseconds ActivityDwellPolicy::DwellFor(size_t index, double mean)
+{
+	const ChannelScore& c = m_channels[index];
+	double ratio = (mean > 0.0) ? c.score / mean : 1.0;
+	milliseconds d = duration_cast<milliseconds>(c.planDwell * (0.5 + 0.5 * ratio));
+	if (d < m_config.minDwell)
+	{
+		d = m_config.minDwell;
+	}
+	if (d > m_config.maxDwell)
+	{
+		d = m_config.maxDwell;
+	}
+	return d;
+}
+
+void ActivityDwellPolicy::Observe(size_t index, const ChannelActivity& activity, milliseconds dwelt)
+{
+	if (index >= m_channels.size() || dwelt.count() <= 0)
+	{
+		return;
+	}
+	ChannelScore& c = m_channels[index];
+	m_clock += dwelt;
+	c.lastVisit = m_clock;
+	double seconds = dwelt.count() / 1000.0;
+	double raw = m_config.frameWeight * (activity.frames / seconds)
+		+ m_config.bssWeight * activity.bssCount
+		+ m_config.busyWeight * activity.busyFraction;
+	c.score = c.scored ? (1.0 - m_config.smoothing) * c.score + m_config.smoothing * raw : raw;
+	c.scored = true;
+}
@@ -0,0 +1,90 @@
+// DwellPolicies.h
+// IDwellPolicy implementations.
+
+#ifndef DWELLPOLICIES_H_
+#define DWELLPOLICIES_H_
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "IDwellPolicy.h"
+#include "HopPlan.h"
+
+using namespace std;
+using namespace chrono;
+
+// The plan as written: every entry in order, for its own dwell.
+class UniformDwellPolicy : public IDwellPolicy
+{
+public:
+	const char *Name() { return "Uniform"; }
+	void Reset(const HopPlan& plan);
+	size_t Next(milliseconds& dwell);
+	void Observe(size_t, const ChannelActivity&, milliseconds) { }
+private:
+	vector<milliseconds> m_dwells;
+	size_t m_next = 0;
+};
+
+class ActivityPolicyConfig
+{
+public:
+	// Dwell = plan dwell scaled by how busy the channel is vs. the
+	// average channel, kept within [minDwell, maxDwell]:
+	milliseconds minDwell = milliseconds(50);
+	milliseconds maxDwell = milliseconds(750);
+	// Floor: share of all visits spread evenly over every channel,
+	// however quiet (0: busy channels only, 1: plain round robin).
+	// With N channels a quiet one is still visited at least once every
+	// N / floorShare hops.
+	double floorShare = 0.25;
+	// Hard floor: no channel goes longer than this unvisited (dwells
+	// are long on busy channels, so visits alone don't bound the time).
+	// Channels are visited early, before the next dwell would make them
+	// late; holds as long as the channels fit, N * minDwell < maxRevisit.
+	milliseconds maxRevisit = milliseconds(10000);
+	// Activity score = frameWeight * frames/s + bssWeight * BSSs
+	//                + busyWeight * busy fraction:
+	double frameWeight = 1.0;
+	double bssWeight = 20.0;
+	double busyWeight = 200.0;
+	// Weight of the newest observation in the (exponential) average:
+	double smoothing = 0.3;
+};
+
+// Activity-adaptive: each channel's share of visits (smooth weighted
+// round robin, deterministic) and its dwell follow its recent activity
+// score. Channels not yet observed are visited first, in plan order.
+class ActivityDwellPolicy : public IDwellPolicy
+{
+public:
+	ActivityDwellPolicy();
+	ActivityDwellPolicy(const ActivityPolicyConfig& config);
+	const char *Name() { return "Activity"; }
+	void Reset(const HopPlan& plan);
+	size_t Next(milliseconds& dwell);
+	void Observe(size_t index, const ChannelActivity& activity, milliseconds dwelt);
+private:
+	class ChannelScore
+	{
+	public:
+		milliseconds planDwell = milliseconds(0);
+		bool visited = false;
+		bool scored = false;
+		double score = 0.0;
+		double credit = 0.0;
+		milliseconds lastVisit = milliseconds(0);
+	};
+	double MeanScore();
+	// Dwell for a visit to 'index', from its score vs. the mean score:
+	milliseconds DwellFor(size_t index, double mean);
+	ActivityPolicyConfig m_config;
+	vector<ChannelScore> m_channels;
+	// Policy's own clock (sum of observed dwells), for maxRevisit:
+	milliseconds m_clock = milliseconds(0);
+};
+
+#endif  // DWELLPOLICIES_H_
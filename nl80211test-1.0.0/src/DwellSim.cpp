@@ -0,0 +1,249 @@
+// DwellSim.cpp
+// Deterministic, offline test bench for IDwellPolicy implementations:
+// simulated channels with known frame rates / BSSs / busy time (some
+// change half way through), no radio, no real time. Each channel's
+// frame arrivals are drawn up front (seeded generator) on one timeline,
+// and every policy is scored against that same trace: a frame is
+// captured if it arrives while its channel is being listened to, so the
+// policy can't shape the traffic, and results compare run to run.
+// Usage:  dwellsim [seed]
+// Reported per scenario and policy:
+//   captured %     frames captured / frames sent on all channels
+//   frames/s       frames captured per simulated second (coverage per
+//                  unit time)
+//   hops           channel changes (each loses 'settle' ms of listening)
+//   worst gap (s)  longest time any channel went unvisited
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "HopPlan.h"
+#include "IDwellPolicy.h"
+#include "DwellPolicies.h"
+#include "SimRandom.h"
+
+using namespace std;
+using namespace chrono;
+
+class SimChannel
+{
+public:
+	uint32_t channel;
+	double frameRate;      // frames/s
+	uint32_t bssCount;
+	double busyFraction;
+	// From changeAtS on, the channel looks like this instead:
+	double changeAtS;
+	double frameRateAfter;
+	uint32_t bssCountAfter;
+	double busyAfter;
+};
+
+class Scenario
+{
+public:
+	string name;
+	vector<SimChannel> channels;
+	double durationS = 600.0;
+	double settleMs = 5.0;   // listening lost after every channel change
+	milliseconds planDwell = milliseconds(250);
+};
+
+class SimResult
+{
+public:
+	uint64_t sent = 0;
+	uint64_t captured = 0;
+	uint64_t hops = 0;
+	double worstGapS = 0.0;
+};
+
+static SimChannel Quiet(uint32_t ch)
+{
+	SimChannel c = { ch, 2.0, 0, 0.01, 1e9, 2.0, 0, 0.01 };
+	return c;
+}
+
+static SimChannel Busy(uint32_t ch, double rate, uint32_t bss, double busy)
+{
+	SimChannel c = { ch, rate, bss, busy, 1e9, rate, bss, busy };
+	return c;
+}
+
+static void BuildScenarios(vector<Scenario>& scenarios)
+{
+	// Typical 2.4 GHz: traffic on 1 / 6 / 11, little elsewhere.
+	Scenario a;
+	a.name = "2.4 GHz, 1/6/11 busy";
+	for (uint32_t ch = 1; ch <= 13; ch++)
+	{
+		a.channels.push_back((ch == 1 || ch == 6 || ch == 11) ? Busy(ch, 400.0, 8, 0.4) : Quiet(ch));
+	}
+	scenarios.push_back(a);
+
+	// Everything equally busy: adaptive should not lose to uniform by much.
+	Scenario b;
+	b.name = "2.4 GHz, all equal";
+	for (uint32_t ch = 1; ch <= 13; ch++)
+	{
+		b.channels.push_back(Busy(ch, 150.0, 3, 0.2));
+	}
+	scenarios.push_back(b);
+
+	// A quiet channel wakes up half way, a busy one goes quiet: the floor
+	// has to find the new one.
+	Scenario c;
+	c.name = "2.4 GHz, activity moves";
+	for (uint32_t ch = 1; ch <= 13; ch++)
+	{
+		c.channels.push_back((ch == 1 || ch == 6) ? Busy(ch, 400.0, 8, 0.4) : Quiet(ch));
+	}
+	c.channels[5].changeAtS = 300.0;   // ch 6 goes quiet
+	c.channels[5].frameRateAfter = 2.0;
+	c.channels[5].bssCountAfter = 0;
+	c.channels[5].busyAfter = 0.01;
+	c.channels[8].changeAtS = 300.0;   // ch 9 wakes up
+	c.channels[8].frameRateAfter = 500.0;
+	c.channels[8].bssCountAfter = 10;
+	c.channels[8].busyAfter = 0.5;
+	scenarios.push_back(c);
+
+	// 5 GHz, 25 channels, three busy.
+	Scenario d;
+	d.name = "5 GHz, 3 of 25 busy";
+	const uint32_t five[] = { 36, 40, 44, 48, 52, 56, 60, 64, 100, 104, 108, 112, 116,
+		120, 124, 128, 132, 136, 140, 144, 149, 153, 157, 161, 165 };
+	for (uint32_t ch : five)
+	{
+		d.channels.push_back((ch == 36 || ch == 100 || ch == 149) ? Busy(ch, 300.0, 5, 0.3) : Quiet(ch));
+	}
+	scenarios.push_back(d);
+}
+
+// Frame arrival times (s), sorted, for each channel over the whole run:
+typedef vector<vector<double>> Trace;
+
+static void BuildTrace(const Scenario& sc, uint64_t seed, Trace& trace)
+{
+	trace.assign(sc.channels.size(), vector<double>());
+	for (size_t i = 0; i < sc.channels.size(); i++)
+	{
+		const SimChannel& c = sc.channels[i];
+		SimRandom rng(seed * 1000003ULL + i);
+		double before = min(c.changeAtS, sc.durationS);
+		// Poisson process, restarted at the change (memoryless):
+		double t = 0.0;
+		while (c.frameRate > 0.0 && (t += rng.Exponential(1.0 / c.frameRate)) < before)
+		{
+			trace[i].push_back(t);
+		}
+		t = before;
+		while (c.frameRateAfter > 0.0 && (t += rng.Exponential(1.0 / c.frameRateAfter)) < sc.durationS)
+		{
+			trace[i].push_back(t);
+		}
+	}
+}
+
+// Frames in [fromS, toS):
+static uint64_t Arrivals(const vector<double>& times, double fromS, double toS)
+{
+	if (toS <= fromS)
+	{
+		return 0;
+	}
+	return lower_bound(times.begin(), times.end(), toS) - lower_bound(times.begin(), times.end(), fromS);
+}
+
+static SimResult Run(const Scenario& sc, const Trace& trace, IDwellPolicy& policy)
+{
+	SimResult result;
+	HopPlan plan;
+	for (const SimChannel& c : sc.channels)
+	{
+		plan.Add(c.channel, sc.planDwell);
+	}
+	policy.Reset(plan);
+	vector<double> lastVisitS(sc.channels.size(), 0.0);
+	double now = 0.0;
+	while (now < sc.durationS)
+	{
+		milliseconds dwell;
+		size_t index = policy.Next(dwell);
+		if (index >= sc.channels.size() || dwell.count() <= 0)
+		{
+			cout << policy.Name() << ": bad Next(), stopping." << endl;
+			break;
+		}
+		double dwellS = dwell.count() / 1000.0;
+		if (now + dwellS > sc.durationS)
+		{
+			dwellS = sc.durationS - now;
+		}
+		const SimChannel& c = sc.channels[index];
+		bool after = now >= c.changeAtS;
+		ChannelActivity activity;
+		activity.frames = Arrivals(trace[index], now + sc.settleMs / 1000.0, now + dwellS);
+		activity.bssCount = after ? c.bssCountAfter : c.bssCount;
+		activity.busyFraction = after ? c.busyAfter : c.busyFraction;
+		double gap = now - lastVisitS[index];
+		if (gap > result.worstGapS)
+		{
+			result.worstGapS = gap;
+		}
+		now += dwellS;
+		lastVisitS[index] = now;
+		result.captured += activity.frames;
+		result.hops++;
+		policy.Observe(index, activity,
+			milliseconds((int64_t)(dwellS * 1000.0 + 0.5)));
+	}
+	for (size_t i = 0; i < sc.channels.size(); i++)
+	{
+		result.sent += trace[i].size();
+		double gap = sc.durationS - lastVisitS[i];
+		if (gap > result.worstGapS)
+		{
+			result.worstGapS = gap;
+		}
+	}
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	uint64_t seed = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 1;
+	vector<Scenario> scenarios;
+	BuildScenarios(scenarios);
+	cout << "dwellsim seed " << seed << endl;
+	for (const Scenario& sc : scenarios)
+	{
+		cout << endl << sc.name << " (" << sc.channels.size() << " channels, "
+			<< sc.durationS << " s, plan dwell " << sc.planDwell.count() << " ms, settle "
+			<< sc.settleMs << " ms)" << endl;
+		cout << "  " << left << setw(10) << "policy" << right << setw(12) << "captured %"
+			<< setw(12) << "frames/s" << setw(10) << "hops" << setw(15) << "worst gap (s)" << endl;
+		Trace trace;
+		BuildTrace(sc, seed, trace);
+		UniformDwellPolicy uniform;
+		ActivityDwellPolicy activity;
+		IDwellPolicy *policies[] = { &uniform, &activity };
+		for (IDwellPolicy *policy : policies)
+		{
+			SimResult r = Run(sc, trace, *policy);
+			cout << "  " << left << setw(10) << policy->Name() << right << fixed
+				<< setw(12) << setprecision(2) << (r.sent ? 100.0 * r.captured / r.sent : 0.0)
+				<< setw(12) << setprecision(1) << r.captured / sc.durationS
+				<< setw(10) << r.hops
+				<< setw(15) << setprecision(2) << r.worstGapS << defaultfloat << setprecision(6) << endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,104 @@
+// HopAllocBench.cpp
+// Microbenchmark: heap allocations and time per ChannelSetterNl80211
+// SetChannel(), building a new message every hop vs. HopTo() with the
+// pre-encoded per-channel templates from LoadHopPlan().
+// Usage (as root):  hopallocbench <monitor iface> [hops]
+// Allocations are counted by interposing malloc() / calloc() / realloc()
+// (glibc), so libnl's nlmsg_alloc() calls are counted too.
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#include <stdint.h>
+
+#include "ChannelSetterNl80211.h"
+#include "HopPlan.h"
+
+using namespace std;
+using namespace chrono;
+
+extern "C"
+{
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t nmemb, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+}
+
+static atomic<uint64_t> g_allocs(0);
+
+extern "C" void *malloc(size_t size)
+{
+	g_allocs++;
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t nmemb, size_t size)
+{
+	g_allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+	g_allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+static void RunHops(ChannelSetterNl80211& cs, const HopPlan& plan, int hops,
+	bool useTemplates, const char *what)
+{
+	int failed = 0;
+	uint64_t allocsBefore = g_allocs;
+	auto startTime = steady_clock::now();
+	for (int i = 0; i < hops; i++)
+	{
+		uint32_t seq;
+		size_t index = i % plan.Size();
+		bool ok = useTemplates ? cs.HopTo(index, seq)
+			: cs.SetChannel(plan.entries[index].channel, seq);
+		if (!ok)
+		{
+			failed++;
+		}
+	}
+	auto dur = steady_clock::now() - startTime;
+	uint64_t allocs = g_allocs - allocsBefore;
+	cout << what << ": " << hops << " hops, "
+		<< (double)allocs / hops << " allocations/hop, "
+		<< duration_cast<nanoseconds>(dur).count() / hops << " ns/hop, "
+		<< failed << " failed" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		cout << "Usage: " << argv[0] << " <monitor iface> [hops]" << endl;
+		return 1;
+	}
+	int hops = (argc > 2) ? atoi(argv[2]) : 10000;
+	if (hops <= 0)
+	{
+		hops = 10000;
+	}
+	HopPlan plan;
+	for (uint32_t chan = 1; chan <= 13; chan++)
+	{
+		plan.Add(chan, milliseconds(1));  // (dwell unused here)
+	}
+	ChannelSetterNl80211 cs;
+	if (!cs.OpenConnection(argv[1]))
+	{
+		return 1;
+	}
+	RunHops(cs, plan, hops, false, "Message per hop   ");
+	if (!cs.LoadHopPlan(plan))
+	{
+		return 1;
+	}
+	RunHops(cs, plan, hops, true, "Pre-encoded plan  ");
+	cs.CloseConnection();
+	return 0;
+}
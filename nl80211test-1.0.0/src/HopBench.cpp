@@ -0,0 +1,630 @@
+// HopBench.cpp
+// Non-interactive channel hop benchmark, for performance tracking:
+// thousands of hops per configuration (band(s) x width x ACK mode),
+// latency percentiles, failures and achieved hop rate, as CSV or JSON.
+// Runs against a real radio (nl80211) or SimChannelSetter (no hardware,
+// virtual clock, seeded: same numbers every run, for CI).
+// Usage:
+//   hopbench [--backend sim|nl80211] [--iface <monitor iface>] [--hops N]
+//            [--bands 2,5,6] [--widths 20,40,80,160] [--ack noack,wait,pipelined]
+//            [--window N] [--format csv|json] [--out <file>] [--seed N]
+// Defaults: sim, 5000 hops, bands 2,5, all four widths, all ACK modes,
+// window 4, CSV on stdout (--out: the nl80211 classes log on stdout).
+// Latency per hop:
+//   noack      time SetChannel() / HopTo() blocks (sending only)
+//   wait       send -> kernel's ACK (SetChannel() blocks for it)
+//   pipelined  send -> ACK read back while the next hops go out, at
+//              most --window hops outstanding (ChannelHopper has 1)
+// Hop rate: hops / (first send -> last ACK).
+// Counts (wait, pipelined): acked + failed + lost = hops; lost is no ACK
+// within a second, then it no longer holds a --window slot.
+// Plans: every primary channel of the width in the bands (nl80211:
+// only those the radio can monitor, if its phy can be read).
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <stdint.h>
+#include <poll.h>
+#include <time.h>
+
+#include "ChannelTables.h"
+#include "HopPlan.h"
+#include "ChannelSetterNl80211.h"
+#include "SimChannelSetter.h"
+#include "HopPlanBuilder.h"
+#include "InterfaceManagerNl80211.h"
+
+using namespace std;
+using namespace chrono;
+
+// What the benchmark needs from a setter, real or simulated.
+class BenchBackend
+{
+public:
+	virtual const char *Name() = 0;
+	virtual bool Prepare(const HopPlan& plan, AckMode mode) = 0;
+	virtual bool Hop(size_t index, uint32_t& seq) = 0;
+	virtual size_t ReadAcks(nl80211Ack *acks, size_t maxAcks) = 0;
+	virtual bool WaitForAck(int64_t timeoutNs) = 0;
+	virtual int64_t NowNs() = 0;
+	// Plan for one width: the radio's channels if known, else the tables'.
+	virtual bool BuildPlan(const vector<Band>& bands, ChannelWidth width, HopPlan& plan);
+	virtual ~BenchBackend() { }
+};
+
+// Every primary channel of 'width' in 'bands', per ChannelTables:
+bool BenchBackend::BuildPlan(const vector<Band>& bands, ChannelWidth width, HopPlan& plan)
+{
+	plan = HopPlan();
+	for (size_t i = 0; i < g_numChannelDefs; i++)
+	{
+		const ChannelDef& def = g_channelDefs[i];
+		if (find(bands.begin(), bands.end(), def.band) == bands.end())
+		{
+			continue;
+		}
+		HopPlan one;
+		one.Add(def.band, def.channel, width, milliseconds(1));  // (dwell unused)
+		string why;
+		if (one.Validate(why))
+		{
+			plan.entries.push_back(one.entries[0]);
+		}
+	}
+	return !plan.Empty();
+}
+
+class SimBackend : public BenchBackend
+{
+public:
+	SimBackend(uint64_t seed)
+	{
+		m_model.seed = seed;
+	}
+	const char *Name() { return "sim"; }
+	bool Prepare(const HopPlan& plan, AckMode mode)
+	{
+		// Fresh simulator (clock, queue, random numbers) per configuration:
+		m_setter.reset(new SimChannelSetter(m_model));
+		m_setter->OpenConnection();
+		m_setter->SetAckMode(mode);
+		return m_setter->LoadHopPlan(plan);
+	}
+	bool Hop(size_t index, uint32_t& seq) { return m_setter->HopTo(index, seq); }
+	size_t ReadAcks(nl80211Ack *acks, size_t maxAcks) { return m_setter->ReadHopAcks(acks, maxAcks); }
+	bool WaitForAck(int64_t timeoutNs) { return m_setter->WaitForAck(timeoutNs); }
+	int64_t NowNs() { return m_setter->NowNs(); }
+private:
+	SimSetterModel m_model;
+	unique_ptr<SimChannelSetter> m_setter;
+};
+
+class Nl80211Backend : public BenchBackend
+{
+public:
+	const char *Name() { return "nl80211"; }
+	bool Open(const char *interfaceName)
+	{
+		if (!m_setter.OpenConnection(interfaceName))
+		{
+			return false;
+		}
+		// (The interface list gives us the phy, for the radio's channels.
+		// Not Init(): that prepares the radios, i.e. takes them down.)
+		InterfaceManagerNl80211 *im = InterfaceManagerNl80211::GetInstance();
+		m_havePhy = im->GetInterfaceList() && im->GetInterfacePhy(interfaceName, m_phy);
+		return true;
+	}
+	bool Prepare(const HopPlan& plan, AckMode mode)
+	{
+		m_setter.SetAckMode(mode);
+		// (Drop ACKs left over from the previous configuration.)
+		nl80211Ack acks[32];
+		while (m_setter.ReadHopAcks(acks, 32) > 0) { }
+		return m_setter.LoadHopPlan(plan);
+	}
+	bool Hop(size_t index, uint32_t& seq) { return m_setter.HopTo(index, seq); }
+	size_t ReadAcks(nl80211Ack *acks, size_t maxAcks) { return m_setter.ReadHopAcks(acks, maxAcks); }
+	bool WaitForAck(int64_t timeoutNs)
+	{
+		struct pollfd pfd;
+		pfd.fd = m_setter.GetSocketFd();
+		pfd.events = POLLIN;
+		return poll(&pfd, 1, (int)(timeoutNs / 1000000)) > 0;
+	}
+	int64_t NowNs()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	}
+	bool BuildPlan(const vector<Band>& bands, ChannelWidth width, HopPlan& plan)
+	{
+		if (!m_havePhy)
+		{
+			return BenchBackend::BuildPlan(bands, width, plan);
+		}
+		HopPlanOptions options;
+		options.width = width;
+		options.dwell = milliseconds(1);
+		options.band2GHz = find(bands.begin(), bands.end(), Band::Band2GHz) != bands.end();
+		options.band5GHz = find(bands.begin(), bands.end(), Band::Band5GHz) != bands.end();
+		options.band6GHz = find(bands.begin(), bands.end(), Band::Band6GHz) != bands.end();
+		HopPlanBuilder builder;
+		return builder.BuildPlan(m_phy, options, plan);
+	}
+	~Nl80211Backend()
+	{
+		m_setter.CloseConnection();
+	}
+private:
+	ChannelSetterNl80211 m_setter;
+	bool m_havePhy = false;
+	uint32_t m_phy = 0;
+};
+
+class BenchResult
+{
+public:
+	string backend;
+	string bands;
+	string width;
+	string ackMode;
+	size_t channels = 0;
+	uint64_t hops = 0;
+	// Wait / Pipelined: acked + failed + lost == hops.
+	uint64_t acked = 0;      // Kernel said OK (NoAck: nothing to count)
+	uint64_t failed = 0;     // Send failed or kernel error
+	uint64_t lost = 0;       // Pipelined: no ACK within a second
+	int64_t p50Us = 0;
+	int64_t p90Us = 0;
+	int64_t p99Us = 0;
+	int64_t maxUs = 0;
+	double meanUs = 0.0;
+	double hopsPerSecond = 0.0;
+};
+
+static const char *AckModeName(AckMode mode)
+{
+	switch (mode)
+	{
+		case AckMode::NoAck:
+			return "noack";
+		case AckMode::WaitForAck:
+			return "wait";
+		default:
+			return "pipelined";
+	}
+}
+
+static const char *WidthName(ChannelWidth width)
+{
+	switch (width)
+	{
+		case ChannelWidth::HT40:
+			return "40";
+		case ChannelWidth::VHT80:
+			return "80";
+		case ChannelWidth::VHT160:
+			return "160";
+		case ChannelWidth::VHT80P80:
+			return "80+80";
+		default:
+			return "20";
+	}
+}
+
+static int64_t PercentileUs(vector<int64_t>& sortedNs, double p)
+{
+	if (sortedNs.empty())
+	{
+		return 0;
+	}
+	size_t rank = (size_t)(p / 100.0 * (sortedNs.size() - 1) + 0.5);
+	return sortedNs[min(rank, sortedNs.size() - 1)] / 1000;
+}
+
+static void RunConfig(BenchBackend& backend, const HopPlan& plan, AckMode mode,
+	uint64_t hops, size_t window, BenchResult& result)
+{
+	result.backend = backend.Name();
+	result.ackMode = AckModeName(mode);
+	result.channels = plan.Size();
+	result.hops = hops;
+	if (!backend.Prepare(plan, mode))
+	{
+		result.failed = hops;
+		return;
+	}
+	vector<int64_t> latencyNs;
+	latencyNs.reserve(hops);
+	// Pipelined: send time by seq, until its ACK comes back (or it is
+	// given up on as lost, see expire):
+	map<uint32_t, int64_t> pending;
+	const int64_t ackTimeoutNs = 1000000000LL;
+	nl80211Ack acks[64];
+	auto drain = [&]()
+	{
+		size_t count;
+		while ((count = backend.ReadAcks(acks, 64)) > 0)
+		{
+			int64_t nowNs = backend.NowNs();
+			for (size_t a = 0; a < count; a++)
+			{
+				auto it = pending.find(acks[a].seq);
+				if (it == pending.end())
+				{
+					continue;
+				}
+				if (acks[a].error == 0)
+				{
+					latencyNs.push_back(nowNs - it->second);
+					result.acked++;
+				}
+				else
+				{
+					result.failed++;
+				}
+				pending.erase(it);
+			}
+		}
+	};
+	// Hops still waiting after ackTimeoutNs are lost (an ACK that turns
+	// up later is ignored); returns # given up on:
+	auto expire = [&]()
+	{
+		int64_t nowNs = backend.NowNs();
+		size_t expired = 0;
+		for (auto it = pending.begin(); it != pending.end(); )
+		{
+			if (nowNs - it->second >= ackTimeoutNs)
+			{
+				it = pending.erase(it);
+				expired++;
+			}
+			else
+			{
+				++it;
+			}
+		}
+		result.lost += expired;
+		return expired;
+	};
+	int64_t startNs = backend.NowNs();
+	for (uint64_t i = 0; i < hops; i++)
+	{
+		uint32_t seq = 0;
+		int64_t sentNs = backend.NowNs();
+		bool ok = backend.Hop(i % plan.Size(), seq);
+		int64_t returnedNs = backend.NowNs();
+		if (!ok)
+		{
+			result.failed++;
+			continue;
+		}
+		if (mode == AckMode::Pipelined)
+		{
+			pending[seq] = sentNs;
+			drain();
+			// Window full: wait for the oldest to come back. A lost one
+			// would keep the window full (and every later hop waiting a
+			// whole timeout): give up on it instead.
+			while (pending.size() >= window)
+			{
+				if (backend.WaitForAck(ackTimeoutNs))
+				{
+					drain();
+				}
+				else if (expire() == 0)
+				{
+					break;
+				}
+			}
+		}
+		else
+		{
+			latencyNs.push_back(returnedNs - sentNs);
+			if (mode == AckMode::WaitForAck)
+			{
+				result.acked++;
+			}
+		}
+	}
+	while (!pending.empty() && backend.WaitForAck(ackTimeoutNs))
+	{
+		drain();
+	}
+	// Whatever never came back:
+	result.lost += pending.size();
+	pending.clear();
+	int64_t elapsedNs = backend.NowNs() - startNs;
+	sort(latencyNs.begin(), latencyNs.end());
+	result.p50Us = PercentileUs(latencyNs, 50);
+	result.p90Us = PercentileUs(latencyNs, 90);
+	result.p99Us = PercentileUs(latencyNs, 99);
+	result.maxUs = latencyNs.empty() ? 0 : latencyNs.back() / 1000;
+	int64_t sumNs = 0;
+	for (int64_t ns : latencyNs)
+	{
+		sumNs += ns;
+	}
+	result.meanUs = latencyNs.empty() ? 0.0 : sumNs / 1000.0 / latencyNs.size();
+	result.hopsPerSecond = elapsedNs > 0 ? hops * 1e9 / elapsedNs : 0.0;
+}
+
+static void PrintCsv(ostream& out, const vector<BenchResult>& results)
+{
+	out << "backend,bands,width,ack_mode,channels,hops,acked,failed,lost,"
+		"p50_us,p90_us,p99_us,max_us,mean_us,hops_per_s" << endl;
+	for (const BenchResult& r : results)
+	{
+		out << r.backend << "," << r.bands << "," << r.width << "," << r.ackMode << ","
+			<< r.channels << "," << r.hops << "," << r.acked << "," << r.failed << "," << r.lost << ","
+			<< r.p50Us << "," << r.p90Us << "," << r.p99Us << "," << r.maxUs << ","
+			<< fixed << setprecision(1) << r.meanUs << "," << r.hopsPerSecond
+			<< defaultfloat << endl;
+	}
+}
+
+static void PrintJson(ostream& out, const vector<BenchResult>& results)
+{
+	out << "[" << endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		out << "  {\"backend\": \"" << r.backend << "\", \"bands\": \"" << r.bands
+			<< "\", \"width\": \"" << r.width << "\", \"ack_mode\": \"" << r.ackMode
+			<< "\", \"channels\": " << r.channels << ", \"hops\": " << r.hops
+			<< ", \"acked\": " << r.acked << ", \"failed\": " << r.failed << ", \"lost\": " << r.lost
+			<< ", \"p50_us\": " << r.p50Us << ", \"p90_us\": " << r.p90Us
+			<< ", \"p99_us\": " << r.p99Us << ", \"max_us\": " << r.maxUs
+			<< fixed << setprecision(1) << ", \"mean_us\": " << r.meanUs
+			<< ", \"hops_per_s\": " << r.hopsPerSecond << defaultfloat << "}"
+			<< (i + 1 < results.size() ? "," : "") << endl;
+	}
+	out << "]" << endl;
+}
+
+static vector<string> Split(const string& list)
+{
+	vector<string> items;
+	stringstream ss(list);
+	string item;
+	while (getline(ss, item, ','))
+	{
+		if (!item.empty())
+		{
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+static void Usage(const char *name)
+{
+	cerr << "Usage: " << name << " [--backend sim|nl80211] [--iface <monitor iface>] [--hops N]"
+		<< endl << "    [--bands 2,5,6] [--widths 20,40,80,160] [--ack noack,wait,pipelined]"
+		<< endl << "    [--window N] [--format csv|json] [--out <file>] [--seed N]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	string backendName("sim");
+	string iface;
+	uint64_t hops = 5000;
+	string bandList("2,5");
+	string widthList("20,40,80,160");
+	string ackList("noack,wait,pipelined");
+	string format("csv");
+	string outFile;
+	size_t window = 4;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg(argv[i]);
+		if (i + 1 >= argc)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		string value(argv[++i]);
+		if (arg == "--backend")
+		{
+			backendName = value;
+		}
+		else if (arg == "--iface")
+		{
+			iface = value;
+		}
+		else if (arg == "--hops")
+		{
+			hops = strtoull(value.c_str(), nullptr, 0);
+		}
+		else if (arg == "--bands")
+		{
+			bandList = value;
+		}
+		else if (arg == "--widths")
+		{
+			widthList = value;
+		}
+		else if (arg == "--ack")
+		{
+			ackList = value;
+		}
+		else if (arg == "--format")
+		{
+			format = value;
+		}
+		else if (arg == "--window")
+		{
+			window = strtoul(value.c_str(), nullptr, 0);
+		}
+		else if (arg == "--out")
+		{
+			outFile = value;
+		}
+		else if (arg == "--seed")
+		{
+			seed = strtoull(value.c_str(), nullptr, 0);
+		}
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	vector<Band> bands;
+	for (const string& b : Split(bandList))
+	{
+		if (b == "2")
+		{
+			bands.push_back(Band::Band2GHz);
+		}
+		else if (b == "5")
+		{
+			bands.push_back(Band::Band5GHz);
+		}
+		else if (b == "6")
+		{
+			bands.push_back(Band::Band6GHz);
+		}
+		else
+		{
+			cerr << "Unknown band: " << b << endl;
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	vector<ChannelWidth> widths;
+	for (const string& w : Split(widthList))
+	{
+		if (w == "20")
+		{
+			widths.push_back(ChannelWidth::NoHT20);
+		}
+		else if (w == "40")
+		{
+			widths.push_back(ChannelWidth::HT40);
+		}
+		else if (w == "80")
+		{
+			widths.push_back(ChannelWidth::VHT80);
+		}
+		else if (w == "160")
+		{
+			widths.push_back(ChannelWidth::VHT160);
+		}
+		else
+		{
+			cerr << "Unknown width: " << w << endl;
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	vector<AckMode> modes;
+	for (const string& a : Split(ackList))
+	{
+		if (a == "noack")
+		{
+			modes.push_back(AckMode::NoAck);
+		}
+		else if (a == "wait")
+		{
+			modes.push_back(AckMode::WaitForAck);
+		}
+		else if (a == "pipelined")
+		{
+			modes.push_back(AckMode::Pipelined);
+		}
+		else
+		{
+			cerr << "Unknown ACK mode: " << a << endl;
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (hops == 0 || window == 0 || bands.empty() || widths.empty() || modes.empty()
+		|| (format != "csv" && format != "json"))
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+	unique_ptr<BenchBackend> backend;
+	if (backendName == "sim")
+	{
+		backend.reset(new SimBackend(seed));
+	}
+	else if (backendName == "nl80211" && !iface.empty())
+	{
+		Nl80211Backend *nl = new Nl80211Backend();
+		backend.reset(nl);
+		if (!nl->Open(iface.c_str()))
+		{
+			cerr << "Can't open " << iface << " (run as root?)" << endl;
+			return 1;
+		}
+	}
+	else
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+	vector<BenchResult> results;
+	for (ChannelWidth width : widths)
+	{
+		HopPlan plan;
+		if (!backend->BuildPlan(bands, width, plan))
+		{
+			cerr << "No " << WidthName(width) << " MHz channels in bands " << bandList << endl;
+			continue;
+		}
+		for (AckMode mode : modes)
+		{
+			BenchResult result;
+			result.bands = bandList;
+			replace(result.bands.begin(), result.bands.end(), ',', '+');  // (CSV)
+			result.width = WidthName(width);
+			RunConfig(*backend, plan, mode, hops, window, result);
+			results.push_back(result);
+		}
+	}
+	ofstream file;
+	if (!outFile.empty())
+	{
+		file.open(outFile.c_str());
+		if (!file)
+		{
+			cerr << "Can't write " << outFile << endl;
+			return 1;
+		}
+	}
+	ostream& out = outFile.empty() ? cout : file;
+	if (format == "json")
+	{
+		PrintJson(out, results);
+	}
+	else
+	{
+		PrintCsv(out, results);
+	}
+	// Non-zero if any configuration couldn't hop at all:
+	for (const BenchResult& r : results)
+	{
+		if (r.failed + r.lost >= r.hops)
+		{
+			return 2;
+		}
+	}
+	return results.empty() ? 2 : 0;
+}
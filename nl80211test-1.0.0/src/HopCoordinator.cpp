@@ -0,0 +1,380 @@
+// HopCoordinator.cpp
+// Splits the channels between the capture radios and runs one
+// ChannelHopper per radio.
+
+#include "HopCoordinator.h"
+
+HopCoordinator::HopCoordinator() { }
+
+HopCoordinator::~HopCoordinator()
+{
+	Stop();
+}
+
+void HopCoordinator::SetOptions(const HopPlanOptions& options)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_options = options;
+}
+
+HopCoordinator::Radio *HopCoordinator::FindRadio(const char *interfaceName)
+{
+	for (unique_ptr<Radio>& r : m_radios)
+	{
+		if (r->assignment.interfaceName == interfaceName)
+		{
+			return r.get();
+		}
+	}
+	return nullptr;
+}
+
+// The probe really hops the radio (a few seconds): done without m_mutex,
+// so CheckHealth() and Rebalance() carry on meanwhile; the lock is only
+// taken to look for a duplicate and to insert the result.
+bool HopCoordinator::AddRadio(const char *interfaceName)
+{
+	HopPlanOptions options;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (FindRadio(interfaceName) != nullptr)
+		{
+			LogErr(AT, string("HopCoordinator: already have ") + interfaceName);
+			return false;
+		}
+		options = m_options;
+	}
+	InterfaceManagerNl80211 *im = InterfaceManagerNl80211::GetInstance();
+	unique_ptr<Radio> radio(new Radio());
+	radio->assignment.interfaceName = interfaceName;
+	if (!im->GetInterfacePhy(interfaceName, radio->assignment.phy))
+	{
+		LogErr(AT, string("HopCoordinator: no phy for ") + interfaceName);
+		return false;
+	}
+	// What this radio could hop if it were the only one:
+	HopPlanBuilder builder;
+	if (!builder.BuildPlan(radio->assignment.phy, options, radio->candidates))
+	{
+		LogErr(AT, string("HopCoordinator: no usable channels on ") + interfaceName);
+		return false;
+	}
+	// (Before the hopper opens: the probe hops the radio itself.)
+	ChannelSetterProbe probe;
+	vector<SetterProbeResult> results;
+	SetterBackend backend = SetterBackend::Nl80211SetChannel;
+	if (probe.Probe(interfaceName, radio->candidates, 2, results, backend))
+	{
+		for (const SetterProbeResult& r : results)
+		{
+			if (r.backend == backend)
+			{
+				radio->probedLatency = microseconds(r.p50Us);
+			}
+		}
+	}
+	radio->hopper.reset(new ChannelHopper());
+	if (!radio->hopper->Open(interfaceName) || !radio->hopper->SetBackend(backend))
+	{
+		LogErr(AT, string("HopCoordinator: can't open ") + interfaceName);
+		return false;
+	}
+	lock_guard<mutex> lock(m_mutex);
+	if (FindRadio(interfaceName) != nullptr)
+	{
+		// (Added by another AddRadio() while this one was probing.)
+		radio->hopper->Close();
+		LogErr(AT, string("HopCoordinator: already have ") + interfaceName);
+		return false;
+	}
+	stringstream ss;
+	ss << "HopCoordinator: added " << interfaceName << " (phy" << radio->assignment.phy
+		<< ", " << radio->candidates.Size() << " channels, "
+		<< ChannelSetterProbe::BackendName(backend) << ")";
+	LogInfo(ss);
+	m_radios.push_back(move(radio));
+	Rebalance();
+	ApplyPlans();
+	return true;
+}
+
+bool HopCoordinator::RemoveRadio(const char *interfaceName)
+{
+	lock_guard<mutex> lock(m_mutex);
+	for (auto it = m_radios.begin(); it != m_radios.end(); ++it)
+	{
+		if ((*it)->assignment.interfaceName == interfaceName)
+		{
+			(*it)->hopper->Stop();
+			(*it)->hopper->Close();
+			m_radios.erase(it);
+			LogInfo(string("HopCoordinator: removed ") + interfaceName);
+			Rebalance();
+			ApplyPlans();
+			return true;
+		}
+	}
+	LogErr(AT, string("HopCoordinator: no radio ") + interfaceName);
+	return false;
+}
+
+bool HopCoordinator::Start()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_running)
+	{
+		return true;
+	}
+	if (m_radios.empty())
+	{
+		LogErr(AT, "HopCoordinator: no radios");
+		return false;
+	}
+	m_running = true;
+	Rebalance();
+	ApplyPlans();
+	return true;
+}
+
+bool HopCoordinator::Stop()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!m_running)
+	{
+		return true;
+	}
+	m_running = false;
+	for (unique_ptr<Radio>& r : m_radios)
+	{
+		r->hopper->Stop();
+	}
+	return true;
+}
+
+size_t HopCoordinator::CheckHealth()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!m_running)
+	{
+		return 0;
+	}
+	size_t dropped = 0;
+	size_t readmitted = 0;
+	steady_clock::time_point now = steady_clock::now();
+	for (unique_ptr<Radio>& r : m_radios)
+	{
+		if (!r->assignment.healthy)
+		{
+			// Give it another go once its backoff is over:
+			if (now >= r->retryAt)
+			{
+				LogInfo("HopCoordinator: retrying " + r->assignment.interfaceName);
+				r->assignment.healthy = true;
+				r->hopper->GetStats(r->lastStats);
+				readmitted++;
+			}
+			continue;
+		}
+		HopStats stats;
+		r->hopper->GetStats(stats);
+		uint64_t hops = stats.hops - r->lastStats.hops;
+		uint64_t failed = stats.failedHops - r->lastStats.failedHops;
+		r->lastStats = stats;
+		bool stalled = !r->assignment.plan.Empty() && !r->hopper->IsRunning();
+		bool failing = hops >= m_minHopsForHealth && failed > hops * m_maxFailedShare;
+		if (stalled || failing)
+		{
+			stringstream ss;
+			ss << "HopCoordinator: dropping " << r->assignment.interfaceName << ", "
+				<< (stalled ? "hopper stopped" : "hops failing")
+				<< " (" << failed << " of " << hops << " failed)";
+			LogErr(AT, ss);
+			r->hopper->Stop();
+			r->assignment.healthy = false;
+			// Out for m_firstRetry, twice as long each time it fails
+			// again, up to m_maxRetry:
+			r->retryDelay = min(max(r->retryDelay * 2, m_firstRetry), m_maxRetry);
+			r->retryAt = now + r->retryDelay;
+			dropped++;
+		}
+		else if (hops >= m_minHopsForHealth)
+		{
+			// (Hopping fine again: the next failure starts from m_firstRetry.)
+			r->retryDelay = seconds(0);
+		}
+	}
+	if (dropped > 0 || readmitted > 0)
+	{
+		Rebalance();
+		ApplyPlans();
+	}
+	return dropped;
+}
+
+void HopCoordinator::SetHopLatency(const char *interfaceName, microseconds latency)
+{
+	lock_guard<mutex> lock(m_mutex);
+	Radio *r = FindRadio(interfaceName);
+	if (r == nullptr)
+	{
+		LogErr(AT, string("HopCoordinator: no radio ") + interfaceName);
+		return;
+	}
+	r->assignment.hopLatency = latency;
+	r->latencyFixed = true;
+	Rebalance();
+	ApplyPlans();
+}
+
+void HopCoordinator::GetAssignments(vector<RadioAssignment>& assignments)
+{
+	lock_guard<mutex> lock(m_mutex);
+	assignments.clear();
+	for (unique_ptr<Radio>& r : m_radios)
+	{
+		assignments.push_back(r->assignment);
+	}
+}
+
+microseconds HopCoordinator::GetRevisitTime()
+{
+	lock_guard<mutex> lock(m_mutex);
+	microseconds longest(0);
+	for (unique_ptr<Radio>& r : m_radios)
+	{
+		if (r->assignment.healthy && r->assignment.sweepTime > longest)
+		{
+			longest = r->assignment.sweepTime;
+		}
+	}
+	return longest;
+}
+
+bool HopCoordinator::SameEntry(const HopEntry& a, const HopEntry& b)
+{
+	return a.freq == b.freq && a.width == b.width &&
+		a.centerFreq1 == b.centerFreq1 && a.centerFreq2 == b.centerFreq2;
+}
+
+// (m_mutex held.)
+// Greedy longest-processing-time style split: entries that fewest radios
+// can monitor are placed first (they have no choice), each on the capable
+// radio whose sweep is currently shortest. Optimal splits are NP-hard;
+// this stays within a dwell or so of it for any real channel list.
+void HopCoordinator::Rebalance()
+{
+	vector<Radio *> healthy;
+	for (unique_ptr<Radio>& r : m_radios)
+	{
+		r->assignment.plan = HopPlan();
+		r->assignment.sweepTime = microseconds(0);
+		if (!r->assignment.healthy)
+		{
+			continue;
+		}
+		if (!r->latencyFixed)
+		{
+			HopStats stats;
+			r->hopper->GetStats(stats);
+			r->assignment.hopLatency = stats.acked > 0 ? microseconds(stats.AckLatencyMeanUs())
+				: r->probedLatency.count() > 0 ? r->probedLatency : m_defaultHopLatency;
+		}
+		healthy.push_back(r.get());
+	}
+	// Every distinct entry, and which (healthy) radios can take it:
+	vector<HopEntry> entries;
+	vector<vector<size_t>> capable;
+	for (size_t i = 0; i < healthy.size(); i++)
+	{
+		for (const HopEntry& e : healthy[i]->candidates.entries)
+		{
+			size_t n = 0;
+			while (n < entries.size() && !SameEntry(entries[n], e))
+			{
+				n++;
+			}
+			if (n == entries.size())
+			{
+				entries.push_back(e);
+				capable.push_back(vector<size_t>());
+			}
+			capable[n].push_back(i);
+		}
+	}
+	vector<size_t> order;
+	for (size_t n = 0; n < entries.size(); n++)
+	{
+		order.push_back(n);
+	}
+	sort(order.begin(), order.end(), [&](size_t a, size_t b)
+	{
+		if (capable[a].size() != capable[b].size())
+		{
+			return capable[a].size() < capable[b].size();
+		}
+		return entries[a].freq < entries[b].freq;
+	});
+	for (size_t n : order)
+	{
+		// (capable[n] is in radio order, so ties go to the first radio.)
+		Radio *best = nullptr;
+		for (size_t i : capable[n])
+		{
+			if (best == nullptr || healthy[i]->assignment.sweepTime < best->assignment.sweepTime)
+			{
+				best = healthy[i];
+			}
+		}
+		best->assignment.plan.entries.push_back(entries[n]);
+		best->assignment.sweepTime += duration_cast<microseconds>(entries[n].dwell)
+			+ best->assignment.hopLatency;
+	}
+	// Each radio sweeps its share in frequency order:
+	stringstream ss;
+	ss << "HopCoordinator: " << entries.size() << " channels over " << healthy.size() << " radio(s):";
+	for (Radio *r : healthy)
+	{
+		vector<HopEntry>& e = r->assignment.plan.entries;
+		sort(e.begin(), e.end(), [](const HopEntry& a, const HopEntry& b)
+		{
+			return a.freq != b.freq ? a.freq < b.freq : a.centerFreq1 < b.centerFreq1;
+		});
+		ss << " " << r->assignment.interfaceName << " " << e.size() << " ("
+			<< duration_cast<milliseconds>(r->assignment.sweepTime).count() << " ms)";
+	}
+	LogInfo(ss);
+}
+
+// (m_mutex held.) Hand each hopper its new share.
+void HopCoordinator::ApplyPlans()
+{
+	if (!m_running)
+	{
+		return;
+	}
+	for (unique_ptr<Radio>& r : m_radios)
+	{
+		ChannelHopper& hopper = *r->hopper;
+		if (!r->assignment.healthy || r->assignment.plan.Empty())
+		{
+			hopper.Stop();
+			continue;
+		}
+		bool ok;
+		if (hopper.IsRunning())
+		{
+			ok = hopper.UpdatePlan(r->assignment.plan);
+		}
+		else
+		{
+			// Never started, or its thread gave up on its own (not yet
+			// seen by CheckHealth()): Stop() joins what's left of it.
+			hopper.Stop();
+			ok = hopper.Start(r->assignment.plan);
+		}
+		if (!ok)
+		{
+			LogErr(AT, "HopCoordinator: can't run plan on " + r->assignment.interfaceName);
+		}
+	}
+}
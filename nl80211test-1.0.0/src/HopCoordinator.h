@@ -0,0 +1,110 @@
+// HopCoordinator.h
+// Several capture radios: splits the valid channels between them so each
+// radio sweeps its own disjoint slice and the whole spectrum is revisited
+// about N times as often. One ChannelHopper per radio.
+// Each hop plan entry goes to a radio that can monitor it (band / flags /
+// regulatory, via HopPlanBuilder), most constrained entries first (e.g.
+// 6 GHz only to 6 GHz radios), to whichever capable radio then has the
+// shortest sweep: sum of (dwell + that radio's hop latency).
+// Adding, removing or losing a radio re-splits the channels.
+
+#ifndef HOPCOORDINATOR_H_
+#define HOPCOORDINATOR_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "Log.h"
+#include "HopPlan.h"
+#include "HopPlanBuilder.h"
+#include "ChannelHopper.h"
+#include "InterfaceManagerNl80211.h"
+#include "ChannelSetterProbe.h"
+
+using namespace std;
+using namespace chrono;
+
+// One radio's share, as last assigned by Rebalance():
+class RadioAssignment
+{
+public:
+	string interfaceName;
+	uint32_t phy = 0;
+	bool healthy = true;
+	microseconds hopLatency = microseconds(0);
+	HopPlan plan;
+	// Time for one pass over 'plan' (dwells + hop latencies):
+	microseconds sweepTime = microseconds(0);
+};
+
+class HopCoordinator : protected Log
+{
+public:
+	HopCoordinator();
+	~HopCoordinator();
+	// Before AddRadio(): what each radio may hop (bands, width, dwell).
+	void SetOptions(const HopPlanOptions& options);
+	// Radios can come and go while running; each change re-splits.
+	// AddRadio() probes the radio's channel setter backends and its
+	// hopper uses the fastest.
+	bool AddRadio(const char *interfaceName);
+	bool RemoveRadio(const char *interfaceName);
+	// Start / Stop every radio's hopper:
+	bool Start();
+	bool Stop();
+	// Call periodically (e.g. every second): a radio whose hopper died
+	// or whose hops mostly fail is dropped and its channels handed to
+	// the others. A dropped radio is tried again after a backoff (5 s,
+	// doubling each time it fails again, at most 5 min).
+	// Returns the number of radios dropped.
+	size_t CheckHealth();
+	// Measured hop latency (e.g., settle time) for a radio; default is
+	// the hopper's mean ACK latency once it has one.
+	void SetHopLatency(const char *interfaceName, microseconds latency);
+	void GetAssignments(vector<RadioAssignment>& assignments);
+	// Longest sweep of any radio: how long until every channel has
+	// been visited again.
+	microseconds GetRevisitTime();
+private:
+	class Radio
+	{
+	public:
+		RadioAssignment assignment;
+		HopPlan candidates;          // All entries this radio can monitor
+		bool latencyFixed = false;   // From SetHopLatency()
+		// Startup probe's hop latency (until the hopper has ACK numbers):
+		microseconds probedLatency = microseconds(0);
+		unique_ptr<ChannelHopper> hopper;
+		HopStats lastStats;
+		// Dropped (not healthy): back in at retryAt.
+		seconds retryDelay = seconds(0);
+		steady_clock::time_point retryAt;
+	};
+	void Rebalance();
+	void ApplyPlans();
+	Radio *FindRadio(const char *interfaceName);
+	static bool SameEntry(const HopEntry& a, const HopEntry& b);
+	mutex m_mutex;
+	vector<unique_ptr<Radio>> m_radios;
+	HopPlanOptions m_options;
+	bool m_running = false;
+	// Default until a radio has measured ACK latencies:
+	const microseconds m_defaultHopLatency = microseconds(5000);
+	// CheckHealth(): at least this many hops since last check, and more
+	// than this share failed, to drop a radio:
+	const uint64_t m_minHopsForHealth = 10;
+	const double m_maxFailedShare = 0.5;
+	// Backoff before a dropped radio is tried again:
+	const seconds m_firstRetry = seconds(5);
+	const seconds m_maxRetry = seconds(300);
+};
+
+#endif  // HOPCOORDINATOR_H_
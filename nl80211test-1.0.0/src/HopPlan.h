@@ -0,0 +1,119 @@
+// HopPlan.h
+// A channel hop plan: the list of channels the monitor radio
+// visits, in order, and how long it stays (dwells) on each.
+// ChannelHopper repeats the plan until stopped.
+// Entries may mix widths: one 80 MHz dwell covers four 20 MHz channels,
+// on radios that support it.
+// Validate() checks every entry against ChannelTables and fills in
+// its frequencies, so nothing is converted (or rejected) per hop.
+
+#ifndef HOPPLAN_H_
+#define HOPPLAN_H_
+
+#include <vector>
+#include <chrono>
+#include <string>
+#include <sstream>
+
+#include <stdint.h>
+
+#include "ChannelTables.h"
+
+using namespace std;
+using namespace chrono;
+
+class HopEntry
+{
+public:
+	Band band;
+	uint32_t channel;
+	ChannelWidth width;
+	milliseconds dwell;
+	// VHT80P80 only: center CHANNEL of the second 80 MHz segment.
+	uint32_t secondSegment = 0;
+	// Filled in by HopPlan::Validate():
+	uint32_t freq = 0;
+	uint32_t centerFreq1 = 0;
+	uint32_t centerFreq2 = 0;
+	// Plain channel number: 1-14 2.4 GHz, else 5 GHz, 20 MHz no HT.
+	HopEntry(uint32_t theChannel, milliseconds theDwell)
+	{
+		band = ChannelTables::LegacyBand(theChannel);
+		channel = theChannel;
+		width = ChannelWidth::NoHT20;
+		dwell = theDwell;
+	}
+	HopEntry(Band theBand, uint32_t theChannel, ChannelWidth theWidth, milliseconds theDwell)
+	{
+		band = theBand;
+		channel = theChannel;
+		width = theWidth;
+		dwell = theDwell;
+	}
+};
+
+class HopPlan
+{
+public:
+	vector<HopEntry> entries;
+	void Add(uint32_t channel, milliseconds dwell)
+	{
+		entries.push_back(HopEntry(channel, dwell));
+	}
+	void Add(Band band, uint32_t channel, ChannelWidth width, milliseconds dwell)
+	{
+		entries.push_back(HopEntry(band, channel, width, dwell));
+	}
+	void Add80P80(Band band, uint32_t channel, uint32_t secondSegment, milliseconds dwell)
+	{
+		entries.push_back(HopEntry(band, channel, ChannelWidth::VHT80P80, dwell));
+		entries.back().secondSegment = secondSegment;
+	}
+	bool Empty() const { return entries.empty(); }
+	size_t Size() const { return entries.size(); }
+	// Returns false (and why) on the first entry that isn't a real
+	// channel, can't be the primary of its width, or has no dwell.
+	bool Validate(string& why)
+	{
+		if (entries.empty())
+		{
+			why = "empty hop plan";
+			return false;
+		}
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			HopEntry& e = entries[i];
+			stringstream s;
+			s << "entry " << i << " (channel " << e.channel << "): ";
+			if (!ChannelTables::ChannelToFrequency(e.band, e.channel, e.freq))
+			{
+				s << "no such channel in this band";
+				why = s.str();
+				return false;
+			}
+			if (!ChannelTables::CenterFrequency(e.band, e.channel, e.width, e.centerFreq1))
+			{
+				s << "not valid for the requested channel width";
+				why = s.str();
+				return false;
+			}
+			e.centerFreq2 = 0;
+			if (e.width == ChannelWidth::VHT80P80
+				&& !ChannelTables::SecondSegmentFrequency(e.band, e.channel, e.secondSegment, e.centerFreq2))
+			{
+				s << "bad second 80 MHz segment " << e.secondSegment;
+				why = s.str();
+				return false;
+			}
+			if (e.dwell.count() <= 0)
+			{
+				s << "dwell must be > 0";
+				why = s.str();
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif  // HOPPLAN_H_
@@ -0,0 +1,253 @@
+// HopPlanBuilder.cpp
+// Regulatory- and capability-aware hop plans.
+
+#include "HopPlanBuilder.h"
+
+HopPlanBuilder::HopPlanBuilder() : Log("HopPlanBuilder") { }
+
+HopPlanBuilder::~HopPlanBuilder()
+{
+	Unwatch();
+}
+
+bool HopPlanBuilder::IsMonitorable(const WiphyChannel& ch, const HopPlanOptions& options,
+	const RegDomain& domain)
+{
+	// (static)
+	if (!ch.known || ch.disabled)
+	{
+		return false;
+	}
+	if ((ch.band == Band::Band2GHz && !options.band2GHz)
+		|| (ch.band == Band::Band5GHz && !options.band5GHz)
+		|| (ch.band == Band::Band6GHz && !options.band6GHz))
+	{
+		return false;
+	}
+	if ((ch.noIr && !options.includeNoIr) || (ch.radar && !options.includeRadar))
+	{
+		return false;
+	}
+	// The wiphy flags normally already reflect the domain; the rules
+	// also catch a driver that doesn't apply them. (No rules read: trust
+	// the flags.)
+	return domain.rules.empty() || domain.Allows(ch.freq);
+}
+
+bool HopPlanBuilder::GetMonitorableChannels(uint32_t phy, const HopPlanOptions& options,
+	vector<WiphyChannel>& channels)
+{
+	// Own readers: Watch() calls this from the event thread.
+	Nl80211WiphyReader reader;
+	vector<WiphyChannel> all;
+	RegDomain domain;
+	channels.clear();
+	if (!reader.GetWiphyChannels(phy, all))
+	{
+		return false;
+	}
+	if (!reader.GetRegDomain(phy, domain))
+	{
+		LogInfo("GetMonitorableChannels(): no regulatory domain, using wiphy flags only.");
+		domain = RegDomain();
+	}
+	for (const WiphyChannel& ch : all)
+	{
+		if (IsMonitorable(ch, options, domain))
+		{
+			channels.push_back(ch);
+		}
+	}
+	sort(channels.begin(), channels.end(),
+		[](const WiphyChannel& a, const WiphyChannel& b) { return a.freq < b.freq; });
+	stringstream s;
+	s << "phy" << phy << ", domain " << (domain.alpha2.empty() ? "??" : domain.alpha2)
+		<< ": " << channels.size() << " of " << all.size() << " channels monitorable.";
+	LogInfo(s);
+	return true;
+}
+
+// SegmentUsable(): every 20 MHz channel of the (widthMhz) segment
+// centered on centerFreq is in 'channels':
+bool HopPlanBuilder::SegmentUsable(uint32_t centerFreq, uint32_t widthMhz,
+	const vector<WiphyChannel>& channels)
+{
+	// (static)
+	for (uint32_t f = centerFreq - widthMhz / 2 + 10; f < centerFreq + widthMhz / 2; f += 20)
+	{
+		bool found = false;
+		for (const WiphyChannel& ch : channels)
+		{
+			if (ch.freq == f)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool HopPlanBuilder::BuildPlan(uint32_t phy, const HopPlanOptions& options, HopPlan& plan)
+{
+	vector<WiphyChannel> channels;
+	plan = HopPlan();
+	if (!GetMonitorableChannels(phy, options, channels))
+	{
+		return false;
+	}
+	ChannelWidth wide = (options.width == ChannelWidth::VHT80P80) ? ChannelWidth::VHT80 : options.width;
+	bool isWide = (wide != ChannelWidth::NoHT20 && wide != ChannelWidth::HT20);
+	uint32_t half = ChannelTables::WidthMhz(wide) / 2;
+	vector<uint32_t> centersUsed;
+	stringstream narrowed;
+	for (const WiphyChannel& ch : channels)
+	{
+		if (!isWide || ch.band == Band::Band2GHz)
+		{
+			plan.Add(ch.band, ch.channel, isWide ? ChannelWidth::HT20 : options.width, options.dwell);
+			continue;
+		}
+		// Already heard through a segment added for a lower channel?
+		bool covered = false;
+		for (uint32_t c : centersUsed)
+		{
+			if (ch.freq > c - half && ch.freq < c + half)
+			{
+				covered = true;
+				break;
+			}
+		}
+		if (covered)
+		{
+			continue;
+		}
+		uint32_t center;
+		if (!ChannelTables::CenterFrequency(ch.band, ch.channel, wide, center)
+			|| !SegmentUsable(center, ChannelTables::WidthMhz(wide), channels))
+		{
+			// No (fully monitorable) segment of that width: still listen
+			// to the channel, at 20 MHz (e.g. 165 at VHT80, 6 GHz channel 2).
+			plan.Add(ch.band, ch.channel, ChannelWidth::HT20, options.dwell);
+			narrowed << " " << ch.channel;
+			continue;
+		}
+		// Channels are in frequency order and this one isn't covered yet:
+		// it's the segment's lowest channel, use it as the primary.
+		centersUsed.push_back(center);
+		plan.Add(ch.band, ch.channel, wide, options.dwell);
+	}
+	if (narrowed.tellp() > 0)
+	{
+		LogInfo("BuildPlan(): no usable wide segment, hopping at 20 MHz:" + narrowed.str());
+	}
+	string why;
+	if (!plan.Validate(why))
+	{
+		LogErr(AT, "BuildPlan(): " + why);
+		return false;
+	}
+	return true;
+}
+
+bool HopPlanBuilder::SamePlan(const HopPlan& a, const HopPlan& b)
+{
+	// (static)
+	if (a.Size() != b.Size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.Size(); i++)
+	{
+		const HopEntry& x = a.entries[i];
+		const HopEntry& y = b.entries[i];
+		if (x.freq != y.freq || x.width != y.width || x.dwell != y.dwell)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool HopPlanBuilder::Watch(uint32_t phy, const HopPlanOptions& options, PlanChangedCallback onChange)
+{
+	Unwatch();
+	// Starting point: only report plans that differ from this one.
+	HopPlan current;
+	if (!BuildPlan(phy, options, current))
+	{
+		current = HopPlan();
+	}
+	{
+		lock_guard<mutex> lock(m_watchMutex);
+		m_watchPhy = phy;
+		m_watchOptions = options;
+		m_onChange = onChange;
+		m_lastPlan = current;
+		m_watching = true;
+	}
+	auto handler = [this](uint8_t cmd, struct nlattr **tb) { OnRegulatoryEvent(cmd, tb); };
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_REG_CHANGE, handler));
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_WIPHY_REG_CHANGE, handler));
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_REG_BEACON_HINT, handler));
+	if (!m_listener.AddGroup(NL80211_MULTICAST_GROUP_REG)
+		|| !m_listener.Start())
+	{
+		LogErr(AT, "Watch(): can't listen for regulatory events.");
+		Unwatch();
+		return false;
+	}
+	return true;
+}
+
+void HopPlanBuilder::Unwatch()
+{
+	m_listener.Stop();
+	for (int id : m_handlerIds)
+	{
+		m_listener.RemoveHandler(id);
+	}
+	m_handlerIds.clear();
+	lock_guard<mutex> lock(m_watchMutex);
+	m_watching = false;
+	m_onChange = nullptr;
+}
+
+// OnRegulatoryEvent(): (event thread) rebuild, tell the owner if it changed.
+void HopPlanBuilder::OnRegulatoryEvent(uint8_t cmd, struct nlattr **tb)
+{
+	lock_guard<mutex> lock(m_watchMutex);
+	if (!m_watching)
+	{
+		return;
+	}
+	// Another radio's private (self managed) domain changed:
+	if (cmd == NL80211_CMD_WIPHY_REG_CHANGE && tb[NL80211_ATTR_WIPHY]
+		&& nla_get_u32(tb[NL80211_ATTR_WIPHY]) != m_watchPhy)
+	{
+		return;
+	}
+	HopPlan plan;
+	if (!BuildPlan(m_watchPhy, m_watchOptions, plan))
+	{
+		LogErr(AT, "OnRegulatoryEvent(): can't rebuild hop plan, keeping the old one.");
+		return;
+	}
+	if (SamePlan(plan, m_lastPlan))
+	{
+		return;
+	}
+	m_lastPlan = plan;
+	stringstream s;
+	s << "Regulatory change: new hop plan for phy" << m_watchPhy << ", "
+		<< plan.Size() << " hops.";
+	LogInfo(s);
+	if (m_onChange)
+	{
+		m_onChange(plan);
+	}
+}
@@ -0,0 +1,83 @@
+// HopPlanBuilder.h
+// Builds a HopPlan from what the radio can actually monitor: the wiphy's
+// channel flags (disabled / no-IR / radar) and the regulatory domain's
+// rules, instead of blindly hopping 1..13.
+// Watch() rebuilds the plan whenever the regulatory domain changes
+// (NL80211_CMD_REG_CHANGE / WIPHY_REG_CHANGE / REG_BEACON_HINT events).
+
+#ifndef HOPPLANBUILDER_H_
+#define HOPPLANBUILDER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "Log.h"
+#include "HopPlan.h"
+#include "ChannelTables.h"
+#include "WiphyInfo.h"
+#include "Nl80211WiphyReader.h"
+#include "Nl80211EventListener.h"
+
+using namespace std;
+using namespace chrono;
+
+class HopPlanOptions
+{
+public:
+	// Wider than 20 MHz: one entry per 5 / 6 GHz segment whose 20 MHz
+	// channels are ALL monitorable; channels no such segment covers (and
+	// 2.4 GHz) are hopped at 20 MHz.
+	ChannelWidth width = ChannelWidth::NoHT20;
+	milliseconds dwell = milliseconds(250);
+	bool band2GHz = true;
+	bool band5GHz = true;
+	bool band6GHz = true;
+	// Monitoring is receive only, so no-IR and radar (DFS) channels
+	// can still be listened to:
+	bool includeNoIr = true;
+	bool includeRadar = true;
+};
+
+class HopPlanBuilder : protected Log
+{
+public:
+	HopPlanBuilder();
+	~HopPlanBuilder();
+	// The radio's channels that pass the options, wiphy flags and
+	// regulatory rules, in frequency order:
+	bool GetMonitorableChannels(uint32_t phy, const HopPlanOptions& options,
+		vector<WiphyChannel>& channels);
+	// Validated (HopPlan::Validate()) plan of those channels:
+	bool BuildPlan(uint32_t phy, const HopPlanOptions& options, HopPlan& plan);
+	// Rebuild on every regulatory change; 'onChange' is called (on the
+	// event thread) with each new plan that differs from the previous one
+	// (don't call Unwatch() from inside it).
+	typedef function<void(const HopPlan& plan)> PlanChangedCallback;
+	bool Watch(uint32_t phy, const HopPlanOptions& options, PlanChangedCallback onChange);
+	void Unwatch();
+private:
+	void OnRegulatoryEvent(uint8_t cmd, struct nlattr **tb);
+	static bool IsMonitorable(const WiphyChannel& ch, const HopPlanOptions& options,
+		const RegDomain& domain);
+	static bool SegmentUsable(uint32_t centerFreq, uint32_t widthMhz,
+		const vector<WiphyChannel>& channels);
+	static bool SamePlan(const HopPlan& a, const HopPlan& b);
+	Nl80211EventListener m_listener;
+	mutex m_watchMutex;
+	bool m_watching = false;
+	uint32_t m_watchPhy = 0;
+	HopPlanOptions m_watchOptions;
+	PlanChangedCallback m_onChange;
+	HopPlan m_lastPlan;
+	vector<int> m_handlerIds;
+};
+
+#endif  // HOPPLANBUILDER_H_
@@ -174,11 +174,17 @@ bool HostapdManager::StartHostapd()
 	// to set up on a new ShadowX box...
 	//     m_apIpAddress is: "192.168.40.1"
 	//     m_apNetmask is: "255.255.255.0"
-	if (!ifIoctls.SetIpAddressAndNetmask(apName, m_apIpAddress, m_apNetmask))
+	// On a restart the address is usually already set, don't rewrite it.
+	InterfaceStates states;
+	ApplyReport report;
+	ifIoctls.ReadInterfaceStates(states);
+	if (!ifIoctls.EnsureIpAddressAndNetmask(apName, m_apIpAddress, m_apNetmask, states, report))
 	{
 		LogErr(AT, "StartHostApd(): Could not set AP Interfaces MAC address, aborting.");
 		return false;
 	}
+	report.Finish();
+	LogInfo(string("StartHostapd(): ") + report.Summary());
 
 	// Update the DHCP (udhcpd.conf) file with the new interface:
 	if (!UpdateDhcpConf(apName))
@@ -1,8 +1,12 @@
 // IChannelSetter.h
-// Base class for ChannelSetterNl80211 and
-// (FUTURE) ChannelSetterWext
+// Base class for the channel setter backends:
+//   ChannelSetterNl80211  NL80211_CMD_SET_CHANNEL, or SET_WIPHY (legacy)
+//   ChannelSetterWext     Wireless Extensions SIOCSIWFREQ ioctl
+//   SimChannelSetter      No radio (benchmarks / CI)
 // Use this instead of the raw IOCTLs (Wext)
 // or Nl80211 Channel Set functions.
+// Some drivers handle one path much faster than another, see
+// ChannelSetterProbe: it times every backend on a radio and picks.
 // This does not replace ChannelChanger class, it is
 // to be owned / used by the ChannelChanger class.
 
@@ -13,15 +17,34 @@
 
 #include <stdint.h>
 
+#include "HopPlan.h"
+
+// Backends ChannelSetterProbe::Create() can make:
+enum class SetterBackend
+{
+	Nl80211SetChannel = 1,  // NL80211_CMD_SET_CHANNEL (+ width attributes)
+	Nl80211SetWiphy,        // NL80211_CMD_SET_WIPHY, legacy CHANNEL_TYPE
+	Wext                    // SIOCSIWFREQ, 20 MHz only
+};
+
 class IChannelSetter
 {
 public:
 	IChannelSetter() {}
+	virtual const char *Name() = 0;
+	// InterfaceManager's monitor interface:
 	virtual bool OpenConnection() = 0;
-	virtual bool SetChannel(int32_t channel) = 0;
+	virtual bool OpenConnection(const char *interfaceName) = 0;
+	// Plain channel number (1-14: 2.4 GHz, else 5 GHz), 20 MHz:
+	virtual bool SetChannel(uint32_t channel) = 0;
+	// Entry of a validated HopPlan; false if the backend can't do its
+	// width. (Synchronous: the kernel has accepted or refused it; the
+	// nl80211 setter only in AckMode::WaitForAck.)
+	virtual bool SetChannel(const HopEntry& entry) = 0;
+	// Where the radio really is now (MHz):
+	virtual bool GetFrequency(uint32_t& freq) = 0;
 	virtual bool CloseConnection() = 0;
 	virtual ~IChannelSetter() { }
 };
 
 #endif  // ICHANNELSETTER_H_
-
@@ -0,0 +1,44 @@
+// IDwellPolicy.h
+// Base class for ChannelHopper's dwell schedulers: which HopPlan entry to
+// visit next and for how long, given what was seen on each channel.
+// UniformDwellPolicy: the plan as written (round robin, plan dwell).
+// ActivityDwellPolicy: busy channels get more and longer visits.
+// (See DwellPolicies.h; dwellsim compares them offline.)
+// Policies are only called from one thread (the hop thread).
+
+#ifndef IDWELLPOLICY_H_
+#define IDWELLPOLICY_H_
+
+#include <chrono>
+
+#include <stdint.h>
+
+#include "HopPlan.h"
+
+using namespace std;
+using namespace chrono;
+
+// What was seen during one dwell:
+class ChannelActivity
+{
+public:
+	uint64_t frames = 0;        // Frames captured
+	uint32_t bssCount = 0;      // Distinct BSSs heard
+	double busyFraction = 0.0;  // Channel busy time / dwell (survey), 0..1
+};
+
+class IDwellPolicy
+{
+public:
+	IDwellPolicy() {}
+	virtual const char *Name() = 0;
+	// New plan: forget everything, entries are 0..plan.Size() - 1.
+	virtual void Reset(const HopPlan& plan) = 0;
+	// Next entry to visit, and its dwell:
+	virtual size_t Next(milliseconds& dwell) = 0;
+	// End of a dwell on 'index' that actually lasted 'dwelt':
+	virtual void Observe(size_t index, const ChannelActivity& activity, milliseconds dwelt) = 0;
+	virtual ~IDwellPolicy() { }
+};
+
+#endif  // IDWELLPOLICY_H_
@@ -0,0 +1,260 @@
+// IeBench.cpp
+// IeParser throughput: parses a corpus of beacon / probe response IE
+// blobs over and over (each parse followed by the lookups a scan table
+// would do: SSID, rates, HT / VHT / HE, RSN, WMM) for a few seconds.
+// Usage:  iebench [--corpus FILE] [--seconds N]
+//   FILE: one IE blob per line in hex (the frame body after the fixed
+//   fields, e.g. NL80211_BSS_INFORMATION_ELEMENTS; '#' starts a comment).
+//   Without one, a built-in set laid out like common AP beacons is used
+//   (legacy 2.4 GHz, 802.11ac, 802.11ax, vendor heavy, one truncated).
+// Reported: beacons/s, IEs/s, ns per beacon, malformed blobs.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+#include <stdint.h>
+
+#include "IeParser.h"
+
+using namespace std;
+using namespace chrono;
+
+typedef vector<uint8_t> Blob;
+
+static void AddIe(Blob& b, uint8_t id, const vector<uint8_t>& payload)
+{
+	b.push_back(id);
+	b.push_back((uint8_t)payload.size());
+	b.insert(b.end(), payload.begin(), payload.end());
+}
+
+static void AddIe(Blob& b, uint8_t id, size_t length, uint8_t fill)
+{
+	AddIe(b, id, vector<uint8_t>(length, fill));
+}
+
+static void AddSsid(Blob& b, const char *ssid)
+{
+	AddIe(b, IeSsid, vector<uint8_t>(ssid, ssid + strlen(ssid)));
+}
+
+static vector<uint8_t> Rsn()
+{
+	// Version 1, CCMP group, 1 x CCMP pairwise, 1 x PSK AKM, capabilities:
+	return { 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04,
+		0x01, 0x00, 0x00, 0x0f, 0xac, 0x02, 0x0c, 0x00 };
+}
+
+static vector<uint8_t> Wmm()
+{
+	vector<uint8_t> v = { 0x00, 0x50, 0xf2, 0x02, 0x01, 0x01, 0x80, 0x00 };
+	v.resize(24, 0x00);
+	return v;
+}
+
+static void BuildCorpus(vector<Blob>& corpus)
+{
+	Blob legacy;
+	AddSsid(legacy, "HomeNet-2G");
+	AddIe(legacy, IeSupportedRates, { 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24 });
+	AddIe(legacy, IeDsParameter, { 0x06 });
+	AddIe(legacy, IeTim, { 0x00, 0x01, 0x00, 0x00 });
+	AddIe(legacy, IeCountry, { 'U', 'S', ' ', 0x01, 0x0b, 0x1e });
+	AddIe(legacy, 42, { 0x00 });  // ERP
+	AddIe(legacy, IeExtendedRates, { 0x30, 0x48, 0x60, 0x6c });
+	AddIe(legacy, IeRsn, Rsn());
+	AddIe(legacy, IeHtCapabilities, 26, 0x2c);
+	AddIe(legacy, IeHtOperation, 22, 0x00);
+	AddIe(legacy, IeExtendedCapabilities, 8, 0x00);
+	AddIe(legacy, IeVendor, Wmm());
+	AddIe(legacy, IeVendor, { 0x00, 0x50, 0xf2, 0x04, 0x10, 0x4a, 0x00, 0x01, 0x10 });  // WPS
+	corpus.push_back(legacy);
+
+	Blob vht;
+	AddSsid(vht, "Office-5G");
+	AddIe(vht, IeSupportedRates, { 0x8c, 0x12, 0x98, 0x24, 0xb0, 0x48, 0x60, 0x6c });
+	AddIe(vht, IeTim, { 0x01, 0x03, 0x00, 0x00 });
+	AddIe(vht, IeCountry, { 'D', 'E', ' ', 0x24, 0x04, 0x17, 0x34, 0x04, 0x17, 0x64, 0x0b, 0x1e });
+	AddIe(vht, 70, 5, 0x00);  // RM enabled capabilities
+	AddIe(vht, IeRsn, Rsn());
+	AddIe(vht, IeHtCapabilities, 26, 0xef);
+	AddIe(vht, IeHtOperation, 22, 0x05);
+	AddIe(vht, IeExtendedCapabilities, 10, 0x00);
+	AddIe(vht, IeVhtCapabilities, 12, 0xb1);
+	AddIe(vht, IeVhtOperation, { 0x01, 0x2a, 0x00, 0xfc, 0xff });
+	AddIe(vht, 195, { 0x02, 0x17, 0x17, 0x17 });  // VHT transmit power envelope
+	AddIe(vht, IeVendor, Wmm());
+	corpus.push_back(vht);
+
+	Blob he;
+	AddSsid(he, "wifi6-ax-network");
+	AddIe(he, IeSupportedRates, { 0x8c, 0x12, 0x98, 0x24, 0xb0, 0x48, 0x60, 0x6c });
+	AddIe(he, IeTim, { 0x00, 0x01, 0x00, 0x00 });
+	AddIe(he, IeCountry, { 'G', 'B', 0x04, 0x24, 0x04, 0x17, 0x64, 0x0c, 0x1e });
+	AddIe(he, 11, { 0x03, 0x00, 0x12, 0x00, 0x00 });  // BSS load
+	AddIe(he, IeRsn, Rsn());
+	AddIe(he, IeHtCapabilities, 26, 0xef);
+	AddIe(he, IeHtOperation, 22, 0x05);
+	AddIe(he, IeExtendedCapabilities, 11, 0x00);
+	AddIe(he, IeVhtCapabilities, 12, 0xb1);
+	AddIe(he, IeVhtOperation, { 0x02, 0x32, 0x00, 0xfa, 0xff });
+	vector<uint8_t> heCap(26, 0x00);
+	heCap[0] = IeExtHeCapabilities;
+	AddIe(he, IeExtension, heCap);
+	AddIe(he, IeExtension, { IeExtHeOperation, 0x04, 0x00, 0x00, 0x10, 0xfc, 0xff });
+	AddIe(he, IeExtension, { 38, 0x00, 0x03, 0xa4, 0x08, 0x20, 0x43, 0xa4, 0x08,
+		0x20, 0x64, 0x22, 0x08, 0x20 });  // MU EDCA
+	AddIe(he, IeVendor, Wmm());
+	corpus.push_back(he);
+
+	Blob vendors;
+	AddSsid(vendors, "CorpWLAN");
+	AddIe(vendors, IeSupportedRates, { 0x0c, 0x12, 0x18, 0x24, 0x30, 0x48, 0x60, 0x6c });
+	AddIe(vendors, IeTim, { 0x02, 0x03, 0x00, 0x00 });
+	AddIe(vendors, IeCountry, { 'U', 'S', 'I', 0x24, 0x04, 0x24, 0x34, 0x04, 0x18 });
+	AddIe(vendors, 32, { 0x00 });  // Power constraint
+	AddIe(vendors, IeRsn, Rsn());
+	AddIe(vendors, IeHtCapabilities, 26, 0x6f);
+	AddIe(vendors, IeHtOperation, 22, 0x01);
+	AddIe(vendors, IeVhtCapabilities, 12, 0x91);
+	AddIe(vendors, IeVhtOperation, { 0x01, 0x9b, 0x00, 0xfa, 0xff });
+	for (uint8_t i = 0; i < 6; i++)
+	{
+		// (Cisco, Aruba, ... style opaque vendor elements)
+		vector<uint8_t> v = { 0x00, 0x40, 0x96, (uint8_t)(0x01 + i) };
+		v.resize(6 + 4 * i, i);
+		AddIe(vendors, IeVendor, v);
+	}
+	AddIe(vendors, IeVendor, Wmm());
+	corpus.push_back(vendors);
+
+	// Last element's length runs past the end:
+	Blob truncated = legacy;
+	truncated.resize(truncated.size() - 3);
+	corpus.push_back(truncated);
+}
+
+static bool LoadCorpus(const char *path, vector<Blob>& corpus)
+{
+	ifstream in(path);
+	if (!in)
+	{
+		cerr << "iebench: can't open " << path << endl;
+		return false;
+	}
+	string line;
+	while (getline(in, line))
+	{
+		Blob b;
+		string hex;
+		for (char c : line)
+		{
+			if (c == '#')
+			{
+				break;
+			}
+			if (isxdigit((unsigned char)c))
+			{
+				hex += c;
+			}
+		}
+		for (size_t i = 0; i + 1 < hex.size(); i += 2)
+		{
+			b.push_back((uint8_t)strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+		}
+		if (!b.empty())
+		{
+			corpus.push_back(b);
+		}
+	}
+	return !corpus.empty();
+}
+
+int main(int argc, char* argv[])
+{
+	const char *corpusPath = nullptr;
+	double seconds = 2.0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+		{
+			corpusPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			seconds = atof(argv[++i]);
+		}
+		else
+		{
+			cerr << "Usage: iebench [--corpus FILE] [--seconds N]" << endl;
+			return 1;
+		}
+	}
+	vector<Blob> corpus;
+	if (corpusPath == nullptr)
+	{
+		BuildCorpus(corpus);
+	}
+	else if (!LoadCorpus(corpusPath, corpus))
+	{
+		return 1;
+	}
+	size_t bytes = 0;
+	for (const Blob& b : corpus)
+	{
+		bytes += b.size();
+	}
+	cout << "iebench: " << corpus.size() << " IE blobs, " << bytes << " bytes"
+		<< (corpusPath ? string(" from ") + corpusPath : string(" (built-in)")) << endl;
+
+	static const uint8_t wmmOui[3] = { 0x00, 0x50, 0xf2 };
+	IeParser parser;
+	IeView view;
+	uint64_t beacons = 0;
+	uint64_t ies = 0;
+	uint64_t malformed = 0;
+	uint64_t check = 0;  // (keeps the lookups from being optimized away)
+	steady_clock::time_point start = steady_clock::now();
+	duration<double> elapsed(0);
+	while (elapsed.count() < seconds)
+	{
+		// (Check the clock once per 1000 passes over the corpus.)
+		for (int pass = 0; pass < 1000; pass++)
+		{
+			for (const Blob& b : corpus)
+			{
+				if (!parser.Parse(b.data(), b.size()))
+				{
+					malformed++;
+				}
+				ies += parser.Count();
+				check += parser.Ssid(view) ? view.length : 0;
+				check += parser.SupportedRates(view) ? view.length : 0;
+				check += parser.ExtendedRates(view) ? view.length : 0;
+				check += parser.HtCapabilities(view) ? view.data[0] : 0;
+				check += parser.VhtCapabilities(view) ? view.data[0] : 0;
+				check += parser.HeCapabilities(view) ? view.data[0] : 0;
+				check += parser.Rsn(view) ? view.length : 0;
+				check += parser.FindVendor(wmmOui, 2, view) ? view.length : 0;
+			}
+			beacons += corpus.size();
+		}
+		elapsed = steady_clock::now() - start;
+	}
+	double s = elapsed.count();
+	cout << fixed << setprecision(0)
+		<< "  beacons/s:     " << beacons / s << endl
+		<< "  IEs/s:         " << ies / s << endl
+		<< setprecision(1)
+		<< "  ns per beacon: " << s * 1e9 / beacons << endl
+		<< "  malformed:     " << malformed << " of " << beacons << endl
+		<< "  (check " << check << ")" << endl;
+	return 0;
+}
@@ -0,0 +1,201 @@
+// IeParser.cpp
+// One pass over the Information Element TLVs, see IeParser.h.
+
+#include "IeParser.h"
+
+IeParser::IeParser() { }
+
+bool IeParser::Parse(const uint8_t *buf, size_t len)
+{
+	return Walk(buf, len, nullptr);
+}
+
+bool IeParser::Parse(const uint8_t *buf, size_t len, const IeTagSet& wanted)
+{
+	return Walk(buf, len, &wanted);
+}
+
+// Each element's offset comes from the previous one's length byte, so
+// this is inherently serial: one bounds check and a few stores per
+// element, no copying. (Only the bitmaps are reset per parse, not the
+// offset tables.)
+bool IeParser::Walk(const uint8_t *buf, size_t len, const IeTagSet *wanted)
+{
+	m_buf = buf;
+	m_len = len;
+	m_count = 0;
+	m_errorOffset = 0;
+	m_present.Clear();
+	m_extPresent.Clear();
+	m_vendorCount = 0;
+	if (buf == nullptr)
+	{
+		return len == 0;
+	}
+	size_t pos = 0;
+	while (pos < len)
+	{
+		// ID + length, then 'length' bytes, all inside the buffer:
+		if (len - pos < 2 || len - pos - 2 < buf[pos + 1])
+		{
+			m_errorOffset = pos;
+			return false;
+		}
+		uint8_t id = buf[pos];
+		uint8_t elen = buf[pos + 1];
+		if (!m_present.Has(id))
+		{
+			m_present.Add(id);
+			m_offset[id] = (uint32_t)pos;
+		}
+		if (id == IeExtension && elen >= 1 && !m_extPresent.Has(buf[pos + 2]))
+		{
+			m_extPresent.Add(buf[pos + 2]);
+			m_extOffset[buf[pos + 2]] = (uint32_t)pos;
+		}
+		else if (id == IeVendor && m_vendorCount < MaxVendor)
+		{
+			m_vendorOffset[m_vendorCount++] = (uint32_t)pos;
+		}
+		m_count++;
+		pos += 2 + elen;
+		if (wanted != nullptr && m_present.Covers(*wanted))
+		{
+			break;
+		}
+	}
+	return true;
+}
+
+// (offset was range checked by Walk().)
+bool IeParser::View(uint32_t offset, IeView& view) const
+{
+	view.id = m_buf[offset];
+	view.length = m_buf[offset + 1];
+	view.data = m_buf + offset + 2;
+	return true;
+}
+
+bool IeParser::Find(uint8_t id, IeView& view) const
+{
+	view = IeView();
+	if (!m_present.Has(id))
+	{
+		return false;
+	}
+	return View(m_offset[id], view);
+}
+
+bool IeParser::FindExtension(uint8_t extId, IeView& view) const
+{
+	view = IeView();
+	if (!m_extPresent.Has(extId))
+	{
+		return false;
+	}
+	View(m_extOffset[extId], view);
+	// Skip the extension ID:
+	view.data++;
+	view.length--;
+	return true;
+}
+
+bool IeParser::MinLength(uint8_t id, uint8_t minLength, IeView& view) const
+{
+	if (!Find(id, view) || view.length < minLength)
+	{
+		view = IeView();
+		return false;
+	}
+	return true;
+}
+
+bool IeParser::Ssid(IeView& view) const
+{
+	if (!Find(IeSsid, view) || view.length > 32)
+	{
+		view = IeView();
+		return false;
+	}
+	return true;
+}
+
+bool IeParser::SupportedRates(IeView& view) const
+{
+	return MinLength(IeSupportedRates, 1, view);
+}
+
+bool IeParser::ExtendedRates(IeView& view) const
+{
+	return MinLength(IeExtendedRates, 1, view);
+}
+
+bool IeParser::HtCapabilities(IeView& view) const
+{
+	return MinLength(IeHtCapabilities, 26, view);
+}
+
+bool IeParser::HtOperation(IeView& view) const
+{
+	return MinLength(IeHtOperation, 22, view);
+}
+
+bool IeParser::VhtCapabilities(IeView& view) const
+{
+	return MinLength(IeVhtCapabilities, 12, view);
+}
+
+bool IeParser::VhtOperation(IeView& view) const
+{
+	return MinLength(IeVhtOperation, 5, view);
+}
+
+// HE: MAC (6) + PHY (11) capabilities + the 80 MHz MCS map (4).
+bool IeParser::HeCapabilities(IeView& view) const
+{
+	if (!FindExtension(IeExtHeCapabilities, view) || view.length < 21)
+	{
+		view = IeView();
+		return false;
+	}
+	return true;
+}
+
+bool IeParser::HeOperation(IeView& view) const
+{
+	if (!FindExtension(IeExtHeOperation, view) || view.length < 6)
+	{
+		view = IeView();
+		return false;
+	}
+	return true;
+}
+
+bool IeParser::Rsn(IeView& view) const
+{
+	return MinLength(IeRsn, 2, view);
+}
+
+bool IeParser::Vendor(size_t index, IeView& view) const
+{
+	view = IeView();
+	if (index >= m_vendorCount)
+	{
+		return false;
+	}
+	return View(m_vendorOffset[index], view);
+}
+
+bool IeParser::FindVendor(const uint8_t oui[3], uint8_t type, IeView& view) const
+{
+	for (size_t i = 0; i < m_vendorCount; i++)
+	{
+		Vendor(i, view);
+		if (view.length >= 4 && memcmp(view.data, oui, 3) == 0 && view.data[3] == type)
+		{
+			return true;
+		}
+	}
+	view = IeView();
+	return false;
+}
@@ -0,0 +1,125 @@
+// IeParser.h
+// 802.11 Information Elements (beacon / probe response body, e.g.
+// NL80211_BSS_INFORMATION_ELEMENTS) without copying: Parse() walks the
+// TLVs once, bounds checking every length, and records where each element
+// starts in a fixed table (first occurrence per element ID, per extension
+// ID, up to MaxVendor vendor elements). Lookups are then a bitmap test and
+// an index; the IeViews point into the caller's buffer, which must outlive
+// them. No allocation anywhere, so a parser can be reused per frame.
+
+#ifndef IEPARSER_H_
+#define IEPARSER_H_
+
+#include <cstring>
+
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// Element IDs (IEEE 802.11-2020 9.4.2):
+enum IeId
+{
+	IeSsid = 0,
+	IeSupportedRates = 1,
+	IeDsParameter = 3,
+	IeTim = 5,
+	IeCountry = 7,
+	IeHtCapabilities = 45,
+	IeRsn = 48,
+	IeExtendedRates = 50,
+	IeHtOperation = 61,
+	IeExtendedCapabilities = 127,
+	IeVhtCapabilities = 191,
+	IeVhtOperation = 192,
+	IeVendor = 221,
+	IeExtension = 255
+};
+
+// Element ID Extensions (ID 255, first payload byte):
+enum IeExtId
+{
+	IeExtHeCapabilities = 35,
+	IeExtHeOperation = 36
+};
+
+// A set of element IDs (256 bits):
+class IeTagSet
+{
+public:
+	IeTagSet() { Clear(); }
+	void Clear() { m_bits[0] = m_bits[1] = m_bits[2] = m_bits[3] = 0; }
+	void Add(uint8_t id) { m_bits[id >> 6] |= (uint64_t)1 << (id & 63); }
+	bool Has(uint8_t id) const { return (m_bits[id >> 6] >> (id & 63)) & 1; }
+	// Every ID in 'other' is in this set:
+	bool Covers(const IeTagSet& other) const
+	{
+		return (other.m_bits[0] & ~m_bits[0]) == 0 && (other.m_bits[1] & ~m_bits[1]) == 0
+			&& (other.m_bits[2] & ~m_bits[2]) == 0 && (other.m_bits[3] & ~m_bits[3]) == 0;
+	}
+private:
+	uint64_t m_bits[4];
+};
+
+// Non-owning: one element's payload (after ID, length, and for extension
+// elements the extension ID).
+class IeView
+{
+public:
+	const uint8_t *data = nullptr;
+	uint8_t length = 0;
+	uint8_t id = 0;
+	bool Empty() const { return data == nullptr; }
+};
+
+class IeParser
+{
+public:
+	static const size_t MaxVendor = 16;
+	IeParser();
+	// False if a TLV runs past the end (ErrorOffset() tells where);
+	// the elements before it are still indexed.
+	bool Parse(const uint8_t *buf, size_t len);
+	// Stop as soon as every ID in 'wanted' has been seen (the rest of the
+	// buffer is then not checked for malformed TLVs).
+	bool Parse(const uint8_t *buf, size_t len, const IeTagSet& wanted);
+	size_t Count() const { return m_count; }
+	size_t ErrorOffset() const { return m_errorOffset; }
+	bool Has(uint8_t id) const { return m_present.Has(id); }
+	// First element with 'id' / extension 'extId':
+	bool Find(uint8_t id, IeView& view) const;
+	bool FindExtension(uint8_t extId, IeView& view) const;
+	// Typed lookups: also false if the element is shorter than its fixed part.
+	bool Ssid(IeView& view) const;               // 0..32 bytes
+	bool SupportedRates(IeView& view) const;
+	bool ExtendedRates(IeView& view) const;
+	bool HtCapabilities(IeView& view) const;     // >= 26
+	bool HtOperation(IeView& view) const;        // >= 22
+	bool VhtCapabilities(IeView& view) const;    // >= 12
+	bool VhtOperation(IeView& view) const;       // >= 5
+	bool HeCapabilities(IeView& view) const;     // >= 21
+	bool HeOperation(IeView& view) const;        // >= 6
+	bool Rsn(IeView& view) const;                // >= 2 (version)
+	// Vendor specific elements (OUI = first 3 payload bytes):
+	size_t VendorCount() const { return m_vendorCount; }
+	bool Vendor(size_t index, IeView& view) const;
+	// e.g., Microsoft WMM: { 0x00, 0x50, 0xf2 }, type 2
+	bool FindVendor(const uint8_t oui[3], uint8_t type, IeView& view) const;
+private:
+	bool Walk(const uint8_t *buf, size_t len, const IeTagSet *wanted);
+	bool View(uint32_t offset, IeView& view) const;
+	bool MinLength(uint8_t id, uint8_t minLength, IeView& view) const;
+	const uint8_t *m_buf = nullptr;
+	size_t m_len = 0;
+	size_t m_count = 0;
+	size_t m_errorOffset = 0;
+	// (m_offset[id] only valid if m_present.Has(id); same for ext.)
+	IeTagSet m_present;
+	IeTagSet m_extPresent;
+	uint32_t m_offset[256];
+	uint32_t m_extOffset[256];
+	uint32_t m_vendorOffset[MaxVendor];
+	size_t m_vendorCount = 0;
+};
+
+#endif  // IEPARSER_H_
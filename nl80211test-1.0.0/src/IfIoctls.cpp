@@ -258,3 +258,179 @@ bool IfIoctls::GetFrequency(const char *ifaceName,
   return true;
 }
 
+
+// ReadInterfaceStates(): Bulk read of every interface's current state.
+// getifaddrs() returns flags, IPv4 address / netmask and (AF_PACKET) MAC
+// for all interfaces at once; then ONE socket is used to ask each
+// interface for its power save setting (only wireless ifaces answer).
+bool IfIoctls::ReadInterfaceStates(InterfaceStates& states)
+{
+	struct ifaddrs *ifList;
+	struct ifaddrs *ifa;
+
+	states.clear();
+	if (getifaddrs(&ifList) < 0)
+	{
+		int myErr = errno;
+		string s("ReadInterfaceStates: getifaddrs() failed: ");
+		s += strerror(myErr);
+		LogErr(AT, s);
+		return false;
+	}
+	for (ifa = ifList; ifa != nullptr; ifa = ifa->ifa_next)
+	{
+		InterfaceState& st = states[ifa->ifa_name];
+		strncpy(st.name, ifa->ifa_name, SHX_IFNAMESIZE);
+		st.flags = ifa->ifa_flags;
+		st.isUp = (ifa->ifa_flags & IFF_UP) != 0;
+		if (ifa->ifa_addr == nullptr)
+		{
+			continue;
+		}
+		if (ifa->ifa_addr->sa_family == AF_INET && !st.hasIpv4)
+		{
+			// First IPv4 address is the one SIOCSIFADDR sets:
+			st.hasIpv4 = true;
+			st.ipAddress = ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr;
+			if (ifa->ifa_netmask != nullptr)
+			{
+				st.netmask = ((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr;
+			}
+		}
+		else if (ifa->ifa_addr->sa_family == AF_PACKET)
+		{
+			struct sockaddr_ll *sll = (struct sockaddr_ll *)ifa->ifa_addr;
+			if (sll->sll_halen == 6)
+			{
+				st.hasMac = true;
+				memcpy(st.mac, sll->sll_addr, 6);
+			}
+		}
+	}
+	freeifaddrs(ifList);
+
+	if (!Open())
+	{
+		// Flags / addresses are still good, power save is "unknown"
+		// so EnsureWirelessPowerSaveOff() will always apply.
+		return true;
+	}
+	for (auto& it : states)
+	{
+		shx_iwreq wrq;
+		memset(&wrq, 0, sizeof(shx_iwreq));
+		strncpy(wrq.ifr_name, it.first.c_str(), sizeof(wrq.ifr_name));
+		// Not an error if this fails (eth0, lo, etc. aren't wireless):
+		if (ioctl(m_fd, SHX_SIOCGIWPOWER, &wrq) == 0)
+		{
+			it.second.powerSaveKnown = true;
+			it.second.powerSaveDisabled = (wrq.u.power.disabled != 0);
+		}
+	}
+	Close();
+	return true;
+}
+
+const InterfaceState *IfIoctls::FindState(const char *ifaceName, const InterfaceStates& states)
+{
+	auto it = states.find(ifaceName);
+	if (it == states.end())
+	{
+		return nullptr;
+	}
+	return &it->second;
+}
+
+bool IfIoctls::EnsureInterfaceUp(const char *ifaceName, const InterfaceStates& states, ApplyReport& report)
+{
+	const InterfaceState *st = FindState(ifaceName, states);
+	if (st != nullptr && st->isUp)
+	{
+		report.Skipped(string("UP(") + ifaceName + ")");
+		return true;
+	}
+	if (!BringInterfaceUp(ifaceName))
+	{
+		report.Failed();
+		return false;
+	}
+	report.Applied();
+	return true;
+}
+
+bool IfIoctls::EnsureInterfaceDown(const char *ifaceName, const InterfaceStates& states, ApplyReport& report)
+{
+	const InterfaceState *st = FindState(ifaceName, states);
+	if (st != nullptr && !st->isUp)
+	{
+		report.Skipped(string("DOWN(") + ifaceName + ")");
+		return true;
+	}
+	if (!BringInterfaceDown(ifaceName))
+	{
+		report.Failed();
+		return false;
+	}
+	report.Applied();
+	return true;
+}
+
+bool IfIoctls::EnsureIpAddressAndNetmask(const char *ifaceName, const char *ipAddress,
+	const char *netmask, const InterfaceStates& states, ApplyReport& report)
+{
+	const InterfaceState *st = FindState(ifaceName, states);
+	struct in_addr wantAddr;
+	struct in_addr wantMask;
+	if (st != nullptr && st->hasIpv4
+		&& inet_aton(ipAddress, &wantAddr) != 0
+		&& inet_aton(netmask, &wantMask) != 0
+		&& st->ipAddress.s_addr == wantAddr.s_addr
+		&& st->netmask.s_addr == wantMask.s_addr)
+	{
+		report.Skipped(string("IP/NETMASK(") + ifaceName + ")");
+		return true;
+	}
+	if (!SetIpAddressAndNetmask(ifaceName, ipAddress, netmask))
+	{
+		report.Failed();
+		return false;
+	}
+	report.Applied();
+	return true;
+}
+
+bool IfIoctls::EnsureMacAddress(const char *ifaceName, const uint8_t *mac, bool isMonitorMode,
+	const InterfaceStates& states, ApplyReport& report)
+{
+	const InterfaceState *st = FindState(ifaceName, states);
+	if (st != nullptr && st->hasMac && memcmp(st->mac, mac, 6) == 0)
+	{
+		report.Skipped(string("MAC(") + ifaceName + ")");
+		return true;
+	}
+	if (!SetMacAddress(ifaceName, mac, isMonitorMode))
+	{
+		report.Failed();
+		return false;
+	}
+	report.Applied();
+	return true;
+}
+
+bool IfIoctls::EnsureWirelessPowerSaveOff(const char *ifaceName, const InterfaceStates& states,
+	ApplyReport& report)
+{
+	const InterfaceState *st = FindState(ifaceName, states);
+	if (st != nullptr && st->powerSaveKnown && st->powerSaveDisabled)
+	{
+		report.Skipped(string("POWER SAVE OFF(") + ifaceName + ")");
+		return true;
+	}
+	if (!SetWirelessPowerSaveOff(ifaceName))
+	{
+		report.Failed();
+		return false;
+	}
+	report.Applied();
+	return true;
+}
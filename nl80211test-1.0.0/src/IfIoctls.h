@@ -20,12 +20,15 @@
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <netpacket/packet.h>
 // #include <linux/wireless.h>  NO: Compile errors "redef of 'struct ifconf'
 //   -- use local version named: "ShxWireless.h" instead (below)
 #include <errno.h>
 
 // ShadowX's version of linux/wireless.h:
 #include "ShxWireless.h"
+#include "InterfaceState.h"
 #include "Log.h"
 
 using namespace std;
@@ -42,7 +45,20 @@ public:
 	bool SetMacAddress(const char *ifaceName, const uint8_t *mac, bool isMonitorMode);
 	bool SetWirelessPowerSaveOff(const char *ifaceName);
 	bool GetFrequency(const char *ifaceName, int32_t& Mantissa, int16_t& Exponent);
+	// Read-compare-apply: ReadInterfaceStates() gets flags, addresses, MAC
+	// and power save for ALL interfaces in one pass, the Ensure...() methods
+	// only issue the ioctl if the interface is not already in that state.
+	// (Interfaces missing from 'states' are always applied.)
+	bool ReadInterfaceStates(InterfaceStates& states);
+	bool EnsureInterfaceUp(const char *ifaceName, const InterfaceStates& states, ApplyReport& report);
+	bool EnsureInterfaceDown(const char *ifaceName, const InterfaceStates& states, ApplyReport& report);
+	bool EnsureIpAddressAndNetmask(const char *ifaceName, const char *ipAddress, const char *netmask,
+		const InterfaceStates& states, ApplyReport& report);
+	bool EnsureMacAddress(const char *ifaceName, const uint8_t *mac, bool isMonitorMode,
+		const InterfaceStates& states, ApplyReport& report);
+	bool EnsureWirelessPowerSaveOff(const char *ifaceName, const InterfaceStates& states, ApplyReport& report);
 private:
+	const InterfaceState *FindState(const char *ifaceName, const InterfaceStates& states);
 	bool GetFlags(const char *interfaceName, int& flags);
 	bool SetFlags(const char *interfaceName, int flags);
 	bool Open();
@@ -0,0 +1,279 @@
+// InterfaceComboSolver.cpp
+// Interface combination check and role placement, see InterfaceComboSolver.h.
+
+#include "InterfaceComboSolver.h"
+
+InterfaceComboSolver::InterfaceComboSolver() : Log("InterfaceComboSolver") { }
+
+void InterfaceComboSolver::AddPhy(const WiphyCapabilities& caps, const vector<VifRole>& existing)
+{
+	Phy phy;
+	phy.caps = caps;
+	phy.roles = existing;
+	m_phys.push_back(phy);
+}
+
+bool InterfaceComboSolver::Solve(const vector<VifRole>& wanted, VifSolution& solution)
+{
+	solution = VifSolution();
+	m_deepest = 0;
+	m_deepestReason.clear();
+	if (m_phys.empty())
+	{
+		solution.reason = "no radios";
+		return false;
+	}
+	// (Backtracking: a handful of roles over a handful of radios.)
+	if (Place(wanted, 0, solution))
+	{
+		solution.feasible = true;
+		stringstream s;
+		s << "Solve():";
+		for (const VifAssignment& a : solution.assignments)
+		{
+			s << " " << a.role.name << " (" << IfTypeName(a.role.iftype) << ") on phy" << a.phy;
+		}
+		LogInfo(s);
+		return true;
+	}
+	solution.assignments.clear();
+	solution.reason = m_deepestReason;
+	LogErr(AT, "Solve(): " + solution.reason);
+	return false;
+}
+
+bool InterfaceComboSolver::Place(const vector<VifRole>& wanted, size_t next, VifSolution& solution)
+{
+	if (next == wanted.size())
+	{
+		return true;
+	}
+	const VifRole& role = wanted[next];
+	stringstream why;
+	why << "no radio can take " << role.name << " (" << IfTypeName(role.iftype) << ")";
+	if (!solution.assignments.empty())
+	{
+		why << " next to";
+		for (const VifAssignment& a : solution.assignments)
+		{
+			why << " " << a.role.name << "@phy" << a.phy;
+		}
+	}
+	why << ":";
+	for (Phy& phy : m_phys)
+	{
+		why << " phy" << phy.caps.phy << ": ";
+		if (role.phy != VifRole::AnyPhy && role.phy != (int64_t)phy.caps.phy)
+		{
+			why << "not the pinned radio;";
+			continue;
+		}
+		phy.roles.push_back(role);
+		string reason;
+		if (Allows(phy.caps, phy.roles, reason))
+		{
+			VifAssignment a;
+			a.role = role;
+			a.phy = phy.caps.phy;
+			solution.assignments.push_back(a);
+			if (Place(wanted, next + 1, solution))
+			{
+				phy.roles.pop_back();
+				return true;
+			}
+			solution.assignments.pop_back();
+			why << "fits, but the rest then doesn't;";
+		}
+		else
+		{
+			why << reason << ";";
+		}
+		phy.roles.pop_back();
+	}
+	if (m_deepestReason.empty() || next > m_deepest)
+	{
+		m_deepest = next;
+		m_deepestReason = why.str();
+		m_deepestReason.pop_back();  // (Last ';')
+	}
+	return false;
+}
+
+bool InterfaceComboSolver::Allows(const WiphyCapabilities& caps, const vector<VifRole>& roles,
+	string& reason)
+{
+	uint32_t count[32] = { 0 };
+	uint32_t used = 0;
+	uint32_t total = 0;
+	uint32_t channels = 0;
+	for (const VifRole& r : roles)
+	{
+		if (r.iftype >= 32 || !caps.Supports(r.iftype))
+		{
+			reason = IfTypeName(r.iftype) + " not supported (has " + IfTypeMaskString(caps.supportedTypes) + ")";
+			return false;
+		}
+		if (caps.IsSoftware(r.iftype))
+		{
+			continue;
+		}
+		count[r.iftype]++;
+		used |= 1u << r.iftype;
+		total++;
+		if (r.ownChannel)
+		{
+			channels++;
+		}
+	}
+	channels = max(channels, 1u);
+	// (No combination needed for a single interface, software ones aside.)
+	if (total <= 1)
+	{
+		return true;
+	}
+	stringstream wanted;
+	for (uint32_t t = 0; t < 32; t++)
+	{
+		if (count[t])
+		{
+			wanted << (wanted.tellp() > 0 ? " + " : "") << count[t] << " " << IfTypeName(t);
+		}
+	}
+	if (caps.combinations.empty())
+	{
+		reason = "one interface at a time (no interface combinations), wants " + wanted.str();
+		return false;
+	}
+	uint32_t mostInterfaces = 0;
+	uint32_t mostChannels = 0;
+	for (const IfaceCombination& c : caps.combinations)
+	{
+		mostInterfaces = max(mostInterfaces, c.maxInterfaces);
+		mostChannels = max(mostChannels, c.numChannels);
+		if (total > c.maxInterfaces || channels > c.numChannels)
+		{
+			continue;
+		}
+		// (As cfg80211: each type's count comes off every limit that
+		// lists the type, and every type used must be in some limit.)
+		vector<uint32_t> room;
+		uint32_t all = 0;
+		for (const IfaceLimit& l : c.limits)
+		{
+			room.push_back(l.max);
+			all |= l.types;
+		}
+		bool fits = (all & used) == used;
+		for (uint32_t t = 0; t < 32 && fits; t++)
+		{
+			if (count[t] == 0)
+			{
+				continue;
+			}
+			for (size_t j = 0; j < c.limits.size(); j++)
+			{
+				if ((c.limits[j].types & (1u << t)) == 0)
+				{
+					continue;
+				}
+				if (room[j] < count[t])
+				{
+					fits = false;
+					break;
+				}
+				room[j] -= count[t];
+			}
+		}
+		if (fits)
+		{
+			return true;
+		}
+	}
+	stringstream s;
+	if (total > mostInterfaces)
+	{
+		s << total << " interfaces, at most " << mostInterfaces << " (" << wanted.str() << ")";
+	}
+	else if (channels > mostChannels)
+	{
+		s << channels << " channels, at most " << mostChannels << " (" << wanted.str() << ")";
+	}
+	else
+	{
+		s << "no interface combination allows " << wanted.str();
+		if (channels > 1)
+		{
+			s << " on " << channels << " channels";
+		}
+	}
+	reason = s.str();
+	return false;
+}
+
+string InterfaceComboSolver::IfTypeName(uint32_t iftype)
+{
+	switch (iftype)
+	{
+		case NL80211_IFTYPE_ADHOC:
+			return "ad hoc";
+		case NL80211_IFTYPE_STATION:
+			return "station";
+		case NL80211_IFTYPE_AP:
+			return "AP";
+		case NL80211_IFTYPE_AP_VLAN:
+			return "AP VLAN";
+		case NL80211_IFTYPE_WDS:
+			return "WDS";
+		case NL80211_IFTYPE_MONITOR:
+			return "monitor";
+		case NL80211_IFTYPE_MESH_POINT:
+			return "mesh point";
+		case NL80211_IFTYPE_P2P_CLIENT:
+			return "P2P client";
+		case NL80211_IFTYPE_P2P_GO:
+			return "P2P GO";
+		case NL80211_IFTYPE_P2P_DEVICE:
+			return "P2P device";
+		case NL80211_IFTYPE_OCB:
+			return "OCB";
+		case NL80211_IFTYPE_NAN:
+			return "NAN";
+		default:
+			return "iftype " + to_string(iftype);
+	}
+}
+
+string InterfaceComboSolver::IfTypeMaskString(uint32_t mask)
+{
+	string s;
+	for (uint32_t t = 0; t < 32; t++)
+	{
+		if (mask & (1u << t))
+		{
+			s += (s.empty() ? "" : ", ") + IfTypeName(t);
+		}
+	}
+	return s.empty() ? "none" : s;
+}
+
+string InterfaceComboSolver::Describe(const WiphyCapabilities& caps)
+{
+	stringstream s;
+	s << "phy" << caps.phy << ": " << IfTypeMaskString(caps.supportedTypes)
+		<< "; software: " << IfTypeMaskString(caps.softwareTypes) << "; combinations:";
+	if (caps.combinations.empty())
+	{
+		s << " none (one interface at a time)";
+	}
+	for (const IfaceCombination& c : caps.combinations)
+	{
+		s << " {";
+		for (size_t j = 0; j < c.limits.size(); j++)
+		{
+			s << (j ? ", " : "") << "<= " << c.limits[j].max << " of "
+				<< IfTypeMaskString(c.limits[j].types);
+		}
+		s << "; <= " << c.maxInterfaces << " total, " << c.numChannels << " channel(s)}";
+	}
+	return s.str();
+}
@@ -0,0 +1,110 @@
+// InterfaceComboSolver.h
+// Will a radio take another interface? Answered from what the driver
+// advertises (WiphyCapabilities: supported / software interface types,
+// interface combinations, Nl80211WiphyReader) instead of by trying:
+// a create that can't work costs a failed NEW_INTERFACE at best and a
+// wait for an interface that never appears at worst.
+// Given the interfaces already on each radio and the ones wanted (AP,
+// station, monitor, ... each optionally pinned to a radio), Solve()
+// finds a radio for every wanted one, radios tried in the order they
+// were added, or says precisely why there is none.
+// The check is cfg80211's (cfg80211_check_combinations()): software
+// types (mac80211: monitor) don't count, one interface always fits,
+// more need one combination that has room for all of them. Full MAC
+// drivers check it when an interface is created, mac80211 when it goes
+// UP: either way, not fitting means not working.
+
+#ifndef INTERFACECOMBOSOLVER_H_
+#define INTERFACECOMBOSOLVER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+#include "Nl80211InterfaceAdmin.h"
+#include "WiphyInfo.h"
+
+using namespace std;
+
+// One interface, wanted or already there.
+class VifRole
+{
+public:
+	static const int64_t AnyPhy = -1;
+	string name;               // (For the reasons: "wpa0", "wlan1", ...)
+	uint32_t iftype = NL80211_IFTYPE_STATION;  // enum nl80211_iftype
+	// Needs a channel of its own (a STA following an outside AP while
+	// our AP stays put); otherwise it shares the radio's channel:
+	bool ownChannel = false;
+	int64_t phy = AnyPhy;      // Wanted ones: only on this radio
+	VifRole() { }
+	VifRole(const string& roleName, uint32_t type, bool needsOwnChannel = false)
+		: name(roleName), iftype(type), ownChannel(needsOwnChannel) { }
+	VifRole(const string& roleName, InterfaceType type, bool needsOwnChannel = false)
+		: name(roleName), iftype(IfTypeOf(type)), ownChannel(needsOwnChannel) { }
+	static uint32_t IfTypeOf(InterfaceType type)
+	{
+		switch (type)
+		{
+			case InterfaceType::Ap:
+				return NL80211_IFTYPE_AP;
+			case InterfaceType::Monitor:
+				return NL80211_IFTYPE_MONITOR;
+			default:
+				return NL80211_IFTYPE_STATION;
+		}
+	}
+};
+
+class VifAssignment
+{
+public:
+	VifRole role;
+	uint32_t phy = 0;
+};
+
+class VifSolution
+{
+public:
+	bool feasible = false;
+	vector<VifAssignment> assignments;  // (Wanted roles, in order)
+	string reason;                      // Why not (feasible false)
+};
+
+class InterfaceComboSolver : protected Log
+{
+public:
+	InterfaceComboSolver();
+	// Radios in order of preference, each with the interfaces that stay
+	// on it (types as they will be, e.g. the AP's interface as AP even
+	// if hostapd hasn't switched it yet):
+	void AddPhy(const WiphyCapabilities& caps, const vector<VifRole>& existing);
+	bool Solve(const vector<VifRole>& wanted, VifSolution& solution);
+	// One radio running all of 'roles' at once? If not, why:
+	static bool Allows(const WiphyCapabilities& caps, const vector<VifRole>& roles,
+		string& reason);
+	static string IfTypeName(uint32_t iftype);
+	static string IfTypeMaskString(uint32_t mask);
+	// Supported / software types and combinations, one line:
+	static string Describe(const WiphyCapabilities& caps);
+private:
+	class Phy
+	{
+	public:
+		WiphyCapabilities caps;
+		vector<VifRole> roles;  // Existing + placed so far
+	};
+	bool Place(const vector<VifRole>& wanted, size_t next, VifSolution& solution);
+	vector<Phy> m_phys;
+	// Deepest point the search got stuck, and why:
+	size_t m_deepest = 0;
+	string m_deepestReason;
+};
+
+#endif  // INTERFACECOMBOSOLVER_H_
@@ -4,6 +4,9 @@
 
 // Global static pointer used to ensure a single instance of the class:
 InterfaceManagerNl80211* InterfaceManagerNl80211::m_pInstance = NULL; 
+// VIFs we create are named this + a number:
+const char *InterfaceManagerNl80211::m_vifPrefix = "wpa";
+const char *InterfaceManagerNl80211::m_vifRecordPath = "/var/run/nl80211test-vifs";
 
 InterfaceManagerNl80211::InterfaceManagerNl80211() : Nl80211InterfaceAdmin("InterfaceManagerNl80211")
 {
@@ -62,7 +65,7 @@ InterfaceManagerNl80211* InterfaceManagerNl80211::GetInstance()
 // IMPORTANT:
 // We MUST set power save mode off
 // on NEWLY ADDED interfaces AS WELL [in CreateInterfaces()]!
-bool InterfaceManagerNl80211::Init()
+bool InterfaceManagerNl80211::Init(bool strictPhyCountCheck)
 {
 	if (!GetInterfaceList())
 	{
@@ -70,15 +73,28 @@ bool InterfaceManagerNl80211::Init()
 		return false;
 	}
 LogInterfaceList("Init() interfaces found");
+	// VIFs left from an earlier run (crash or kill, and created without
+	// SOCKET_OWNER) used to mean "reboot required" below; the daemon
+	// (only) deletes them, all in one batch, and carries on with what's
+	// left:
+	if (m_sweepStaleVifs && SweepStaleInterfaces())
+	{
+		if (!GetInterfaceList())
+		{
+			LogErr(AT, "InterfaceManagerNl80211::Init() can't re-read Interface List");
+			return false;
+		}
+		LogInterfaceList("Init() interfaces after sweep");
+	}
 	
 	// Create a vector<(uint32_t)PhyId> from m_interfaces.
 	// This should have a count of two when done,
 	// (means we have two physical devices)
 	// or return false (ERROR, # of physical devices NOT two).
 	vector<uint32_t>phys;
-	for (OneInterface* i : m_interfaces)
+	for (const OneInterface& i : InterfaceSnapshot())
 	{
-		uint32_t phyId = i->phy;
+		uint32_t phyId = i.phy;
 		auto it = find(phys.begin(), phys.end(), phyId);
 		if (it == phys.end())
 		{
@@ -106,26 +122,21 @@ LogInterfaceList("Init() interfaces found");
 	// If an Interface is already UP, then this fails.
 	// LATER: Changes to kernel setup (Power Mgmt disabled)
 	//   make this not as important.
-	for (OneInterface* i : m_interfaces)
+	// Read every interface's current state first (in bulk) and only
+	// touch the ones that are not already DOWN / power save off; on a
+	// restart where nothing changed this skips everything.
+	InterfaceStates states;
+	ApplyReport report;
+	if (!m_ifIoctls.ReadInterfaceStates(states))
 	{
-		// main() has killed any apps (wpa_supplicant, hostapd, etc.)
-		// Bring all the wireless interfaces DOWN. hostapd brings
-		// its interface up automatically in AP mode.
-		if (!m_ifIoctls.BringInterfaceDown(i->name))
-		{
-			string s("InterfaceManagerNl80211.Init(): BringIface DOWN(");
-			s += i->name;
-			s += ") failed, continuing anyway.";
-			LogErr(AT, s);
-		}
-		if (!m_ifIoctls.SetWirelessPowerSaveOff(i->name))
-		{
-			string s("InterfaceManagerNl80211.Init(): SetWirelessPowerSaveOff(");
-			s += i->name;
-			s += ") failed, continuing anyway.";
-			LogErr(AT, s);
-		}
+		LogErr(AT, "Init(): Can't read interface states, applying all settings.");
 	}
+	// main() has killed any apps (wpa_supplicant, hostapd, etc.)
+	// Bring all the wireless interfaces DOWN. hostapd brings
+	// its interface up automatically in AP mode.
+	PrepareInterfaces(states, report);
+	report.Finish();
+	LogInfo(string("Init() interface preparation: ") + report.Summary());
 	// Fills m_builtinInterfaces and m_externalInterfaces (vectors)
 	// These lists will be invalid once we add / change Interfaces...
 	if (!CategorizeInterfaceList())
@@ -153,7 +164,22 @@ LogInterfaceList("Init() interfaces found");
 		retVal = false;
 	}
 
-	if (m_externalInterfaces.size() == 1)
+	// One VIF per USB radio; more than one USB radio is fine, each one
+	// is a capture radio (HopCoordinator splits the channels between them).
+	// The first is the monitor/survey interface (and hosts wpa0).
+	m_monNames.clear();
+	vector<uint32_t> externalPhys;
+	for (OneInterface *i : m_externalInterfaces)
+	{
+		if (find(externalPhys.begin(), externalPhys.end(), i->phy) != externalPhys.end())
+		{
+			externalPhys.clear();
+			break;
+		}
+		externalPhys.push_back(i->phy);
+		m_monNames.push_back(i->name);
+	}
+	if (!externalPhys.empty())
 	{
 		// This will be the monitor/survey interface name:
 		oneIface = m_externalInterfaces[0];
@@ -161,8 +187,9 @@ LogInterfaceList("Init() interfaces found");
 	}
 	else
 	{
-		LogErr(AT, "Number of USB radio VIFs is not one, reboot required.");
+		LogErr(AT, "Number of VIFs per USB radio is not one, reboot required.");
 		strcpy(m_monName, "UNK");
+		m_monNames.clear();
 		retVal = false;
 	}
 
@@ -173,11 +200,118 @@ LogInterfaceList("Init() interfaces found");
 
 	stringstream s;
 	s << "AP interface name: [" << m_apName << "], Monitor interface name: [" << m_monName << "]";
+	if (m_monNames.size() > 1)
+	{
+		s << ", " << m_monNames.size() << " capture radios";
+	}
 	LogInfo(s);
 	
 	return retVal;
 }
 
+// PrepareInterfaces(): One bad USB radio used to hold up startup for
+// everybody; now each phy is prepared on its own worker thread (at most
+// m_maxPrepWorkers), so Init() takes about as long as the slowest radio.
+// Interfaces on the SAME phy are still done in order, one after the
+// other (see the wlcore ordering warnings below).
+void InterfaceManagerNl80211::PrepareInterfaces(const InterfaceStates& states, ApplyReport& report)
+{
+	// Group by phy, keeping m_interfaces order inside each group:
+	// (Only this thread clears the list, the entries outlive the workers;
+	// they read the name and phy, which the channel cache never changes.)
+	map<uint32_t, vector<OneInterface *>> byPhy;
+	{
+		lock_guard<mutex> lock(m_interfacesMutex);
+		for (OneInterface* i : m_interfaces)
+		{
+			byPhy[i->phy].push_back(i);
+		}
+	}
+	vector<vector<OneInterface *>> groups;
+	vector<size_t> firstResult;
+	size_t count = 0;
+	for (auto& it : byPhy)
+	{
+		groups.push_back(it.second);
+		firstResult.push_back(count);
+		count += it.second.size();
+	}
+	// Each worker writes only its own slots, no locking needed:
+	m_prepReport.clear();
+	m_prepReport.resize(count);
+	vector<ApplyReport> reports(groups.size());
+
+	auto startTime = steady_clock::now();
+	atomic<size_t> next(0);
+	auto worker = [&]()
+	{
+		size_t g;
+		while ((g = next++) < groups.size())
+		{
+			PreparePhy(groups[g], states, reports[g], m_prepReport, firstResult[g]);
+		}
+	};
+	size_t numWorkers = min((size_t)m_maxPrepWorkers, groups.size());
+	vector<thread> workers;
+	for (size_t w = 1; w < numWorkers; w++)
+	{
+		workers.push_back(thread(worker));
+	}
+	// This thread is worker #0:
+	worker();
+	for (thread& t : workers)
+	{
+		t.join();
+	}
+	milliseconds wall = duration_cast<milliseconds>(steady_clock::now() - startTime);
+
+	milliseconds sum(0);
+	for (const InterfacePrepResult& r : m_prepReport)
+	{
+		stringstream s;
+		s << "Prepare [" << r.name << "] phy " << r.phy << ": DOWN "
+			<< (r.downOk ? "ok" : "FAILED") << ", power save off "
+			<< (r.powerSaveOk ? "ok" : "FAILED") << ", "
+			<< r.elapsed.count() << " ms";
+		LogInfo(s);
+		if (!r.downOk || !r.powerSaveOk)
+		{
+			string e("InterfaceManagerNl80211.Init(): preparing [");
+			e += r.name;
+			e += "] failed, continuing anyway.";
+			LogErr(AT, e);
+		}
+		sum += r.elapsed;
+	}
+	for (const ApplyReport& r : reports)
+	{
+		report.Merge(r);
+	}
+	stringstream s;
+	s << "PrepareInterfaces(): " << groups.size() << " phys on " << numWorkers
+		<< " workers, " << wall.count() << " ms (serial would be ~" << sum.count() << " ms)";
+	LogInfo(s);
+}
+
+// (static) Runs on a worker thread; uses its own IfIoctls (m_fd per instance).
+void InterfaceManagerNl80211::PreparePhy(const vector<OneInterface *>& ifaces,
+	const InterfaceStates& states, ApplyReport& report,
+	vector<InterfacePrepResult>& results, size_t firstResult)
+{
+	IfIoctls ifIoctls;
+	for (size_t j = 0; j < ifaces.size(); j++)
+	{
+		OneInterface *i = ifaces[j];
+		InterfacePrepResult& r = results[firstResult + j];
+		auto startTime = steady_clock::now();
+		r.name = i->name;
+		r.phy = i->phy;
+		r.downOk = ifIoctls.EnsureInterfaceDown(i->name, states, report);
+		r.powerSaveOk = ifIoctls.EnsureWirelessPowerSaveOff(i->name, states, report);
+		r.elapsed = duration_cast<milliseconds>(steady_clock::now() - startTime);
+	}
+}
+
 // Normally, m_interfaces has just two entries:
 //   "wlan0" interface info and "wlan1" interface info, and
 //   this will return a single interface: "wlan0" most of the time
@@ -186,6 +320,7 @@ LogInterfaceList("Init() interfaces found");
 bool InterfaceManagerNl80211::CategorizeInterfaceList()
 {
 	bool found = false;
+	lock_guard<mutex> lock(m_interfacesMutex);
 	for (OneInterface* i : m_interfaces)
 	{
 		// TI chip's MAC addres all start with these 3 bytes (the "OUI"):
@@ -208,6 +343,7 @@ bool InterfaceManagerNl80211::CategorizeInterfaceList()
 bool InterfaceManagerNl80211::GetInterfaceByPhyAndName(uint32_t phyId,
 	const char *name, OneInterface **iface)
 {
+	lock_guard<mutex> lock(m_interfacesMutex);
 	for (OneInterface* i : m_interfaces)
 	{
 		if (i->phy == phyId &&
@@ -372,11 +508,32 @@ LogInterfaceList("CreateInterfaces Entry");
 	// The driver ignores our proposed name for a new Virtual Interface
 	//   so we have to deduce what it assigned by re-reading interface list.
 	vector<string> origIfaces;
-	for (OneInterface *i : m_interfaces)
+	for (const OneInterface& i : InterfaceSnapshot())
 	{
-		origIfaces.push_back(i->name);
+		origIfaces.push_back(i.name);
 	}
-	if (!CreateStationInterface("wpa0", phyId))
+	// Ask the drivers first: a radio that can't have a second interface
+	// fails the create, or worse, never shows the interface (5 s below).
+	if (!PlanStationInterface(phyId))
+	{
+		strcpy(m_wpaName, "UNK");
+		LogErr(AT, "CreateInterfaces(): no radio can host the wpa_supplicant interface.");
+		return false;
+	}
+	// Socket owned: gone the moment we are, nothing for the next Init()
+	// to trip over (recorded anyway, for kernels without SOCKET_OWNER).
+	string vifName = string(m_vifPrefix) + "0";
+	bool created;
+	if (m_socketOwnedVifs)
+	{
+		created = m_vifOwner.OpenConnection()
+			&& m_vifOwner.CreateOwnedInterface(vifName.c_str(), phyId, InterfaceType::Station);
+	}
+	else
+	{
+		created = CreateStationInterface(vifName.c_str(), phyId);
+	}
+	if (!created)
 	{
 		LogErr(AT, "Couldn't create wpa_supplicant interface");
 		return false;
@@ -394,7 +551,7 @@ LogInterfaceList("CreateInterfaces Entry");
 			LogErr(AT, "CreateInterfaces(): Can't re-read Interface List (1).");
 			return false;
 		}
-		if (m_interfaces.size() != origIfaces.size())
+		if (InterfaceSnapshot().size() != origIfaces.size())
 		{
 			found = true;
 		}
@@ -413,17 +570,18 @@ LogInterfaceList("CreateInterfaces Entry");
 	} while (!found);
 	LogInterfaceList("CreateInterfaces Part II");
 	// Find the new interface in m_interfaces list:
-	for (OneInterface *i : m_interfaces)
+	for (const OneInterface& i : InterfaceSnapshot())
 	{
-		string name = i->name;
+		string name = i.name;
 		auto it = find(origIfaces.begin(), origIfaces.end(), name);
 		if (it == origIfaces.end())
 		{
 			// This interface is NEW...
 			// It is usually a weird name like "wlx000e8e719b18"
-			strncpy(m_wpaName, i->name, 16);
+			strncpy(m_wpaName, i.name, 16);
 		}
 	}
+	RecordVif(m_wpaName);
 	string info("wpa_supplicant should use interface [");
 	info += m_wpaName;
 	info += "]";
@@ -445,15 +603,332 @@ LogInterfaceList("CreateInterfaces Entry");
 	// Put the monitor interface into monitor mode, and we're done:
 	// bool SetInterfaceMode(const char *interfaceName, InterfaceType itype);
 	// itype: InterfaceType::Station, ::Ap, ::Monitor
-	if (!SetInterfaceMode((const char *)m_monName, InterfaceType::Monitor))
+	// (m_interfaces was just re-read, skip this if already in monitor mode.)
+	ApplyReport report;
+	if (!EnsureInterfaceMode((const char *)m_monName, InterfaceType::Monitor, report))
 	{
 		LogErr(AT, "Can't set mon interface to MONITOR mode");
 		return false;
 	}
+	// Any other capture radios; one that won't go into monitor mode is
+	// just left out (HopCoordinator works with the rest):
+	for (size_t n = 1; n < m_monNames.size(); n++)
+	{
+		if (!EnsureInterfaceMode(m_monNames[n].c_str(), InterfaceType::Monitor, report))
+		{
+			LogErr(AT, "Can't set capture interface " + m_monNames[n] + " to MONITOR mode, dropped.");
+			m_monNames.erase(m_monNames.begin() + n);
+			n--;
+		}
+	}
+	// Cut what the kernel passes up at the source (flags only, no mode
+	// switch; a driver that won't take them still captures, just more):
+	for (const string& name : m_monNames)
+	{
+		if (SetMonitorOptions(name.c_str(), m_captureMonitorOptions))
+		{
+			report.Applied();
+		}
+		else
+		{
+			LogErr(AT, "Can't set monitor options on " + name + ", using the kernel's default.");
+		}
+	}
+	report.Finish();
+	LogInfo(string("CreateInterfaces(): ") + report.Summary());
 	// We're not setting AP's MAC address or anything else FOR NOW.
 	return true;
 }
 
+bool InterfaceManagerNl80211::PlanStationInterface(uint32_t& phyId)
+{
+	Nl80211WiphyReader reader;
+	vector<WiphyCapabilities> caps;
+	if (!reader.GetAllWiphyCapabilities(caps) || caps.empty())
+	{
+		LogErr(AT, "PlanStationInterface(): can't read interface combinations, trying anyway.");
+		return true;
+	}
+	// Radios in order of preference: the USB radios (as before, the
+	// first one first), then the built-in one.
+	vector<uint32_t> phys;
+	for (OneInterface *i : m_externalInterfaces)
+	{
+		if (find(phys.begin(), phys.end(), i->phy) == phys.end())
+		{
+			phys.push_back(i->phy);
+		}
+	}
+	for (OneInterface *i : m_builtinInterfaces)
+	{
+		if (find(phys.begin(), phys.end(), i->phy) == phys.end())
+		{
+			phys.push_back(i->phy);
+		}
+	}
+	InterfaceComboSolver solver;
+	for (uint32_t phy : phys)
+	{
+		const WiphyCapabilities *c = nullptr;
+		for (const WiphyCapabilities& w : caps)
+		{
+			if (w.phy == phy)
+			{
+				c = &w;
+			}
+		}
+		if (c == nullptr)
+		{
+			stringstream s;
+			s << "PlanStationInterface(): phy" << phy << " not in the wiphy dump, left out.";
+			LogErr(AT, s);
+			continue;
+		}
+		LogInfo(InterfaceComboSolver::Describe(*c));
+		// What this radio will be running (the AP's interface as an AP,
+		// capture radios in monitor mode, anything else as it is):
+		vector<VifRole> existing;
+		for (const OneInterface& i : InterfaceSnapshot())
+		{
+			if (i.phy != phy)
+			{
+				continue;
+			}
+			uint32_t type = i.iftype;
+			if (strcmp(i.name, m_apName) == 0)
+			{
+				type = NL80211_IFTYPE_AP;
+			}
+			else if (find(m_monNames.begin(), m_monNames.end(), string(i.name)) != m_monNames.end())
+			{
+				type = NL80211_IFTYPE_MONITOR;
+			}
+			existing.push_back(VifRole(i.name, type));
+		}
+		solver.AddPhy(*c, existing);
+	}
+	vector<VifRole> wanted;
+	wanted.push_back(VifRole("wpa0", InterfaceType::Station));
+	VifSolution solution;
+	if (!solver.Solve(wanted, solution))
+	{
+		// (Solve() logged why.)
+		return false;
+	}
+	if (solution.assignments[0].phy != phyId)
+	{
+		stringstream s;
+		s << "PlanStationInterface(): phy" << phyId << " can't take the STA VIF, using phy"
+			<< solution.assignments[0].phy;
+		LogInfo(s);
+		phyId = solution.assignments[0].phy;
+	}
+	return true;
+}
+
+// This boot's id: a record from another boot is all gone (and its
+// ifindexes may have been handed out again).
+string InterfaceManagerNl80211::BootId()
+{
+	char id[64] = { 0 };
+	int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+	if (fd >= 0)
+	{
+		if (read(fd, id, sizeof(id) - 1) < 0)
+		{
+			id[0] = 0;
+		}
+		close(fd);
+	}
+	string s(id);
+	while (!s.empty() && isspace((unsigned char)s.back()))
+	{
+		s.pop_back();
+	}
+	return s;
+}
+
+string InterfaceManagerNl80211::VifRecordLine(const string& bootId, const OneInterface *iface)
+{
+	stringstream s;
+	s << bootId << " " << iface->ifIndex << " " << iface->name;
+	return s.str();
+}
+
+// Ours for as long as we run (the kernel drops the lock when we exit,
+// crash and kill -9 included). False: another instance is running.
+bool InterfaceManagerNl80211::LockVifRecord()
+{
+	if (m_vifRecordFd >= 0)
+	{
+		return true;
+	}
+	int fd = open(m_vifRecordPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		LogErr(AT, string("LockVifRecord(): can't open ") + m_vifRecordPath + ": " + strerror(errno));
+		return false;
+	}
+	if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+	{
+		LogInfo(string("LockVifRecord(): ") + m_vifRecordPath + " is held by a running instance.");
+		close(fd);
+		return false;
+	}
+	m_vifRecordFd = fd;
+	return true;
+}
+
+void InterfaceManagerNl80211::ReadVifRecord(vector<string>& lines)
+{
+	lines.clear();
+	string text;
+	char buf[512];
+	ssize_t n;
+	off_t offset = 0;
+	while ((n = pread(m_vifRecordFd, buf, sizeof(buf), offset)) > 0)
+	{
+		text.append(buf, n);
+		offset += n;
+	}
+	stringstream s(text);
+	string line;
+	while (getline(s, line))
+	{
+		if (!line.empty())
+		{
+			lines.push_back(line);
+		}
+	}
+}
+
+void InterfaceManagerNl80211::WriteVifRecord(const vector<string>& lines)
+{
+	string text;
+	for (const string& line : lines)
+	{
+		text += line + "\n";
+	}
+	if (ftruncate(m_vifRecordFd, 0) != 0
+		|| pwrite(m_vifRecordFd, text.data(), text.size(), 0) != (ssize_t)text.size())
+	{
+		LogErr(AT, string("WriteVifRecord(): can't write ") + m_vifRecordPath);
+	}
+}
+
+// A VIF we just created (and found in m_interfaces under 'name').
+void InterfaceManagerNl80211::RecordVif(const char *name)
+{
+	string bootId = BootId();
+	if (bootId.empty() || !LockVifRecord())
+	{
+		LogErr(AT, string("RecordVif(): [") + name + "] not recorded, no sweep will remove it.");
+		return;
+	}
+	for (const OneInterface& i : InterfaceSnapshot())
+	{
+		if (strcmp(i.name, name) == 0)
+		{
+			vector<string> lines;
+			ReadVifRecord(lines);
+			lines.push_back(VifRecordLine(bootId, &i));
+			WriteVifRecord(lines);
+			return;
+		}
+	}
+}
+
+// Only VIFs in the record of an instance that is gone (we got its lock)
+// and still there as they were created: same boot, ifindex and name (a
+// radio's own interface is never in it, a name or ifindex handed out
+// again doesn't match both). Never the only interface of a radio either:
+// taking the last one down unloads the TI firmware (see
+// CreateInterfaces()).
+bool InterfaceManagerNl80211::SweepStaleInterfaces()
+{
+	string bootId = BootId();
+	if (bootId.empty())
+	{
+		LogErr(AT, "SweepStaleInterfaces(): no boot id, can't tell our VIFs, not sweeping.");
+		return false;
+	}
+	if (m_vifRecordFd >= 0)
+	{
+		// (Init() again: what's in the record is ours and in use.)
+		return false;
+	}
+	if (!LockVifRecord())
+	{
+		// (Its VIFs are alive and in use.)
+		LogInfo("SweepStaleInterfaces(): another instance is running, not sweeping.");
+		return false;
+	}
+	vector<string> recorded;
+	ReadVifRecord(recorded);
+	vector<string> stale;
+	vector<string> kept;
+	vector<OneInterface> interfaces = InterfaceSnapshot();
+	for (const OneInterface& i : interfaces)
+	{
+		string line = VifRecordLine(bootId, &i);
+		if (find(recorded.begin(), recorded.end(), line) == recorded.end())
+		{
+			continue;
+		}
+		size_t onPhy = 0;
+		for (const OneInterface& j : interfaces)
+		{
+			if (j.phy == i.phy)
+			{
+				onPhy++;
+			}
+		}
+		if (onPhy < 2)
+		{
+			LogErr(AT, string("SweepStaleInterfaces(): [") + i.name
+				+ "] is its radio's only interface, left alone.");
+			kept.push_back(line);
+			continue;
+		}
+		stale.push_back(i.name);
+	}
+	// (What's not there any more, or from another boot, is dropped.)
+	WriteVifRecord(kept);
+	if (stale.empty())
+	{
+		return false;
+	}
+	auto startTime = steady_clock::now();
+	size_t deleted;
+	DeleteInterfaces(stale, deleted);
+	milliseconds elapsed = duration_cast<milliseconds>(steady_clock::now() - startTime);
+	stringstream s;
+	s << "SweepStaleInterfaces(): " << deleted << " of " << stale.size()
+		<< " leftover VIF(s) deleted in " << elapsed.count() << " ms";
+	LogInfo(s);
+	return deleted > 0;
+}
+
+void InterfaceManagerNl80211::SetSocketOwnedInterfaces(bool socketOwned)
+{
+	m_socketOwnedVifs = socketOwned;
+}
+
+void InterfaceManagerNl80211::SetSweepStaleInterfaces(bool sweep)
+{
+	m_sweepStaleVifs = sweep;
+}
+
+void InterfaceManagerNl80211::ReleaseOwnedInterfaces()
+{
+	m_vifOwner.CloseConnection();
+}
+
+void InterfaceManagerNl80211::SetCaptureMonitorOptions(const MonitorOptions& options)
+{
+	m_captureMonitorOptions = options;
+}
+
 const char *InterfaceManagerNl80211::GetMonitorInterfaceName()
 {
 	// Called by Survey's ChannelChange->ChannelSetter class.
@@ -464,6 +939,16 @@ const char *InterfaceManagerNl80211::GetMonitorInterfaceName()
 	return m_monName;
 }
 
+void InterfaceManagerNl80211::GetMonitorInterfaceNames(vector<string>& names)
+{
+	names = m_monNames;
+}
+
+const vector<InterfacePrepResult>& InterfaceManagerNl80211::GetPrepReport()
+{
+	return m_prepReport;
+}
+
 const char *InterfaceManagerNl80211::GetApInterfaceName()
 {
 	return m_apName;
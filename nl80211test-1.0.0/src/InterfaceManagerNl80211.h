@@ -8,21 +8,31 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <map>
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <atomic>
 
 #include <cstring>
 #include <cstdlib>
+#include <cctype>
 #include <ctime>
 
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
 
 #include "Log.h"
 #include "ShxWireless.h"
 #include "OneInterface.h"
 #include "Nl80211InterfaceAdmin.h"
+#include "Nl80211VifOwner.h"
 #include "IfIoctls.h"
+#include "InterfaceState.h"
+#include "Nl80211WiphyReader.h"
+#include "InterfaceComboSolver.h"
 
 // This is no longer based upon Interface Manager Interface.
 // The Interface class was mostly empty, and the whole idea
@@ -34,6 +44,18 @@
 using namespace std;
 using namespace chrono;
 
+// Init() prepares each phy's interfaces on a worker thread,
+// one of these per interface:
+class InterfacePrepResult
+{
+public:
+	string name;
+	uint32_t phy = 0;
+	bool downOk = false;
+	bool powerSaveOk = false;
+	milliseconds elapsed = milliseconds(0);
+};
+
 class InterfaceManagerNl80211 : public Nl80211InterfaceAdmin
 {
 public:
@@ -52,8 +74,29 @@ public:
 	//   up a Virtual Interface under wlan1 (0);
 	//   LEAVE THE NAME THAT IT COMES UP AS ALONE!
 	const char *GetMonitorInterfaceName();
+	// Every capture radio's interface (one per USB radio phy), the
+	// monitor interface above first:
+	void GetMonitorInterfaceNames(vector<string>& names);
 	const char *GetApInterfaceName();
 	const char *GetWpaSupplicantInterfaceName();
+	// Before CreateInterfaces(): what the capture radios' monitor
+	// interfaces pass up (default MonitorPreset::Survey: no control or
+	// bad FCS frames, the capture side only threw them away):
+	void SetCaptureMonitorOptions(const MonitorOptions& options);
+	// Before CreateInterfaces(): the VIFs we create belong to our nl80211
+	// socket (default) and vanish with the process, or outlive it (old
+	// behaviour, or a kernel without SOCKET_OWNER; see below):
+	void SetSocketOwnedInterfaces(bool socketOwned);
+	// Releases the socket owned VIFs now (also happens at exit):
+	void ReleaseOwnedInterfaces();
+	// Daemon startup only, before Init(): Init() deletes the VIFs an
+	// earlier run created and left behind. Only ones provably ours and
+	// orphaned: listed in the VIF record (same boot, same ifindex and
+	// name) and the record not locked by a running instance. Off by
+	// default: tools and tests call Init() too, next to a running daemon.
+	void SetSweepStaleInterfaces(bool sweep);
+	// Per-interface results / timing of Init()'s preparation step:
+	const vector<InterfacePrepResult>& GetPrepReport();
 private:
 	InterfaceManagerNl80211();  // Private so that ctor can't be called
 	static InterfaceManagerNl80211* m_pInstance;
@@ -71,10 +114,45 @@ private:
 	char m_apName[SHX_IFNAMESIZE];
 	char m_wpaName[SHX_IFNAMESIZE];
 	char m_monName[SHX_IFNAMESIZE];
+	vector<string> m_monNames;
+	MonitorOptions m_captureMonitorOptions = MonitorOptions::Preset(MonitorPreset::Survey);
 	IfIoctls m_ifIoctls;
 	bool CategorizeInterfaceList();
+	// Bring DOWN / power save OFF, phys in parallel (same phy in order):
+	void PrepareInterfaces(const InterfaceStates& states, ApplyReport& report);
+	static void PreparePhy(const vector<OneInterface *>& ifaces,
+		const InterfaceStates& states, ApplyReport& report,
+		vector<InterfacePrepResult>& results, size_t firstResult);
+	// Slow USB drivers can block for hundreds of ms, but we only
+	// ever have a handful of radios:
+	const unsigned m_maxPrepWorkers = 4;
+	vector<InterfacePrepResult> m_prepReport;
 	bool GetInterfaceByPhyAndName(uint32_t phyId, const char *name,
 		OneInterface **iface);
+	// Which radio gets the wpa_supplicant VIF ('phyId' in: the one we'd
+	// like, out: the one the interface combinations allow). False: none
+	// can take it, don't even try. Can't read the combinations: 'phyId'
+	// unchanged, true (try it the old way).
+	bool PlanStationInterface(uint32_t& phyId);
+	// Init(): delete leftover VIFs (see SetSweepStaleInterfaces()) in one
+	// batch; true if any went (the interface list must be re-read).
+	bool SweepStaleInterfaces();
+	static const char *m_vifPrefix;
+	bool m_socketOwnedVifs = true;
+	bool m_sweepStaleVifs = false;
+	// VIF record: a line per VIF we created ("<boot id> <ifindex> <name>"),
+	// flock()ed for as long as we run, so a record nobody holds belongs
+	// to an instance that is gone.
+	static const char *m_vifRecordPath;
+	int m_vifRecordFd = -1;
+	bool LockVifRecord();
+	void ReadVifRecord(vector<string>& lines);
+	void WriteVifRecord(const vector<string>& lines);
+	void RecordVif(const char *name);
+	static string VifRecordLine(const string& bootId, const OneInterface *iface);
+	static string BootId();
+	// Keeps the socket owned VIFs alive (for the life of the singleton):
+	Nl80211VifOwner m_vifOwner;
 	vector<OneInterface *> m_builtinInterfaces;
 	vector<OneInterface *> m_externalInterfaces;
 };
@@ -0,0 +1,99 @@
+// InterfaceState.h
+// Snapshot of one interface's current state (flags, IPv4 address,
+// netmask, MAC and power save), read in bulk by
+// IfIoctls::ReadInterfaceStates().
+// The IfIoctls / Nl80211InterfaceAdmin "Ensure...()" methods compare
+// against this and only issue the ioctl / nl80211 command when the
+// target differs; ApplyReport records what was applied vs. skipped, and
+// how long the whole read-compare-apply pass took.
+
+#ifndef INTERFACESTATE_H_
+#define INTERFACESTATE_H_
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstring>
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+using namespace std;
+
+class InterfaceState
+{
+public:
+	char name[17];  // IFNAMSIZ is 16
+	int flags;
+	bool isUp;
+	bool hasIpv4;
+	struct in_addr ipAddress;
+	struct in_addr netmask;
+	bool hasMac;
+	uint8_t mac[6];
+	// Only wireless interfaces answer SIOCGIWPOWER:
+	bool powerSaveKnown;
+	bool powerSaveDisabled;
+	InterfaceState()
+	{
+		memset(name, 0, sizeof(name));
+		flags = 0;
+		isUp = false;
+		hasIpv4 = false;
+		ipAddress.s_addr = 0;
+		netmask.s_addr = 0;
+		hasMac = false;
+		memset(mac, 0, sizeof(mac));
+		powerSaveKnown = false;
+		powerSaveDisabled = false;
+	}
+};
+
+// Keyed by interface name:
+typedef map<string, InterfaceState> InterfaceStates;
+
+class ApplyReport
+{
+public:
+	int applied = 0;
+	int skipped = 0;
+	int failed = 0;
+	vector<string> skippedOps;
+	// From construction (before the states are read) to Finish():
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+	chrono::milliseconds elapsed = chrono::milliseconds(0);
+	void Applied() { applied++; }
+	void Skipped(const string& op)
+	{
+		skipped++;
+		skippedOps.push_back(op);
+	}
+	void Failed() { failed++; }
+	void Finish()
+	{
+		elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime);
+	}
+	// (The counts only; 'elapsed' is this report's own wall time.)
+	void Merge(const ApplyReport& other)
+	{
+		applied += other.applied;
+		skipped += other.skipped;
+		failed += other.failed;
+		skippedOps.insert(skippedOps.end(), other.skippedOps.begin(), other.skippedOps.end());
+	}
+	string Summary() const
+	{
+		stringstream s;
+		s << "Applied: " << applied << ", skipped (already in target state): "
+			<< skipped << ", failed: " << failed << ", " << elapsed.count() << " ms";
+		for (const string& op : skippedOps)
+		{
+			s << "\n    skipped: " << op;
+		}
+		return s.str();
+	}
+};
+
+#endif  // INTERFACESTATE_H_
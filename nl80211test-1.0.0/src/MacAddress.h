@@ -0,0 +1,42 @@
+// MacAddress.h
+// 48-bit MAC addresses as table keys (packed into a uint64_t, first
+// octet most significant) and as text.
+
+#ifndef MACADDRESS_H_
+#define MACADDRESS_H_
+
+#include <string>
+#include <cstdio>
+
+#include <stdint.h>
+
+using namespace std;
+
+inline uint64_t PackMac(const uint8_t *mac)
+{
+	uint64_t key = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		key = (key << 8) | mac[i];
+	}
+	return key;
+}
+
+inline void UnpackMac(uint64_t key, uint8_t *mac)
+{
+	for (int i = 5; i >= 0; i--)
+	{
+		mac[i] = (uint8_t)key;
+		key >>= 8;
+	}
+}
+
+inline string MacToString(const uint8_t *mac)
+{
+	char s[18];
+	snprintf(s, sizeof(s), "%02x:%02x:%02x:%02x:%02x:%02x",
+		mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+	return string(s);
+}
+
+#endif  // MACADDRESS_H_
@@ -0,0 +1,104 @@
+// MonitorOptions.h
+// What a monitor interface passes up to userspace at all
+// (NL80211_ATTR_MNTR_FLAGS) and whom it follows in MU-MIMO
+// (NL80211_ATTR_MU_MIMO_GROUP_DATA / _FOLLOW_MAC_ADDR). Every frame
+// filtered here is one the capture side never has to copy and discard.
+// With no flags at all (sendFlags false) mac80211 uses its default:
+// control frames and other BSSs' frames.
+// Flags can be changed on a running interface, except 'active' (EBUSY).
+
+#ifndef MONITOROPTIONS_H_
+#define MONITOROPTIONS_H_
+
+#include <string>
+#include <sstream>
+#include <cstring>
+
+#include <stdint.h>
+
+using namespace std;
+
+enum class MonitorPreset
+{
+	KernelDefault = 1,  // Send no flags
+	// Every frame with a good FCS from every BSS; no control frames.
+	// (Management AND data: the monitor flags have no per-type filter,
+	// this is as close to "management only" as the kernel gets.)
+	Survey,
+	// Everything the radio can report, bad FCS / PLCP and control too
+	// (debugging the radio, not for the capture pipeline):
+	Everything
+};
+
+class MonitorOptions
+{
+public:
+	// false: no NL80211_ATTR_MNTR_FLAGS, the flags below are ignored.
+	bool sendFlags = false;
+	bool fcsFail = false;    // Frames that failed the FCS check
+	bool plcpFail = false;   // Frames that failed the PLCP CRC
+	bool control = false;    // Control frames (RTS, CTS, ACK, ...)
+	bool otherBss = false;   // Frames for other BSSs (without: only ours)
+	bool cookFrames = false; // (Deprecated, newer kernels reject it)
+	bool active = false;     // ACK unicast frames to our address (if supported)
+	// MU-MIMO air sniffer (NL80211_EXT_FEATURE_MU_MIMO_AIR_SNIFFER):
+	bool followGroup = false;
+	uint8_t groupData[24];   // Membership (8 bytes) + user position (16)
+	bool followMac = false;
+	uint8_t followMacAddr[6];
+	MonitorOptions()
+	{
+		memset(groupData, 0, sizeof(groupData));
+		memset(followMacAddr, 0, sizeof(followMacAddr));
+	}
+	static MonitorOptions Preset(MonitorPreset preset)
+	{
+		MonitorOptions o;
+		switch (preset)
+		{
+			case MonitorPreset::KernelDefault:
+				break;
+			case MonitorPreset::Survey:
+				o.sendFlags = true;
+				o.otherBss = true;
+				break;
+			case MonitorPreset::Everything:
+				o.sendFlags = true;
+				o.fcsFail = true;
+				o.plcpFail = true;
+				o.control = true;
+				o.otherBss = true;
+				break;
+		}
+		return o;
+	}
+	string Describe() const
+	{
+		if (!sendFlags && !followGroup && !followMac)
+		{
+			return "kernel default";
+		}
+		stringstream s;
+		if (sendFlags)
+		{
+			s << "flags:" << (fcsFail ? " fcsfail" : "") << (plcpFail ? " plcpfail" : "")
+				<< (control ? " control" : "") << (otherBss ? " otherbss" : "")
+				<< (cookFrames ? " cook" : "") << (active ? " active" : "");
+			if (!(fcsFail || plcpFail || control || otherBss || cookFrames || active))
+			{
+				s << " none";
+			}
+		}
+		if (followGroup)
+		{
+			s << (sendFlags ? ", " : "") << "MU-MIMO group";
+		}
+		if (followMac)
+		{
+			s << (sendFlags || followGroup ? ", " : "") << "MU-MIMO follow MAC";
+		}
+		return s.str();
+	}
+};
+
+#endif  // MONITOROPTIONS_H_
@@ -16,6 +16,7 @@ int Nl80211Base::list_interface_handler(struct nl_msg *msg, void *arg)
 
 	int len;
 	uint32_t phyId;
+	uint32_t ifIndex;
 	uint32_t interfaceType;
 	uint32_t freq;
 	const char *interfaceName;
@@ -49,6 +50,15 @@ int Nl80211Base::list_interface_handler(struct nl_msg *msg, void *arg)
 		instance->LogInfo("Interface missing attribute: PHY ID");
 		phyId = 0;
 	}
+	if (tb_msg[NL80211_ATTR_IFINDEX])
+	{
+		ifIndex = nla_get_u32(tb_msg[NL80211_ATTR_IFINDEX]);
+	}
+	else
+	{
+		instance->LogInfo("Interface missing attribute: IFINDEX");
+		ifIndex = 0;
+	}
 	if (tb_msg[NL80211_ATTR_MAC])
 	{
 		len = nla_len(tb_msg[NL80211_ATTR_MAC]);
@@ -78,11 +88,60 @@ int Nl80211Base::list_interface_handler(struct nl_msg *msg, void *arg)
 		instance->LogInfo("Interface FREQ attr missing");
 		freq = 0;
 	}
-	instance->AddInterfaceToList(phyId, interfaceName, len, macAddress, interfaceType, freq);
+	instance->AddInterfaceToList(phyId, ifIndex, interfaceName, len, macAddress, interfaceType, freq);
+	// The dump carries the same channel attributes as the single
+	// interface query, so fill the channel cache while we are here:
+	ChannelInfo channel;
+	ParseChannelInfo(tb_msg, channel);
+	instance->CacheInterfaceChannel(ifIndex, channel);
+
+	return NL_SKIP;
+}
+
+int Nl80211Base::interface_channel_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
 
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	ParseChannelInfo(tb_msg, *(ChannelInfo *)info->data);
 	return NL_SKIP;
 }
 
+void Nl80211Base::ParseChannelInfo(struct nlattr **tb_msg, ChannelInfo& info)
+{
+	// (static)
+	info.Clear();
+	info.readAt = steady_clock::now();
+	// No WIPHY_FREQ: interface is down / not on a channel.
+	if (!tb_msg[NL80211_ATTR_WIPHY_FREQ])
+	{
+		return;
+	}
+	info.valid = true;
+	info.freq = nla_get_u32(tb_msg[NL80211_ATTR_WIPHY_FREQ]);
+	if (tb_msg[NL80211_ATTR_CHANNEL_WIDTH])
+	{
+		info.width = nla_get_u32(tb_msg[NL80211_ATTR_CHANNEL_WIDTH]);
+	}
+	if (tb_msg[NL80211_ATTR_CENTER_FREQ1])
+	{
+		info.centerFreq1 = nla_get_u32(tb_msg[NL80211_ATTR_CENTER_FREQ1]);
+	}
+	if (tb_msg[NL80211_ATTR_CENTER_FREQ2])
+	{
+		info.centerFreq2 = nla_get_u32(tb_msg[NL80211_ATTR_CENTER_FREQ2]);
+	}
+	if (tb_msg[NL80211_ATTR_WIPHY_TX_POWER_LEVEL])
+	{
+		info.txPowerKnown = true;
+		info.txPowerMbm = (int32_t)nla_get_u32(tb_msg[NL80211_ATTR_WIPHY_TX_POWER_LEVEL]);
+	}
+}
+
 int Nl80211Base::finish_handler(struct nl_msg *msg, void *arg)
 {
 	// (static)
@@ -122,8 +181,21 @@ int Nl80211Base::ack_handler(struct nl_msg *msg, void *arg)
 	return NL_STOP;
 }
 
+int Nl80211Base::seq_check_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	if (info->expectSeq != 0 && nlmsg_hdr(msg)->nlmsg_seq != info->expectSeq)
+	{
+		// Not ours (left-over ACK / error from an earlier message):
+		return NL_SKIP;
+	}
+	return NL_OK;
+}
+
 void Nl80211Base::ClearInterfaceList()
 {
+	lock_guard<mutex> lock(m_interfacesMutex);
 	for (OneInterface *pI : m_interfaces)
 	{
 		delete pI;
@@ -132,14 +204,73 @@ void Nl80211Base::ClearInterfaceList()
 	LogInfo("Nl80211: ClearInterfaceList()");
 }
 
-void Nl80211Base::AddInterfaceToList(uint32_t phyId, const char *interfaceName,
+void Nl80211Base::AddInterfaceToList(uint32_t phyId, uint32_t ifIndex, const char *interfaceName,
 		int macLength, const uint8_t *macAddress, uint32_t interfaceType, uint32_t frequency)
 {
-	OneInterface *pI = new OneInterface(phyId, interfaceName, macAddress, 
+	OneInterface *pI = new OneInterface(phyId, ifIndex, interfaceName, macAddress, 
     macLength, interfaceType, frequency);
+	lock_guard<mutex> lock(m_interfacesMutex);
 	m_interfaces.push_back(pI);
 }
 
+vector<OneInterface> Nl80211Base::InterfaceSnapshot()
+{
+	lock_guard<mutex> lock(m_interfacesMutex);
+	vector<OneInterface> snapshot;
+	snapshot.reserve(m_interfaces.size());
+	for (OneInterface *pI : m_interfaces)
+	{
+		snapshot.push_back(*pI);
+	}
+	return snapshot;
+}
+
+bool Nl80211Base::CacheInterfaceChannel(uint32_t ifIndex, const ChannelInfo& info)
+{
+	lock_guard<mutex> lock(m_interfacesMutex);
+	for (OneInterface *pI : m_interfaces)
+	{
+		if (pI->ifIndex == ifIndex)
+		{
+			pI->channel = info;
+			if (info.valid)
+			{
+				pI->freq = info.freq;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Nl80211Base::GetCachedInterfaceChannel(uint32_t ifIndex, ChannelInfo& info)
+{
+	lock_guard<mutex> lock(m_interfacesMutex);
+	for (OneInterface *pI : m_interfaces)
+	{
+		if (pI->ifIndex == ifIndex)
+		{
+			info = pI->channel;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Nl80211Base::GetInterfacePhy(const char *interfaceName, uint32_t& phy)
+{
+	lock_guard<mutex> lock(m_interfacesMutex);
+	for (OneInterface *pI : m_interfaces)
+	{
+		if (strcmp(pI->name, interfaceName) == 0)
+		{
+			phy = pI->phy;
+			return true;
+		}
+	}
+	return false;
+}
+
 bool Nl80211Base::FreeMessage()
 {
 	if (m_msg != nullptr)
@@ -147,6 +278,7 @@ bool Nl80211Base::FreeMessage()
 		nlmsg_free(m_msg);
 		m_msg = nullptr;
 	}
+	m_nest = nullptr;
 	return true;
 }
 
@@ -162,6 +294,7 @@ bool Nl80211Base::Close()
 		nl_cb_put(m_cb);
 		m_cb = nullptr;
 	}
+	m_ackOffset = m_ackLength = 0;
 	return FreeMessage();
 }
 
@@ -217,6 +350,17 @@ bool Nl80211Base::GetInterfaceIndex(const char* ifaceName, uint32_t& deviceId)
 
 bool Nl80211Base::SetupCallback()
 {
+	return SetupCallback(list_interface_handler);
+}
+
+bool Nl80211Base::SetupCallback(nl_recvmsg_msg_cb_t validHandler)
+{
+	// Re-used on an open connection, drop the previous one:
+	if (m_cb != nullptr)
+	{
+		nl_cb_put(m_cb);
+		m_cb = nullptr;
+	}
 	m_cb = nl_cb_alloc(NL_CB_DEFAULT);
 	if (m_cb == nullptr)
 	{
@@ -227,8 +371,11 @@ bool Nl80211Base::SetupCallback()
 	m_cbInfo.m_pInstance = this;
 	m_cbInfo.status = 1;
 	m_cbInfo.errcode = 0;
+	m_cbInfo.data = nullptr;
+	m_cbInfo.expectSeq = 0;
 
-	nl_cb_set(m_cb, NL_CB_VALID, NL_CB_CUSTOM, list_interface_handler, &m_cbInfo);
+	nl_cb_set(m_cb, NL_CB_VALID, NL_CB_CUSTOM, validHandler, &m_cbInfo);
+	nl_cb_set(m_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, seq_check_handler, &m_cbInfo);
 	return true;
 }
 
@@ -276,6 +423,24 @@ nla_put_failure:
 	return false;
 }
 
+bool Nl80211Base::AddMessageParameterU16(enum nl80211_attrs parameterName, uint16_t value)
+{
+	NLA_PUT_U16(m_msg, parameterName, value);
+	return true;
+nla_put_failure:
+	LogErr(AT, "Can't Add Parameter");
+	return false;
+}
+
+bool Nl80211Base::AddMessageParameterBinary(enum nl80211_attrs parameterName, const void *data, size_t length)
+{
+	NLA_PUT(m_msg, parameterName, (int)length, data);
+	return true;
+nla_put_failure:
+	LogErr(AT, "Can't Add Parameter");
+	return false;
+}
+
 bool Nl80211Base::AddMessageParameterString(enum nl80211_attrs parameterName, const char *value)
 {
 	NLA_PUT_STRING(m_msg, parameterName, value);
@@ -285,11 +450,106 @@ nla_put_failure:
 	return false;
 }
 
+// (NLA_FLAG: present or not, no payload. e.g., NL80211_ATTR_SPLIT_WIPHY_DUMP)
+bool Nl80211Base::AddMessageParameterFlag(enum nl80211_attrs parameterName)
+{
+	NLA_PUT_FLAG(m_msg, parameterName);
+	return true;
+nla_put_failure:
+	LogErr(AT, "Can't Add Parameter");
+	return false;
+}
+
+bool Nl80211Base::AddMessageParameterU32List(enum nl80211_attrs parameterName, const vector<uint32_t>& values)
+{
+	struct nlattr *list = nla_nest_start(m_msg, parameterName);
+	if (list == nullptr)
+	{
+		goto nla_put_failure;
+	}
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		NLA_PUT_U32(m_msg, (int)i + 1, values[i]);
+	}
+	nla_nest_end(m_msg, list);
+	return true;
+nla_put_failure:
+	LogErr(AT, "Can't Add Parameter");
+	return false;
+}
+
+// (Binary: no terminating NUL; an empty entry is a zero length attribute.)
+bool Nl80211Base::AddMessageParameterBinaryList(enum nl80211_attrs parameterName, const vector<string>& values)
+{
+	struct nlattr *list = nla_nest_start(m_msg, parameterName);
+	if (list == nullptr)
+	{
+		goto nla_put_failure;
+	}
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		NLA_PUT(m_msg, (int)i + 1, (int)values[i].size(), values[i].data());
+	}
+	nla_nest_end(m_msg, list);
+	return true;
+nla_put_failure:
+	LogErr(AT, "Can't Add Parameter");
+	return false;
+}
+
+bool Nl80211Base::AddMessageParameterNestedFlags(enum nl80211_attrs parameterName, const vector<int>& flags)
+{
+	struct nlattr *nest = nla_nest_start(m_msg, parameterName);
+	if (nest == nullptr)
+	{
+		goto nla_put_failure;
+	}
+	for (int flag : flags)
+	{
+		NLA_PUT_FLAG(m_msg, flag);
+	}
+	nla_nest_end(m_msg, nest);
+	return true;
+nla_put_failure:
+	LogErr(AT, "Can't Add Parameter");
+	return false;
+}
+
+bool Nl80211Base::NestStart(enum nl80211_attrs parameterName)
+{
+	if (m_nest != nullptr)
+	{
+		LogErr(AT, "NestStart(): already in a nest");
+		return false;
+	}
+	m_nest = nla_nest_start(m_msg, parameterName);
+	if (m_nest == nullptr)
+	{
+		LogErr(AT, "Can't Add Parameter");
+		return false;
+	}
+	return true;
+}
+
+bool Nl80211Base::NestEnd()
+{
+	if (m_nest == nullptr)
+	{
+		LogErr(AT, "NestEnd(): no nest");
+		return false;
+	}
+	nla_nest_end(m_msg, m_nest);
+	m_nest = nullptr;
+	return true;
+}
+
 bool Nl80211Base::SendWithRepeatingResponses()
 {
 	// "nl_send_auto_complete: DEPRECATED, please use nl_send_auto()"
 //	nl_send_auto_complete(m_sock, m_msg);
 	nl_send_auto(m_sock, m_msg);
+	// (nl_send_auto() filled in the sequence number)
+	m_cbInfo.expectSeq = nlmsg_hdr(m_msg)->nlmsg_seq;
 	// m_cbInfo.status = 1;
 	// m_cb (an nl_cb *) can hold > 1 callback, calls finish_handler()
 	//   when FINISHed, and list_interface_handler() foreach interface
@@ -359,3 +619,237 @@ bool Nl80211Base::SendAndFreeMessage(bool waitForAck)
 	return FreeMessage();
 }
 
+
+// GetInterfaceChannel(): NL80211_CMD_GET_INTERFACE (not a dump) on the
+// ifindex. NLM_F_ACK makes the kernel follow the single reply with an
+// ACK, which ends the SendWithRepeatingResponses() receive loop.
+bool Nl80211Base::GetInterfaceChannel(uint32_t ifIndex, ChannelInfo& info)
+{
+	FreeMessage();
+	if (!SetupCallback(interface_channel_handler))
+	{
+		return false;
+	}
+	m_cbInfo.data = &info;
+	info.Clear();
+	if (!SetupMessage(NLM_F_ACK, NL80211_CMD_GET_INTERFACE)
+		|| !AddMessageParameterU32(NL80211_ATTR_IFINDEX, ifIndex))
+	{
+		FreeMessage();
+		LogErr(AT, "GetInterfaceChannel(): can't build message.");
+		return false;
+	}
+	bool rv = SendWithRepeatingResponses();
+	FreeMessage();
+	m_cbInfo.data = nullptr;
+	return rv;
+}
+
+bool Nl80211Base::EncodeMessage(vector<uint8_t>& out, uint32_t& length, uint16_t extraFlags)
+{
+	if (m_msg == nullptr)
+	{
+		return false;
+	}
+	struct nlmsghdr *hdr = nlmsg_hdr(m_msg);
+	hdr->nlmsg_flags |= NLM_F_REQUEST | extraFlags;
+	length = hdr->nlmsg_len;
+	const uint8_t *p = (const uint8_t *)hdr;
+	out.insert(out.end(), p, p + length);
+	return FreeMessage();
+}
+
+bool Nl80211Base::SendRaw(uint8_t *buf, uint32_t length, bool wantAck, uint32_t& seq)
+{
+	static const struct sockaddr_nl kernel = { AF_NETLINK, 0, 0, 0 };
+	struct nlmsghdr hdr;
+	// (memcpy: buf is not necessarily aligned for struct nlmsghdr)
+	memcpy(&hdr, buf, sizeof(hdr));
+	seq = nl_socket_use_seq(m_sock);
+	hdr.nlmsg_seq = seq;
+	hdr.nlmsg_pid = nl_socket_get_local_port(m_sock);
+	if (wantAck)
+	{
+		hdr.nlmsg_flags |= NLM_F_ACK;
+	}
+	else
+	{
+		hdr.nlmsg_flags &= ~NLM_F_ACK;
+	}
+	memcpy(buf, &hdr, sizeof(hdr));
+	ssize_t rv = sendto(nl_socket_get_fd(m_sock), buf, length, 0,
+		(const struct sockaddr *)&kernel, sizeof(kernel));
+	if (rv < 0)
+	{
+		int myErr = errno;
+		stringstream s;
+		s << "Nl80211Base::SendRaw: sendto FAILED: " << strerror(myErr);
+		LogErr(AT, s);
+		return false;
+	}
+	return true;
+}
+
+bool Nl80211Base::SendNoWait(uint32_t& seq)
+{
+	int rv = nl_send_auto(m_sock, m_msg);
+	if (rv < 0)
+	{
+		stringstream s;
+		s << "Nl80211Base::SendNoWait: send_auto FAILED: " << strerror(0 - rv);
+		LogErr(AT, s);
+		FreeMessage();
+		return false;
+	}
+	seq = nlmsg_hdr(m_msg)->nlmsg_seq;
+	return FreeMessage();
+}
+
+// WaitForAck(): like nl_wait_for_ack() but for one particular sequence
+// number, ACKs / errors for other (pipelined) messages are skipped.
+bool Nl80211Base::WaitForAck(uint32_t seq)
+{
+	if (m_cb == nullptr && !SetupCallback())
+	{
+		return false;
+	}
+	m_cbInfo.status = 1;
+	m_cbInfo.errcode = 0;
+	m_cbInfo.expectSeq = seq;
+	nl_cb_err(m_cb, NL_CB_CUSTOM, error_handler, &m_cbInfo);
+	nl_cb_set(m_cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &m_cbInfo);
+	while (m_cbInfo.status > 0)
+	{
+		int rv = nl_recvmsgs(m_sock, m_cb);
+		if (rv < 0)
+		{
+			stringstream s;
+			s << "Nl80211Base::WaitForAck: recv FAILED: " << nl_geterror(rv);
+			LogErr(AT, s);
+			return false;
+		}
+	}
+	if (m_cbInfo.errcode != 0)
+	{
+		stringstream s;
+		s << "Nl80211Base::WaitForAck: ERROR: " << strerror(m_cbInfo.errcode);
+		LogErr(AT, s);
+		return false;
+	}
+	return true;
+}
+
+// ReadAcks(): non-blocking; parses NLMSG_ERROR messages (error 0 == ACK)
+// straight out of m_ackBuf, anything else is discarded. A datagram can
+// hold more ACKs than 'maxAcks': the rest stay in m_ackBuf (from
+// m_ackOffset) for the next call, before anything new is read.
+size_t Nl80211Base::ReadAcks(nl80211Ack *acks, size_t maxAcks)
+{
+	if (m_ackBuf.empty())
+	{
+		m_ackBuf.resize(8192);  // (Once, Open()'s receive buffer size)
+	}
+	size_t count = 0;
+	int fd = nl_socket_get_fd(m_sock);
+	while (count < maxAcks)
+	{
+		if (m_ackOffset >= m_ackLength)
+		{
+			ssize_t len = recv(fd, &m_ackBuf[0], m_ackBuf.size(), MSG_DONTWAIT);
+			if (len <= 0)
+			{
+				m_ackOffset = m_ackLength = 0;
+				break;
+			}
+			m_ackOffset = 0;
+			m_ackLength = (size_t)len;
+		}
+		struct nlmsghdr *hdr = (struct nlmsghdr *)&m_ackBuf[m_ackOffset];
+		int remaining = (int)(m_ackLength - m_ackOffset);
+		for (; NLMSG_OK(hdr, remaining) && count < maxAcks; hdr = NLMSG_NEXT(hdr, remaining))
+		{
+			if (hdr->nlmsg_type != NLMSG_ERROR)
+			{
+				continue;
+			}
+			struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(hdr);
+			acks[count].seq = hdr->nlmsg_seq;
+			acks[count].error = 0 - err->error;  // positive errno, 0 = ACK
+			count++;
+		}
+		// Where the next call picks up (the end if this datagram is done):
+		m_ackOffset = NLMSG_OK(hdr, remaining) ? (uint8_t *)hdr - &m_ackBuf[0] : m_ackLength;
+	}
+	return count;
+}
+
+int Nl80211Base::SocketFd()
+{
+	return nl_socket_get_fd(m_sock);
+}
+
+void Nl80211Base::DisableAutoAck()
+{
+	nl_socket_disable_auto_ack(m_sock);
+}
+
+void Nl80211Base::SetCallbackData(void *data)
+{
+	m_cbInfo.data = data;
+}
+
+bool Nl80211Base::JoinMulticastGroup(const char *group)
+{
+	int groupId = genl_ctrl_resolve_grp(m_sock, NL80211_GENL_NAME, group);
+	if (groupId < 0)
+	{
+		stringstream s;
+		s << "JoinMulticastGroup(" << group << "): not found: " << nl_geterror(groupId);
+		LogErr(AT, s);
+		return false;
+	}
+	int rv = nl_socket_add_membership(m_sock, groupId);
+	if (rv < 0)
+	{
+		stringstream s;
+		s << "JoinMulticastGroup(" << group << "): " << nl_geterror(rv);
+		LogErr(AT, s);
+		return false;
+	}
+	return true;
+}
+
+bool Nl80211Base::SetNonBlocking()
+{
+	if (nl_socket_set_nonblocking(m_sock) < 0)
+	{
+		LogErr(AT, "Can't make netlink socket non-blocking.");
+		return false;
+	}
+	return true;
+}
+
+// Events arrive unasked; Open()'s 8 KB is too small for a burst of them
+// (the kernel drops the overflow with ENOBUFS):
+bool Nl80211Base::SetReceiveBufferSize(int bytes)
+{
+	if (nl_socket_set_buffer_size(m_sock, bytes, 8192) < 0)
+	{
+		LogErr(AT, "Can't set netlink socket buffer size.");
+		return false;
+	}
+	return true;
+}
+
+// ReceiveMessages(): one nl_recvmsgs() pass; returns its result
+// (< 0: libnl error code, -NLE_AGAIN when nothing was waiting).
+int Nl80211Base::ReceiveMessages()
+{
+	if (m_cb == nullptr)
+	{
+		return -NLE_FAILURE;
+	}
+	// Events carry sequence number 0, accept anything:
+	m_cbInfo.expectSeq = 0;
+	return nl_recvmsgs(m_sock, m_cb);
+}
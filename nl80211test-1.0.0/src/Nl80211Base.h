@@ -9,6 +9,7 @@
 #include <sstream>
 #include <cstring>  // std::strerror()
 #include <vector>
+#include <mutex>
 #include <cstdio>
 
 #include "netlink/socket.h"
@@ -24,6 +25,7 @@
 #include <stdint.h>
 
 #include "OneInterface.h"
+#include "ChannelInfo.h"
 #include "Log.h"
 
 using namespace std;
@@ -40,8 +42,22 @@ typedef struct
 	int status;
 	// This is set by Error handler (if error occurred):
 	int errcode;
+	// Where a single-reply handler puts its result
+	// (e.g., ChannelInfo * for interface_channel_handler()):
+	void *data;
+	// Sequence number of the request we are waiting on (0: accept any).
+	// Replies to other messages (e.g., ACKs from channel changes we did
+	// not wait for) are skipped by seq_check_handler().
+	uint32_t expectSeq;
 } nl80211CallbackInfo;
 
+// One ACK (error == 0) or error (positive errno) read by ReadAcks():
+typedef struct
+{
+	uint32_t seq;
+	int error;
+} nl80211Ack;
+
 class Nl80211Base : protected Log
 {
 public:
@@ -59,6 +75,8 @@ public:
 	//   Here, we only see "finish"ed handler called. ack_handler isn't called
 	//   (I think finish_handler()s ret val is sufficient)
 	static int ack_handler(struct nl_msg *msg, void *arg);
+	// Replaces libnl's strict "every reply in order" sequence check:
+	static int seq_check_handler(struct nl_msg *msg, void *arg);
 
 	// 'arg' is the last parameter to the xxx call:
 	// int nl_cb_set(struct nl_cb *cb, enum nl_cb_type type,
@@ -67,35 +85,103 @@ public:
 	// Example:
 	//     nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, list_interface_handler, NULL);
 	static int list_interface_handler(struct nl_msg *msg, void *arg);
-	
+	// NL80211_CMD_GET_INTERFACE for ONE ifindex, fills (ChannelInfo *)arg->data:
+	static int interface_channel_handler(struct nl_msg *msg, void *arg);
+	// Common to both of the above:
+	static void ParseChannelInfo(struct nlattr **tb_msg, ChannelInfo& info);
+
 	bool Close();
 	bool FreeMessage();
 	bool Open();
 	bool GetInterfaceIndex(const char* ifaceName, uint32_t& deviceId);
 	bool SetupCallback();
+	// Same, but with a different NL_CB_VALID handler:
+	bool SetupCallback(nl_recvmsg_msg_cb_t validHandler);
 	// flags: 0 or NLM_F_DUMP if repeating responses expected.
 	// cmd:  NL80211_CMD_GET_INTERFACE - get List of interfaces
 	//       NL80211_CMD_SET_WIPHY - set frequency
 	bool SetupMessage(int flags, uint8_t cmd);
 	bool AddMessageParameterU32(enum nl80211_attrs parameterName, uint32_t value);
+	bool AddMessageParameterU16(enum nl80211_attrs parameterName, uint16_t value);
+	// (Zero length allowed, e.g. an empty NL80211_ATTR_FRAME_MATCH.)
+	bool AddMessageParameterBinary(enum nl80211_attrs parameterName, const void *data, size_t length);
 	bool AddMessageParameterString(enum nl80211_attrs parameterName, const char *value);
+	bool AddMessageParameterFlag(enum nl80211_attrs parameterName);
+	// Nested lists, entries numbered 1..n (e.g., NL80211_ATTR_SCAN_FREQUENCIES
+	// of u32, NL80211_ATTR_SCAN_SSIDS of binary SSIDs):
+	bool AddMessageParameterU32List(enum nl80211_attrs parameterName, const vector<uint32_t>& values);
+	bool AddMessageParameterBinaryList(enum nl80211_attrs parameterName, const vector<string>& values);
+	// Nested NLA_FLAGs (e.g., NL80211_ATTR_MNTR_FLAGS; empty: an empty nest):
+	bool AddMessageParameterNestedFlags(enum nl80211_attrs parameterName, const vector<int>& flags);
+	// Any other nest (one level): NestStart(), the nest's own attributes
+	// with the AddMessageParameterXxx() calls (cast to nl80211_attrs,
+	// e.g. NL80211_ATTR_CQM_RSSI_HYST inside NL80211_ATTR_CQM), NestEnd():
+	bool NestStart(enum nl80211_attrs parameterName);
+	bool NestEnd();
 	// Call this when expecting multiple responses [e.g., GetInterfaceList()]:
 	bool SendWithRepeatingResponses();
 	// Send with no mult [e.g., SetChannel()]
 	bool SendAndFreeMessage(bool waitForAck);
 	void ClearInterfaceList();
-	void AddInterfaceToList(uint32_t phyId, const char *interfaceName,
+	void AddInterfaceToList(uint32_t phyId, uint32_t ifIndex, const char *interfaceName,
 		int macLength, const uint8_t *macAddress,
 		uint32_t interfaceType, uint32_t frequency);
+	// Read back an interface's current channel / width / TX power
+	// (GET_INTERFACE on the ifindex). Open() must have been called;
+	// the connection is left open so this is cheap to call after
+	// every channel change.
+	bool GetInterfaceChannel(uint32_t ifIndex, ChannelInfo& info);
+	// Channel cache in m_interfaces (the "inventory"):
+	bool CacheInterfaceChannel(uint32_t ifIndex, const ChannelInfo& info);
+	bool GetCachedInterfaceChannel(uint32_t ifIndex, ChannelInfo& info);
+	// Which radio (phy) an interface in m_interfaces is on:
+	bool GetInterfacePhy(const char *interfaceName, uint32_t& phy);
 protected:
 	Nl80211Base() { }
+	// Pre-encoded messages (e.g., per-channel SET_WIPHY templates):
+	// EncodeMessage() appends the finished m_msg to 'out' (nlmsg_flags =
+	// NLM_F_REQUEST | extraFlags) and frees m_msg; SendRaw() patches in the
+	// next sequence number (and NLM_F_ACK if wanted) and sends it with a
+	// single sendto(), no allocation.
+	bool EncodeMessage(vector<uint8_t>& out, uint32_t& length, uint16_t extraFlags);
+	bool SendRaw(uint8_t *buf, uint32_t length, bool wantAck, uint32_t& seq);
+	// Pipelining: send m_msg without waiting (returns its sequence number),
+	// then later WaitForAck() on it, or collect ACKs / errors for many
+	// messages without blocking with ReadAcks() (returns # read).
+	bool SendNoWait(uint32_t& seq);
+	bool WaitForAck(uint32_t seq);
+	size_t ReadAcks(nl80211Ack *acks, size_t maxAcks);
+	int SocketFd();
+	// Only send NLM_F_ACK when asked for (SetupMessage() flags / SendRaw()):
+	void DisableAutoAck();
+	// Handed to the NL_CB_VALID handler as arg->data (after SetupCallback()):
+	void SetCallbackData(void *data);
+	// Event sockets: join an nl80211 multicast group by name ("config",
+	// "scan", "regulatory", "mlme", ...), then ReceiveMessages() runs the
+	// NL_CB_VALID handler on whatever has arrived (non-blocking socket).
+	bool JoinMulticastGroup(const char *group);
+	bool SetNonBlocking();
+	bool SetReceiveBufferSize(int bytes);
+	int ReceiveMessages();
+	// Copies of the m_interfaces entries, taken under m_interfacesMutex
+	// (for reading the list without holding the lock):
+	vector<OneInterface> InterfaceSnapshot();
 	vector<OneInterface *> m_interfaces;
+	// Guards m_interfaces against the channel cache updates (made from
+	// channel setter / hopper threads): hold it across any iteration of
+	// m_interfaces, or iterate an InterfaceSnapshot() instead.
+	mutex m_interfacesMutex;
 private:
 	struct nl_sock *m_sock = nullptr;
 	struct nl_msg *m_msg = nullptr;
+	struct nlattr *m_nest = nullptr;  // (Open NestStart())
 	struct nl_cb *m_cb = nullptr;
-	int32_t m_nl80211Id;
+	int32_t m_nl80211Id = 0;
 	nl80211CallbackInfo m_cbInfo;
+	// ReadAcks(): the last datagram received, parsed up to m_ackOffset:
+	vector<uint8_t> m_ackBuf;
+	size_t m_ackOffset = 0;
+	size_t m_ackLength = 0;
 };
 
 #endif  // NL80211BASE_H_
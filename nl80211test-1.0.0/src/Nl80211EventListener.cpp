@@ -0,0 +1,295 @@
+// Nl80211EventListener.cpp
+// nl80211 multicast event socket + dispatch thread.
+
+#include "Nl80211EventListener.h"
+
+Nl80211EventListener::Nl80211EventListener() : Nl80211Base("Nl80211EventListener")
+{
+	m_running = false;
+	m_overruns = 0;
+}
+
+Nl80211EventListener::~Nl80211EventListener()
+{
+	Stop();
+}
+
+bool Nl80211EventListener::AddGroup(const char *group)
+{
+	for (const string& g : m_groups)
+	{
+		if (g == group)
+		{
+			return true;
+		}
+	}
+	m_groups.push_back(group);
+	if (m_isOpen)
+	{
+		return JoinMulticastGroup(group);
+	}
+	return true;
+}
+
+bool Nl80211EventListener::AddFrameRegistration(const char *interfaceName, uint16_t frameType,
+	const vector<uint8_t>& match)
+{
+	if (m_isOpen)
+	{
+		LogErr(AT, "AddFrameRegistration(): already started.");
+		return false;
+	}
+	FrameRegistration r;
+	r.interfaceName = interfaceName;
+	r.frameType = frameType;
+	r.match = match;
+	m_frameRegistrations.push_back(r);
+	return true;
+}
+
+int Nl80211EventListener::AddFrameHandler(MgmtFrameHandler handler)
+{
+	return AddHandler(NL80211_CMD_FRAME, [handler](uint8_t, struct nlattr **tb)
+	{
+		if (!tb[NL80211_ATTR_FRAME])
+		{
+			return;
+		}
+		MgmtFrame frame;
+		frame.data = (const uint8_t *)nla_data(tb[NL80211_ATTR_FRAME]);
+		frame.length = (size_t)nla_len(tb[NL80211_ATTR_FRAME]);
+		if (tb[NL80211_ATTR_IFINDEX])
+		{
+			frame.ifIndex = nla_get_u32(tb[NL80211_ATTR_IFINDEX]);
+		}
+		if (tb[NL80211_ATTR_WIPHY_FREQ])
+		{
+			frame.freq = nla_get_u32(tb[NL80211_ATTR_WIPHY_FREQ]);
+		}
+		if (tb[NL80211_ATTR_RX_SIGNAL_DBM])
+		{
+			frame.haveSignal = true;
+			frame.signalDbm = (int32_t)nla_get_u32(tb[NL80211_ATTR_RX_SIGNAL_DBM]);
+		}
+		handler(frame);
+	});
+}
+
+// (Start(), socket still blocking, before the listener thread runs.)
+// Each registration waits for its ACK; a frame that sneaks in ahead of
+// an ACK is skipped.
+bool Nl80211EventListener::RegisterFrames()
+{
+	for (const FrameRegistration& r : m_frameRegistrations)
+	{
+		uint32_t ifIndex;
+		if (!GetInterfaceIndex(r.interfaceName.c_str(), ifIndex))
+		{
+			return false;
+		}
+		uint32_t seq;
+		bool ok = SetupMessage(NLM_F_ACK, NL80211_CMD_REGISTER_FRAME)
+			&& AddMessageParameterU32(NL80211_ATTR_IFINDEX, ifIndex)
+			&& AddMessageParameterU16(NL80211_ATTR_FRAME_TYPE, r.frameType)
+			&& AddMessageParameterBinary(NL80211_ATTR_FRAME_MATCH, r.match.data(), r.match.size());
+		if (!ok)
+		{
+			FreeMessage();
+			LogErr(AT, "RegisterFrames(): can't build message.");
+			return false;
+		}
+		if (!SendNoWait(seq) || !WaitForAck(seq))
+		{
+			stringstream s;
+			s << "RegisterFrames(): can't register frame type 0x" << hex << r.frameType
+				<< dec << " on " << r.interfaceName;
+			LogErr(AT, s);
+			return false;
+		}
+		stringstream s;
+		s << "RegisterFrames(): frame type 0x" << hex << r.frameType << dec
+			<< " on " << r.interfaceName;
+		LogInfo(s);
+	}
+	return true;
+}
+
+int Nl80211EventListener::AddHandler(uint8_t cmd, Nl80211EventHandler handler)
+{
+	lock_guard<mutex> lock(m_handlersMutex);
+	HandlerEntry e;
+	e.id = m_nextHandlerId++;
+	e.cmd = cmd;
+	e.handler = handler;
+	m_handlers.push_back(e);
+	return e.id;
+}
+
+void Nl80211EventListener::RemoveHandler(int id)
+{
+	lock_guard<mutex> lock(m_handlersMutex);
+	for (size_t i = 0; i < m_handlers.size(); i++)
+	{
+		if (m_handlers[i].id == id)
+		{
+			m_handlers.erase(m_handlers.begin() + i);
+			return;
+		}
+	}
+}
+
+bool Nl80211EventListener::Start()
+{
+	if (m_running)
+	{
+		return true;
+	}
+	if (!Open())
+	{
+		LogErr(AT, "Start(): Nl80211 open failed.");
+		return false;
+	}
+	m_isOpen = true;
+	// Events are never replies to anything we sent (frame registrations
+	// are, and are done while the socket still blocks):
+	if (!SetupCallback(event_handler)
+		|| !RegisterFrames()
+		|| !SetNonBlocking()
+		|| !SetReceiveBufferSize(ReceiveBufferSize))
+	{
+		Close();
+		m_isOpen = false;
+		return false;
+	}
+	DisableAutoAck();
+	for (const string& g : m_groups)
+	{
+		if (!JoinMulticastGroup(g.c_str()))
+		{
+			Close();
+			m_isOpen = false;
+			return false;
+		}
+	}
+	m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_wakeFd < 0)
+	{
+		int myErr = errno;
+		string s("Start(): eventfd failed: ");
+		s += strerror(myErr);
+		LogErr(AT, s);
+		Close();
+		m_isOpen = false;
+		return false;
+	}
+	m_running = true;
+	m_thread = thread(&Nl80211EventListener::ListenThread, this);
+	return true;
+}
+
+bool Nl80211EventListener::Stop()
+{
+	if (m_thread.joinable())
+	{
+		m_running = false;
+		uint64_t one = 1;
+		if (write(m_wakeFd, &one, sizeof(one)) < 0)
+		{
+			LogErr(AT, "Stop(): can't wake the listener thread.");
+		}
+		m_thread.join();
+	}
+	m_running = false;
+	if (m_wakeFd >= 0)
+	{
+		close(m_wakeFd);
+		m_wakeFd = -1;
+	}
+	if (m_isOpen)
+	{
+		Close();
+		m_isOpen = false;
+	}
+	return true;
+}
+
+bool Nl80211EventListener::IsRunning()
+{
+	return m_running;
+}
+
+uint64_t Nl80211EventListener::GetOverruns()
+{
+	return m_overruns;
+}
+
+int Nl80211EventListener::event_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	Nl80211EventListener *instance = static_cast<Nl80211EventListener *>(info->m_pInstance);
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
+
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	instance->Dispatch(gnlh->cmd, tb_msg);
+	return NL_SKIP;
+}
+
+void Nl80211EventListener::Dispatch(uint8_t cmd, struct nlattr **tb)
+{
+	lock_guard<mutex> lock(m_handlersMutex);
+	for (const HandlerEntry& e : m_handlers)
+	{
+		if (e.cmd == cmd)
+		{
+			e.handler(cmd, tb);
+		}
+	}
+}
+
+void Nl80211EventListener::ListenThread()
+{
+	struct pollfd fds[2];
+	fds[0].fd = SocketFd();
+	fds[0].events = POLLIN;
+	fds[1].fd = m_wakeFd;
+	fds[1].events = POLLIN;
+	while (m_running)
+	{
+		int rv = poll(fds, 2, -1);
+		if (rv < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			LogErr(AT, "ListenThread(): poll failed.");
+			break;
+		}
+		if ((fds[1].revents & POLLIN) || !m_running)
+		{
+			break;
+		}
+		if (!(fds[0].revents & POLLIN))
+		{
+			continue;
+		}
+		rv = ReceiveMessages();
+		if (rv == -NLE_NOMEM)
+		{
+			// Receive buffer overflowed, the kernel dropped events;
+			// handlers that keep state should resync.
+			m_overruns++;
+			LogErr(AT, "ListenThread(): events lost (ENOBUFS).");
+		}
+		else if (rv < 0 && rv != -NLE_AGAIN)
+		{
+			stringstream s;
+			s << "ListenThread(): receive failed: " << nl_geterror(rv);
+			LogErr(AT, s);
+		}
+	}
+	m_running = false;
+}
@@ -0,0 +1,123 @@
+// Nl80211EventListener.h
+// A netlink socket subscribed to nl80211 multicast groups ("regulatory",
+// "scan", "mlme", ...) plus a thread that hands each event to the
+// handlers registered for its command (NL80211_CMD_REG_CHANGE, ...).
+// Handlers run on the listener thread; keep them short and don't call
+// AddHandler() / RemoveHandler() from inside one.
+// Management frames (NL80211_CMD_REGISTER_FRAME): the kernel unicasts
+// frames of a registered type to the socket that registered, as
+// NL80211_CMD_FRAME; works on AP / STA interfaces, no monitor mode.
+
+#ifndef NL80211EVENTLISTENER_H_
+#define NL80211EVENTLISTENER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstring>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+
+using namespace std;
+
+// 'tb' is the event's parsed top level attributes (NL80211_ATTR_MAX + 1).
+typedef function<void(uint8_t cmd, struct nlattr **tb)> Nl80211EventHandler;
+
+// Frame control values (type | subtype) for AddFrameRegistration():
+enum MgmtFrameType
+{
+	MgmtProbeRequest = 0x0040,
+	MgmtBeacon = 0x0080,
+	MgmtAction = 0x00d0
+};
+
+// One received management frame. Non-owning: 'data' is only valid
+// during the handler call.
+class MgmtFrame
+{
+public:
+	uint32_t ifIndex = 0;
+	uint32_t freq = 0;
+	bool haveSignal = false;
+	int32_t signalDbm = 0;
+	const uint8_t *data = nullptr;  // Whole frame, from the frame control field
+	size_t length = 0;
+	uint16_t FrameControl() const { return length >= 2 ? (uint16_t)(data[0] | (data[1] << 8)) : 0; }
+	// Transmitter (addr2), nullptr if the frame is too short:
+	const uint8_t *Source() const { return length >= 16 ? data + 10 : nullptr; }
+	// After the 24 byte header (probe request: the IEs):
+	const uint8_t *Body() const { return length > 24 ? data + 24 : nullptr; }
+	size_t BodyLength() const { return length > 24 ? length - 24 : 0; }
+};
+
+typedef function<void(const MgmtFrame& frame)> MgmtFrameHandler;
+
+class Nl80211EventListener : public Nl80211Base
+{
+public:
+	Nl80211EventListener();
+	~Nl80211EventListener();
+	// Groups can be added before or after Start():
+	bool AddGroup(const char *group);
+	// Before Start(): frames of 'frameType' (MgmtFrameType) on
+	// 'interfaceName' whose body starts with 'match' (empty: all; for
+	// action frames, e.g. the category byte). Registered when Start()
+	// opens the socket, dropped by the kernel when it closes. EALREADY:
+	// somebody else (hostapd?) already has it.
+	bool AddFrameRegistration(const char *interfaceName, uint16_t frameType,
+		const vector<uint8_t>& match);
+	// NL80211_CMD_FRAME handler, parsed; an id for RemoveHandler():
+	int AddFrameHandler(MgmtFrameHandler handler);
+	// Returns an id for RemoveHandler():
+	int AddHandler(uint8_t cmd, Nl80211EventHandler handler);
+	void RemoveHandler(int id);
+	bool Start();
+	bool Stop();
+	bool IsRunning();
+	// Events the kernel dropped because we fell behind (ENOBUFS):
+	uint64_t GetOverruns();
+	static int event_handler(struct nl_msg *msg, void *arg);
+private:
+	void ListenThread();
+	bool RegisterFrames();
+	void Dispatch(uint8_t cmd, struct nlattr **tb);
+	class HandlerEntry
+	{
+	public:
+		int id;
+		uint8_t cmd;
+		Nl80211EventHandler handler;
+	};
+	mutex m_handlersMutex;
+	vector<HandlerEntry> m_handlers;
+	int m_nextHandlerId = 1;
+	vector<string> m_groups;
+	class FrameRegistration
+	{
+	public:
+		string interfaceName;
+		uint16_t frameType;
+		vector<uint8_t> match;
+	};
+	vector<FrameRegistration> m_frameRegistrations;
+	bool m_isOpen = false;
+	thread m_thread;
+	atomic<bool> m_running;
+	atomic<uint64_t> m_overruns;
+	int m_wakeFd = -1;
+	static const int ReceiveBufferSize = 256 * 1024;
+};
+
+#endif  // NL80211EVENTLISTENER_H_
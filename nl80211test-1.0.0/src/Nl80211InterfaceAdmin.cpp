@@ -98,6 +98,54 @@ void Nl80211InterfaceAdmin::IfTypeToString(uint32_t iftype, string& strType)
 	strType = s.str();
 }
 
+void Nl80211InterfaceAdmin::ChannelToString(const ChannelInfo& info, string& strChannel)
+{
+	stringstream s;
+	if (!info.valid)
+	{
+		strChannel = "-";
+		return;
+	}
+	switch (info.width)
+	{
+		case NL80211_CHAN_WIDTH_20_NOHT:
+			s << "20(noHT)";
+			break;
+		case NL80211_CHAN_WIDTH_20:
+			s << "20";
+			break;
+		case NL80211_CHAN_WIDTH_40:
+			s << "40";
+			break;
+		case NL80211_CHAN_WIDTH_80:
+			s << "80";
+			break;
+		case NL80211_CHAN_WIDTH_80P80:
+			s << "80+80";
+			break;
+		case NL80211_CHAN_WIDTH_160:
+			s << "160";
+			break;
+		default:
+			s << "w" << info.width;
+			break;
+	}
+	s << "MHz";
+	if (info.centerFreq1 != 0 && info.centerFreq1 != info.freq)
+	{
+		s << " cf1:" << info.centerFreq1;
+	}
+	if (info.centerFreq2 != 0)
+	{
+		s << " cf2:" << info.centerFreq2;
+	}
+	if (info.txPowerKnown)
+	{
+		s << " " << (info.txPowerMbm / 100) << "dBm";
+	}
+	strChannel = s.str();
+}
+
 void Nl80211InterfaceAdmin::LogInterfaceList(const char *caller)
 {
 	int j;
@@ -105,14 +153,17 @@ void Nl80211InterfaceAdmin::LogInterfaceList(const char *caller)
 	stringstream s;
 	s << "Nl80211Base: " << caller << ":";
 	LogInfo(s);
+	// (A copy: the ioctls below are too slow to do under the lock.)
+	vector<OneInterface> interfaces = InterfaceSnapshot();
 	stringstream s2;
-	s2 << "Interface List has " << m_interfaces.size() << " elements:";
+	s2 << "Interface List has " << interfaces.size() << " elements:";
 	LogInfo(s2);
 
-	LogInfo("#\tName:\tPhy\tType        \tMAC            \tFreq");
+	LogInfo("#\tName:\tPhy\tType        \tMAC            \tFreq\tChannel");
 	j = 0;
-	for (OneInterface *i : m_interfaces)
+	for (OneInterface& iface : interfaces)
 	{
+		OneInterface *i = &iface;
 		stringstream info;
 		string strIftype;
 		char buf[32];
@@ -120,19 +171,13 @@ void Nl80211InterfaceAdmin::LogInterfaceList(const char *caller)
 		sprintf(buf, "%02x:%02x:%02x:%02x:%02x:%02x",
 			p[0], p[1], p[2], p[3], p[4], p[5]);
 		IfTypeToString(i->iftype, strIftype);
-/*** TODO: Frequency SIOCGIFFREQ ALWAYS returns Invalid argument
-** something about IFACE has to be UP and CONNECTED or some such.
-		int32_t mantissa = 0;
-    int16_t exponent = 0;
-    ifIoctls.GetFrequency(i->name, mantissa, exponent);
-	
+		// (SIOCGIWFREQ always returns EINVAL, the channel comes from
+		// nl80211 now; see ChannelToString())
+		string strChannel;
+		ChannelToString(i->channel, strChannel);
 		info << j << "\t" << i->name << "\t" << i->phy
 			<< "\t" << strIftype << "\t" << buf << "\t" <<
-      i->freq << "\t" << "M: " << mantissa << ", E: " << exponent << "\t";
-*****/
-		info << j << "\t" << i->name << "\t" << i->phy
-			<< "\t" << strIftype << "\t" << buf << "\t" <<
-      i->freq << "\t";
+      i->freq << "\t" << strChannel << "\t";
 		int flags;
 		bool isUp;
 		bool isRunning;
@@ -162,24 +207,35 @@ void Nl80211InterfaceAdmin::LogInterfaceList(const char *caller)
 	LogInfo("============ End of Interface List ============");
 }
 
+bool Nl80211InterfaceAdmin::ReadInterfaceChannel(const char *interfaceName, ChannelInfo& info)
+{
+	uint32_t ifIndex;
+	if (!GetInterfaceIndex(interfaceName, ifIndex))
+	{
+		return false;
+	}
+	if (!Open())
+	{
+		LogErr(AT, "ReadInterfaceChannel(): Can't connect to NL80211.");
+		return false;
+	}
+	bool rv = GetInterfaceChannel(ifIndex, info);
+	Close();
+	if (rv)
+	{
+		CacheInterfaceChannel(ifIndex, info);
+	}
+	return rv;
+}
+
 // NL80211_CMD_SET_INTERFACE: Set type of a virtual interface.
 // Requires:
 //    NL80211_ATTR_IFINDEX and
 //    NL80211_ATTR_IFTYPE.
 bool Nl80211InterfaceAdmin::SetInterfaceMode(const char *interfaceName, InterfaceType itype)
 {
-	unsigned int ifIndex;
 	enum nl80211_iftype type;
-	
-	ifIndex = if_nametoindex(interfaceName);
-	if (ifIndex == 0)
-	{
-		string s("SetInterfaceType(): Can't get if index for interface: [");
-		s += interfaceName;
-		s += "]";
-		LogErr(AT, s);
-		return false;
-	}
+
 	switch (itype)
 	{
 		case InterfaceType::Station:
@@ -195,6 +251,41 @@ bool Nl80211InterfaceAdmin::SetInterfaceMode(const char *interfaceName, Interfac
 			LogErr(AT, "SetInterfaceType(): Unknown Iface Type, aborting...");
 			return false;
 	}
+	return _setInterface(interfaceName, true, type, nullptr);
+}
+
+bool Nl80211InterfaceAdmin::SetInterfaceMode(const char *interfaceName, InterfaceType itype,
+	const MonitorOptions& options)
+{
+	if (itype != InterfaceType::Monitor)
+	{
+		LogErr(AT, "SetInterfaceMode(): monitor options need InterfaceType::Monitor.");
+		return false;
+	}
+	return _setInterface(interfaceName, true, NL80211_IFTYPE_MONITOR, &options);
+}
+
+bool Nl80211InterfaceAdmin::SetMonitorOptions(const char *interfaceName, const MonitorOptions& options)
+{
+	return _setInterface(interfaceName, false, NL80211_IFTYPE_MONITOR, &options);
+}
+
+// _setInterface(): private: NL80211_ATTR_IFINDEX, NL80211_ATTR_IFTYPE
+// (if 'setType'), monitor options (if any).
+bool Nl80211InterfaceAdmin::_setInterface(const char *interfaceName, bool setType,
+	enum nl80211_iftype type, const MonitorOptions *options)
+{
+	unsigned int ifIndex;
+	
+	ifIndex = if_nametoindex(interfaceName);
+	if (ifIndex == 0)
+	{
+		string s("SetInterfaceType(): Can't get if index for interface: [");
+		s += interfaceName;
+		s += "]";
+		LogErr(AT, s);
+		return false;
+	}
 
 	if (!Open())
 	{
@@ -210,7 +301,8 @@ bool Nl80211InterfaceAdmin::SetInterfaceMode(const char *interfaceName, Interfac
 	}
 	// NL80211_ATTR_IFINDEX, NL80211_ATTR_IFTYPE.
 	if (!AddMessageParameterU32(NL80211_ATTR_IFINDEX, ifIndex)
-		|| !AddMessageParameterU32(NL80211_ATTR_IFTYPE, type))
+		|| (setType && !AddMessageParameterU32(NL80211_ATTR_IFTYPE, type))
+		|| (options != nullptr && !AddMonitorOptions(*options)))
 	{
 		Close();
 		// Detailed error already logged...
@@ -227,13 +319,106 @@ bool Nl80211InterfaceAdmin::SetInterfaceMode(const char *interfaceName, Interfac
 	}
 
 	Close();
+	if (options != nullptr)
+	{
+		LogInfo(string("SetInterfaceType(): ") + interfaceName + " monitor options: " + options->Describe());
+	}
 	LogInfo("SetInterfaceType() complete, success");
 	return true;
 }
 
+// Adds the monitor options to the message being built (only what is set:
+// no MNTR_FLAGS at all leaves the kernel's default).
+bool Nl80211InterfaceAdmin::AddMonitorOptions(const MonitorOptions& options)
+{
+	if (options.sendFlags)
+	{
+		vector<int> flags;
+		if (options.fcsFail)
+		{
+			flags.push_back(NL80211_MNTR_FLAG_FCSFAIL);
+		}
+		if (options.plcpFail)
+		{
+			flags.push_back(NL80211_MNTR_FLAG_PLCPFAIL);
+		}
+		if (options.control)
+		{
+			flags.push_back(NL80211_MNTR_FLAG_CONTROL);
+		}
+		if (options.otherBss)
+		{
+			flags.push_back(NL80211_MNTR_FLAG_OTHER_BSS);
+		}
+		if (options.cookFrames)
+		{
+			flags.push_back(NL80211_MNTR_FLAG_COOK_FRAMES);
+		}
+		if (options.active)
+		{
+			flags.push_back(NL80211_MNTR_FLAG_ACTIVE);
+		}
+		if (!AddMessageParameterNestedFlags(NL80211_ATTR_MNTR_FLAGS, flags))
+		{
+			return false;
+		}
+	}
+	if (options.followGroup && !AddMessageParameterBinary(NL80211_ATTR_MU_MIMO_GROUP_DATA,
+		options.groupData, sizeof(options.groupData)))
+	{
+		return false;
+	}
+	if (options.followMac && !AddMessageParameterBinary(NL80211_ATTR_MU_MIMO_FOLLOW_MAC_ADDR,
+		options.followMacAddr, sizeof(options.followMacAddr)))
+	{
+		return false;
+	}
+	return true;
+}
+
+// EnsureInterfaceMode(): SetInterfaceMode() can take up to forty seconds
+// on some drivers, skip it if m_interfaces (from the last GET_INTERFACE
+// dump) already shows the interface in the requested mode.
+bool Nl80211InterfaceAdmin::EnsureInterfaceMode(const char *interfaceName, InterfaceType itype,
+	ApplyReport& report)
+{
+	uint32_t want;
+	switch (itype)
+	{
+		case InterfaceType::Station:
+			want = NL80211_IFTYPE_STATION;
+			break;
+		case InterfaceType::Ap:
+			want = NL80211_IFTYPE_AP;
+			break;
+		case InterfaceType::Monitor:
+			want = NL80211_IFTYPE_MONITOR;
+			break;
+		default:
+			want = NL80211_IFTYPE_UNSPECIFIED;
+			break;
+	}
+	for (const OneInterface& i : InterfaceSnapshot())
+	{
+		if (strcmp(i.name, interfaceName) == 0 && i.iftype == want)
+		{
+			report.Skipped(string("MODE(") + interfaceName + ")");
+			return true;
+		}
+	}
+	if (!SetInterfaceMode(interfaceName, itype))
+	{
+		report.Failed();
+		return false;
+	}
+	report.Applied();
+	return true;
+}
+
 // _createInterface(): private:
 bool Nl80211InterfaceAdmin::_createInterface(const char *newInterfaceName, 
-	uint32_t phyId, enum nl80211_iftype type)
+	uint32_t phyId, enum nl80211_iftype type, const MonitorOptions *options,
+	bool socketOwner)
 {
 	// "NL80211_CMD_NEW_INTERFACE: ... sent from userspace to request
 	// creation of a new virtual interface, requires attributes:
@@ -241,7 +426,18 @@ bool Nl80211InterfaceAdmin::_createInterface(const char *newInterfaceName,
 	// ATTR_WIPHY is also known as 'phyId' in Nl80211Base
 	// or OneInterface->phy (type: uint32_t). Its the physical Device Id.
 	// Usually Phy #0 is the built-in TI chip, Phy #1 is USB radio.
-	if (!Open())
+	// socketOwner: sent on the connection the caller keeps open
+	// (Nl80211VifOwner) with NL80211_ATTR_SOCKET_OWNER; the kernel deletes
+	// the interface when that connection closes (exit, crash, kill -9).
+	auto finish = [this, socketOwner]()
+	{
+		FreeMessage();
+		if (!socketOwner)
+		{
+			Close();
+		}
+	};
+	if (!socketOwner && !Open())
 	{
 		LogErr(AT, "_createInterface(): Can't connect to NL80211.");
 		return false;
@@ -249,16 +445,18 @@ bool Nl80211InterfaceAdmin::_createInterface(const char *newInterfaceName,
 
 	if (!SetupMessage(0, NL80211_CMD_NEW_INTERFACE))
 	{
-		Close();
+		finish();
 		LogErr(AT, "_createInterface(): SetupMessage failed.");
 		return false;
 	}
 
 	if (!AddMessageParameterU32(NL80211_ATTR_WIPHY, phyId)
 		|| !AddMessageParameterString(NL80211_ATTR_IFNAME, newInterfaceName)
-		|| !AddMessageParameterU32(NL80211_ATTR_IFTYPE, type))
+		|| !AddMessageParameterU32(NL80211_ATTR_IFTYPE, type)
+		|| (options != nullptr && !AddMonitorOptions(*options))
+		|| (socketOwner && !AddMessageParameterFlag(NL80211_ATTR_SOCKET_OWNER)))
 	{
-		Close();
+		finish();
 		// Detailed error already logged...
 		LogErr(AT, "_createInterface(): AddParam() failed.");
 		return false;
@@ -266,16 +464,16 @@ bool Nl80211InterfaceAdmin::_createInterface(const char *newInterfaceName,
 
 	if (!SendAndFreeMessage(true))
 	{
-		Close();
+		finish();
 		// Detailed error already logged...
 		LogErr(AT, "_createInterface(): Send...() failed.");
 		return false;
 	}
 
-	Close();
+	finish();
 	string cs("_createInterface('");
 	cs += newInterfaceName;
-	cs += "') complete, success.";
+	cs += socketOwner ? "', socket owned) complete, success." : "') complete, success.";
 	LogInfo(cs);
 
 	return true;
@@ -311,6 +509,12 @@ bool Nl80211InterfaceAdmin::CreateMonitorInterface(const char *newInterfaceName,
 	return _createInterface(newInterfaceName, phyId, NL80211_IFTYPE_MONITOR);
 }
 
+bool Nl80211InterfaceAdmin::CreateMonitorInterface(const char *newInterfaceName,
+	uint32_t phyId, const MonitorOptions& options)
+{
+	return _createInterface(newInterfaceName, phyId, NL80211_IFTYPE_MONITOR, &options);
+}
+
 bool Nl80211InterfaceAdmin::DeleteInterface(const char *interfaceName)
 {
 	unsigned int ifIndex;
@@ -360,3 +564,62 @@ bool Nl80211InterfaceAdmin::DeleteInterface(const char *interfaceName)
 	return true;
 }
 
+// DeleteInterfaces(): one connection, every DEL_INTERFACE sent before
+// the first ACK is read (the kernel handles them in order), so a batch
+// costs about one round trip instead of an open / send / wait / close
+// per interface.
+bool Nl80211InterfaceAdmin::DeleteInterfaces(const vector<string>& interfaceNames, size_t& deleted)
+{
+	deleted = 0;
+	if (interfaceNames.empty())
+	{
+		return true;
+	}
+	if (!Open())
+	{
+		LogErr(AT, "DeleteInterfaces(): Can't connect to NL80211.");
+		return false;
+	}
+	vector<uint32_t> seqs;
+	vector<string> sent;
+	for (const string& name : interfaceNames)
+	{
+		uint32_t ifIndex = if_nametoindex(name.c_str());
+		if (ifIndex == 0)
+		{
+			LogErr(AT, "DeleteInterfaces(): Can't get if index for interface: [" + name + "]");
+			continue;
+		}
+		uint32_t seq;
+		if (!SetupMessage(NLM_F_ACK, NL80211_CMD_DEL_INTERFACE)
+			|| !AddMessageParameterU32(NL80211_ATTR_IFINDEX, ifIndex))
+		{
+			FreeMessage();
+			LogErr(AT, "DeleteInterfaces(): can't build message.");
+			continue;
+		}
+		if (!SendNoWait(seq))
+		{
+			continue;
+		}
+		seqs.push_back(seq);
+		sent.push_back(name);
+	}
+	for (size_t i = 0; i < seqs.size(); i++)
+	{
+		if (WaitForAck(seqs[i]))
+		{
+			deleted++;
+		}
+		else
+		{
+			LogErr(AT, "DeleteInterfaces(): [" + sent[i] + "] not deleted.");
+		}
+	}
+	Close();
+	stringstream s;
+	s << "DeleteInterfaces(): " << deleted << " of " << interfaceNames.size() << " deleted.";
+	LogInfo(s);
+	return deleted == interfaceNames.size();
+}
+
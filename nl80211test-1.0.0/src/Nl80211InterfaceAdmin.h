@@ -8,6 +8,7 @@
 #include <string>
 #include <sstream>
 #include <cstdio>
+#include <vector>
 
 #include <stdint.h>
 #include <unistd.h>
@@ -18,9 +19,11 @@
 #include <errno.h>
 
 #include "IfIoctls.h"
+#include "InterfaceState.h"
 #include "Log.h"
 #include "Nl80211Base.h"
 #include "TextColor.h"
+#include "MonitorOptions.h"
 
 using namespace std;
 
@@ -37,17 +40,42 @@ public:
 	Nl80211InterfaceAdmin(const char *name);
 	bool GetInterfaceList();
 	void LogInterfaceList(const char *caller);
+	// One-shot channel read-back (opens and closes the nl80211 connection),
+	// updates the cached copy in m_interfaces:
+	bool ReadInterfaceChannel(const char *interfaceName, ChannelInfo& info);
 //protected:  Allow main() to interactively use all of these TODO: restore "protected"
 //	bool GetInterfaceList();
 	bool SetInterfaceMode(const char *interfaceName, InterfaceType itype);
+	// InterfaceType::Monitor only: mode and monitor options in one command.
+	bool SetInterfaceMode(const char *interfaceName, InterfaceType itype,
+		const MonitorOptions& options);
+	// Interface already in monitor mode: just the options (no mode switch,
+	// quick; 'active' can only change while the interface is down):
+	bool SetMonitorOptions(const char *interfaceName, const MonitorOptions& options);
+	// Only calls SetInterfaceMode() if the last GetInterfaceList()
+	// shows the interface in some other mode:
+	bool EnsureInterfaceMode(const char *interfaceName, InterfaceType itype, ApplyReport& report);
 	bool CreateApInterface(const char *newInterfaceName, uint32_t phyId);
 	bool CreateStationInterface(const char *newInterfaceName, uint32_t phyId);
 	bool CreateMonitorInterface(const char *newInterfaceName, uint32_t phyId);
+	bool CreateMonitorInterface(const char *newInterfaceName, uint32_t phyId,
+		const MonitorOptions& options);
 	bool DeleteInterface(const char *interfaceName);
+	// Several at once, batched on one connection; 'deleted' how many went.
+	bool DeleteInterfaces(const vector<string>& interfaceNames, size_t& deleted);
+protected:
+	// socketOwner: on the already open connection, owned by it
+	// (NL80211_ATTR_SOCKET_OWNER, see Nl80211VifOwner).
+	bool _createInterface(const char *newInterfaceName, 
+		uint32_t phyId, enum nl80211_iftype type, const MonitorOptions *options = nullptr,
+		bool socketOwner = false);
 private:
 	void IfTypeToString(uint32_t iftype, string& strType);
-	bool _createInterface(const char *newInterfaceName, 
-		uint32_t phyId, enum nl80211_iftype type);
+	void ChannelToString(const ChannelInfo& info, string& strChannel);
+	// NL80211_CMD_SET_INTERFACE; 'setType' false: options only.
+	bool _setInterface(const char *interfaceName, bool setType,
+		enum nl80211_iftype type, const MonitorOptions *options);
+	bool AddMonitorOptions(const MonitorOptions& options);
 };
 
 #endif  // NL80211INTERFACEADMIN_H_
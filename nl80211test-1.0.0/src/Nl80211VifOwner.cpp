@@ -0,0 +1,82 @@
+// Nl80211VifOwner.cpp
+// Socket owned interfaces, see Nl80211VifOwner.h.
+
+#include "Nl80211VifOwner.h"
+
+Nl80211VifOwner::Nl80211VifOwner() : Nl80211InterfaceAdmin("Nl80211VifOwner") { }
+
+Nl80211VifOwner::~Nl80211VifOwner()
+{
+	CloseConnection();
+}
+
+bool Nl80211VifOwner::OpenConnection()
+{
+	if (m_isOpen)
+	{
+		return true;
+	}
+	if (!Open())
+	{
+		LogErr(AT, "OpenConnection(): Can't connect to NL80211.");
+		return false;
+	}
+	m_isOpen = true;
+	return true;
+}
+
+bool Nl80211VifOwner::CloseConnection()
+{
+	if (m_isOpen)
+	{
+		Close();
+		m_isOpen = false;
+		if (!m_owned.empty())
+		{
+			stringstream s;
+			s << "CloseConnection(): " << m_owned.size() << " owned interface(s) released.";
+			LogInfo(s);
+		}
+		m_owned.clear();
+	}
+	return true;
+}
+
+bool Nl80211VifOwner::IsOpen()
+{
+	return m_isOpen;
+}
+
+bool Nl80211VifOwner::CreateOwnedInterface(const char *newInterfaceName, uint32_t phyId,
+	InterfaceType itype, const MonitorOptions *options)
+{
+	if (!m_isOpen)
+	{
+		LogErr(AT, "CreateOwnedInterface(): not open.");
+		return false;
+	}
+	enum nl80211_iftype type = NL80211_IFTYPE_STATION;
+	if (itype == InterfaceType::Ap)
+	{
+		type = NL80211_IFTYPE_AP;
+	}
+	else if (itype == InterfaceType::Monitor)
+	{
+		type = NL80211_IFTYPE_MONITOR;
+	}
+	else
+	{
+		options = nullptr;
+	}
+	if (!_createInterface(newInterfaceName, phyId, type, options, true))
+	{
+		return false;
+	}
+	m_owned.push_back(newInterfaceName);
+	return true;
+}
+
+const vector<string>& Nl80211VifOwner::GetOwnedInterfaces()
+{
+	return m_owned;
+}
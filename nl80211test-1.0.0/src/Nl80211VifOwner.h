@@ -0,0 +1,47 @@
+// Nl80211VifOwner.h
+// Interfaces that can't outlive us: created with NL80211_ATTR_SOCKET_OWNER
+// on a connection this class keeps open, so the kernel deletes them the
+// moment that connection closes, CloseConnection(), exit, crash or
+// kill -9 alike. A restart then starts from the radios' own interfaces
+// and nothing is left to clean up.
+// (A kernel that predates the attribute ignores it and creates an
+// ordinary, lasting interface; InterfaceManagerNl80211::Init()'s sweep
+// still gets those.)
+
+#ifndef NL80211VIFOWNER_H_
+#define NL80211VIFOWNER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include <stdint.h>
+
+#include "Log.h"
+#include "Nl80211InterfaceAdmin.h"
+#include "MonitorOptions.h"
+
+using namespace std;
+
+class Nl80211VifOwner : public Nl80211InterfaceAdmin
+{
+public:
+	Nl80211VifOwner();
+	// (Closes: everything created here goes away.)
+	~Nl80211VifOwner();
+	bool OpenConnection();
+	// Deletes every interface created since OpenConnection():
+	bool CloseConnection();
+	bool IsOpen();
+	// Connection must be open. 'options': monitor interfaces only.
+	bool CreateOwnedInterface(const char *newInterfaceName, uint32_t phyId,
+		InterfaceType itype, const MonitorOptions *options = nullptr);
+	// Names asked for (the driver may have picked other ones):
+	const vector<string>& GetOwnedInterfaces();
+private:
+	bool m_isOpen = false;
+	vector<string> m_owned;
+};
+
+#endif  // NL80211VIFOWNER_H_
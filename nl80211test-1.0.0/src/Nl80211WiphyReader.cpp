@@ -0,0 +1,327 @@
+// Nl80211WiphyReader.cpp
+// NL80211_CMD_GET_WIPHY (bands / frequencies / flags, interface types and
+// combinations) and NL80211_CMD_GET_REG (regulatory domain rules).
+
+#include "Nl80211WiphyReader.h"
+
+Nl80211WiphyReader::Nl80211WiphyReader() : Nl80211Base("Nl80211WiphyReader") { }
+
+// Dump(): open, send 'cmd' (flags: NLM_F_DUMP, or NLM_F_ACK for a single
+// reply), run 'handler' on every reply, close.
+bool Nl80211WiphyReader::Dump(uint8_t cmd, int flags, nl_recvmsg_msg_cb_t handler,
+	void *data, bool havePhy, uint32_t phy)
+{
+	if (!Open())
+	{
+		LogErr(AT, "Nl80211 open failed.");
+		return false;
+	}
+	if (!SetupCallback(handler))
+	{
+		Close();
+		return false;
+	}
+	SetCallbackData(data);
+	bool ok = SetupMessage(flags, cmd);
+	if (ok && havePhy)
+	{
+		ok = AddMessageParameterU32(NL80211_ATTR_WIPHY, phy);
+	}
+	if (ok && cmd == NL80211_CMD_GET_WIPHY)
+	{
+		// Modern radios' band info doesn't fit in one message:
+		ok = AddMessageParameterFlag(NL80211_ATTR_SPLIT_WIPHY_DUMP);
+	}
+	if (!ok)
+	{
+		LogErr(AT, "Dump(): can't build message.");
+		Close();
+		return false;
+	}
+	ok = SendWithRepeatingResponses();
+	Close();
+	return ok;
+}
+
+bool Nl80211WiphyReader::GetWiphyChannels(uint32_t phy, vector<WiphyChannel>& channels)
+{
+	channels.clear();
+	WiphyQuery query;
+	query.phy = phy;
+	query.channels = &channels;
+	if (!Dump(NL80211_CMD_GET_WIPHY, NLM_F_DUMP, wiphy_channels_handler, &query, true, phy))
+	{
+		stringstream s;
+		s << "GetWiphyChannels(phy" << phy << ") failed.";
+		LogErr(AT, s);
+		return false;
+	}
+	if (channels.empty())
+	{
+		stringstream s;
+		s << "GetWiphyChannels(phy" << phy << "): no channels reported.";
+		LogErr(AT, s);
+		return false;
+	}
+	return true;
+}
+
+bool Nl80211WiphyReader::GetWiphyCapabilities(uint32_t phy, WiphyCapabilities& caps)
+{
+	vector<WiphyCapabilities> all;
+	if (!Dump(NL80211_CMD_GET_WIPHY, NLM_F_DUMP, wiphy_caps_handler, &all, true, phy))
+	{
+		stringstream s;
+		s << "GetWiphyCapabilities(phy" << phy << ") failed.";
+		LogErr(AT, s);
+		return false;
+	}
+	// (Older kernels ignore the WIPHY filter on a dump)
+	for (const WiphyCapabilities& c : all)
+	{
+		if (c.phy == phy)
+		{
+			caps = c;
+			return true;
+		}
+	}
+	stringstream s;
+	s << "GetWiphyCapabilities(phy" << phy << "): not reported.";
+	LogErr(AT, s);
+	return false;
+}
+
+bool Nl80211WiphyReader::GetAllWiphyCapabilities(vector<WiphyCapabilities>& caps)
+{
+	caps.clear();
+	if (!Dump(NL80211_CMD_GET_WIPHY, NLM_F_DUMP, wiphy_caps_handler, &caps, false, 0))
+	{
+		LogErr(AT, "GetAllWiphyCapabilities() failed.");
+		return false;
+	}
+	return true;
+}
+
+bool Nl80211WiphyReader::GetRegDomain(RegDomain& domain)
+{
+	domain = RegDomain();
+	return Dump(NL80211_CMD_GET_REG, NLM_F_ACK, reg_handler, &domain, false, 0);
+}
+
+bool Nl80211WiphyReader::GetRegDomain(uint32_t phy, RegDomain& domain)
+{
+	domain = RegDomain();
+	return Dump(NL80211_CMD_GET_REG, NLM_F_ACK, reg_handler, &domain, true, phy);
+}
+
+int Nl80211WiphyReader::wiphy_channels_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	WiphyQuery *query = (WiphyQuery *)info->data;
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
+	struct nlattr *band;
+	struct nlattr *freq;
+	int remBand;
+	int remFreq;
+
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	// (Older kernels ignore the WIPHY filter on a dump)
+	if (tb_msg[NL80211_ATTR_WIPHY] && nla_get_u32(tb_msg[NL80211_ATTR_WIPHY]) != query->phy)
+	{
+		return NL_SKIP;
+	}
+	// Split dumps: only some of the messages carry (part of) the bands.
+	if (!tb_msg[NL80211_ATTR_WIPHY_BANDS])
+	{
+		return NL_SKIP;
+	}
+	nla_for_each_nested(band, tb_msg[NL80211_ATTR_WIPHY_BANDS], remBand)
+	{
+		struct nlattr *tb_band[NL80211_BAND_ATTR_MAX + 1];
+		nla_parse(tb_band, NL80211_BAND_ATTR_MAX, (nlattr *)nla_data(band), nla_len(band), NULL);
+		if (!tb_band[NL80211_BAND_ATTR_FREQS])
+		{
+			continue;
+		}
+		nla_for_each_nested(freq, tb_band[NL80211_BAND_ATTR_FREQS], remFreq)
+		{
+			struct nlattr *tb_freq[NL80211_FREQUENCY_ATTR_MAX + 1];
+			nla_parse(tb_freq, NL80211_FREQUENCY_ATTR_MAX, (nlattr *)nla_data(freq), nla_len(freq), NULL);
+			if (!tb_freq[NL80211_FREQUENCY_ATTR_FREQ])
+			{
+				continue;
+			}
+			WiphyChannel ch;
+			ch.freq = nla_get_u32(tb_freq[NL80211_FREQUENCY_ATTR_FREQ]);
+			ch.known = ChannelTables::FrequencyToChannel(ch.freq, ch.band, ch.channel);
+			ch.disabled = (tb_freq[NL80211_FREQUENCY_ATTR_DISABLED] != nullptr);
+			// (Was PASSIVE_SCAN / NO_IBSS on older kernels, same attribute #)
+			ch.noIr = (tb_freq[NL80211_FREQUENCY_ATTR_NO_IR] != nullptr);
+			ch.radar = (tb_freq[NL80211_FREQUENCY_ATTR_RADAR] != nullptr);
+			if (tb_freq[NL80211_FREQUENCY_ATTR_MAX_TX_POWER])
+			{
+				ch.maxTxPowerMbm = nla_get_u32(tb_freq[NL80211_FREQUENCY_ATTR_MAX_TX_POWER]);
+			}
+			query->channels->push_back(ch);
+		}
+	}
+	return NL_SKIP;
+}
+
+int Nl80211WiphyReader::reg_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	RegDomain *domain = (RegDomain *)info->data;
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
+	struct nlattr *rule;
+	int remRule;
+
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	if (tb_msg[NL80211_ATTR_REG_ALPHA2])
+	{
+		domain->alpha2 = nla_get_string(tb_msg[NL80211_ATTR_REG_ALPHA2]);
+	}
+	if (!tb_msg[NL80211_ATTR_REG_RULES])
+	{
+		return NL_SKIP;
+	}
+	nla_for_each_nested(rule, tb_msg[NL80211_ATTR_REG_RULES], remRule)
+	{
+		struct nlattr *tb_rule[NL80211_REG_RULE_ATTR_MAX + 1];
+		nla_parse(tb_rule, NL80211_REG_RULE_ATTR_MAX, (nlattr *)nla_data(rule), nla_len(rule), NULL);
+		if (!tb_rule[NL80211_ATTR_FREQ_RANGE_START] || !tb_rule[NL80211_ATTR_FREQ_RANGE_END])
+		{
+			continue;
+		}
+		RegRule r;
+		r.startKhz = nla_get_u32(tb_rule[NL80211_ATTR_FREQ_RANGE_START]);
+		r.endKhz = nla_get_u32(tb_rule[NL80211_ATTR_FREQ_RANGE_END]);
+		if (tb_rule[NL80211_ATTR_FREQ_RANGE_MAX_BW])
+		{
+			r.maxBwKhz = nla_get_u32(tb_rule[NL80211_ATTR_FREQ_RANGE_MAX_BW]);
+		}
+		if (tb_rule[NL80211_ATTR_REG_RULE_FLAGS])
+		{
+			r.flags = nla_get_u32(tb_rule[NL80211_ATTR_REG_RULE_FLAGS]);
+		}
+		if (tb_rule[NL80211_ATTR_POWER_RULE_MAX_EIRP])
+		{
+			r.maxEirpMbm = nla_get_u32(tb_rule[NL80211_ATTR_POWER_RULE_MAX_EIRP]);
+		}
+		domain->rules.push_back(r);
+	}
+	return NL_SKIP;
+}
+
+uint32_t Nl80211WiphyReader::IfTypeMask(struct nlattr *nest)
+{
+	struct nlattr *type;
+	int remType;
+	uint32_t mask = 0;
+	nla_for_each_nested(type, nest, remType)
+	{
+		if (nla_type(type) < 32)
+		{
+			mask |= 1u << nla_type(type);
+		}
+	}
+	return mask;
+}
+
+void Nl80211WiphyReader::ParseCombination(struct nlattr *comb, IfaceCombination& c)
+{
+	struct nlattr *tb_comb[MAX_NL80211_IFACE_COMB + 1];
+	struct nlattr *limit;
+	int remLimit;
+
+	nla_parse(tb_comb, MAX_NL80211_IFACE_COMB, (nlattr *)nla_data(comb), nla_len(comb), NULL);
+	if (tb_comb[NL80211_IFACE_COMB_MAXNUM])
+	{
+		c.maxInterfaces = nla_get_u32(tb_comb[NL80211_IFACE_COMB_MAXNUM]);
+	}
+	if (tb_comb[NL80211_IFACE_COMB_NUM_CHANNELS])
+	{
+		c.numChannels = nla_get_u32(tb_comb[NL80211_IFACE_COMB_NUM_CHANNELS]);
+	}
+	c.staApBeaconMatch = (tb_comb[NL80211_IFACE_COMB_STA_AP_BI_MATCH] != nullptr);
+	if (tb_comb[NL80211_IFACE_COMB_RADAR_DETECT_WIDTHS])
+	{
+		c.radarDetectWidths = nla_get_u32(tb_comb[NL80211_IFACE_COMB_RADAR_DETECT_WIDTHS]);
+	}
+	if (!tb_comb[NL80211_IFACE_COMB_LIMITS])
+	{
+		return;
+	}
+	nla_for_each_nested(limit, tb_comb[NL80211_IFACE_COMB_LIMITS], remLimit)
+	{
+		struct nlattr *tb_limit[MAX_NL80211_IFACE_LIMIT + 1];
+		nla_parse(tb_limit, MAX_NL80211_IFACE_LIMIT, (nlattr *)nla_data(limit), nla_len(limit), NULL);
+		if (!tb_limit[NL80211_IFACE_LIMIT_MAX] || !tb_limit[NL80211_IFACE_LIMIT_TYPES])
+		{
+			continue;
+		}
+		IfaceLimit l;
+		l.max = nla_get_u32(tb_limit[NL80211_IFACE_LIMIT_MAX]);
+		l.types = IfTypeMask(tb_limit[NL80211_IFACE_LIMIT_TYPES]);
+		c.limits.push_back(l);
+	}
+}
+
+int Nl80211WiphyReader::wiphy_caps_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	vector<WiphyCapabilities> *all = (vector<WiphyCapabilities> *)info->data;
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
+	struct nlattr *comb;
+	int remComb;
+
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	if (!tb_msg[NL80211_ATTR_WIPHY])
+	{
+		return NL_SKIP;
+	}
+	// Split dumps: several messages per radio, each with a part.
+	uint32_t phy = nla_get_u32(tb_msg[NL80211_ATTR_WIPHY]);
+	WiphyCapabilities *caps = nullptr;
+	for (WiphyCapabilities& c : *all)
+	{
+		if (c.phy == phy)
+		{
+			caps = &c;
+		}
+	}
+	if (caps == nullptr)
+	{
+		all->push_back(WiphyCapabilities());
+		caps = &all->back();
+		caps->phy = phy;
+	}
+	if (tb_msg[NL80211_ATTR_SUPPORTED_IFTYPES])
+	{
+		caps->supportedTypes = IfTypeMask(tb_msg[NL80211_ATTR_SUPPORTED_IFTYPES]);
+	}
+	if (tb_msg[NL80211_ATTR_SOFTWARE_IFTYPES])
+	{
+		caps->softwareTypes = IfTypeMask(tb_msg[NL80211_ATTR_SOFTWARE_IFTYPES]);
+	}
+	if (tb_msg[NL80211_ATTR_INTERFACE_COMBINATIONS])
+	{
+		caps->combinations.clear();
+		nla_for_each_nested(comb, tb_msg[NL80211_ATTR_INTERFACE_COMBINATIONS], remComb)
+		{
+			IfaceCombination c;
+			ParseCombination(comb, c);
+			caps->combinations.push_back(c);
+		}
+	}
+	return NL_SKIP;
+}
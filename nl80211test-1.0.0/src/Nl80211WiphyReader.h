@@ -0,0 +1,55 @@
+// Nl80211WiphyReader.h
+// Reads a radio's channel list / flags and its interface types and
+// combinations (NL80211_CMD_GET_WIPHY), and the current regulatory
+// domain (NL80211_CMD_GET_REG).
+// Like Nl80211InterfaceAdmin, each call opens and closes its own
+// nl80211 connection.
+
+#ifndef NL80211WIPHYREADER_H_
+#define NL80211WIPHYREADER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include <stdint.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+#include "WiphyInfo.h"
+#include "ChannelTables.h"
+
+using namespace std;
+
+class Nl80211WiphyReader : public Nl80211Base
+{
+public:
+	Nl80211WiphyReader();
+	bool GetWiphyChannels(uint32_t phy, vector<WiphyChannel>& channels);
+	// Interface types / combinations of one radio, or of every radio
+	// (in phy order):
+	bool GetWiphyCapabilities(uint32_t phy, WiphyCapabilities& caps);
+	bool GetAllWiphyCapabilities(vector<WiphyCapabilities>& caps);
+	// Global domain; radios with their own (self managed) domain
+	// answer for 'phy' if given.
+	bool GetRegDomain(RegDomain& domain);
+	bool GetRegDomain(uint32_t phy, RegDomain& domain);
+	static int wiphy_channels_handler(struct nl_msg *msg, void *arg);
+	static int reg_handler(struct nl_msg *msg, void *arg);
+	static int wiphy_caps_handler(struct nl_msg *msg, void *arg);
+private:
+	bool Dump(uint8_t cmd, int flags, nl_recvmsg_msg_cb_t handler, void *data,
+		bool havePhy, uint32_t phy);
+	// arg->data for wiphy_channels_handler():
+	struct WiphyQuery
+	{
+		uint32_t phy;
+		vector<WiphyChannel> *channels;
+	};
+	// A nest of NLA_FLAG-style attributes numbered by iftype, as a mask:
+	static uint32_t IfTypeMask(struct nlattr *nest);
+	static void ParseCombination(struct nlattr *comb, IfaceCombination& c);
+};
+
+#endif  // NL80211WIPHYREADER_H_
@@ -8,22 +8,29 @@
 
 #include <stdint.h>
 
+#include "ChannelInfo.h"
+
 using namespace std;
 
 class OneInterface
 {
 public:
 	uint32_t phy;
+	uint32_t ifIndex;
 	uint32_t iftype;
 	uint32_t freq;
 	int macLength;  // Reported by GET_INTERFACEs
 	char name[17];  // IFNAMSIZE is 16
 	uint8_t mac[6];
-	OneInterface(uint32_t thePhy, const char *ifaceName,
+	// Last channel read back from nl80211 (GET_INTERFACE dump,
+	// or Nl80211Base::GetInterfaceChannel() after a channel change):
+	ChannelInfo channel;
+	OneInterface(uint32_t thePhy, uint32_t theIfIndex, const char *ifaceName,
 		const uint8_t *macAddr, int reportedMacLength, uint32_t type,
 		uint32_t frequency)
 	{
 		phy = thePhy;
+		ifIndex = theIfIndex;
 		iftype = type;
 		freq = frequency;
 		macLength = reportedMacLength;
@@ -34,4 +41,3 @@ public:
 };
 
 #endif  // ONEINTERFACE_H_
-
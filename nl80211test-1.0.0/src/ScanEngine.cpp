@@ -0,0 +1,430 @@
+// ScanEngine.cpp
+// TRIGGER_SCAN, "scan" group events, incremental BSS table; see ScanEngine.h.
+
+#include "ScanEngine.h"
+
+string BssEntry::BssidString() const
+{
+	return MacToString(bssid);
+}
+
+// (cfg80211 itself expires BSSs after 30 seconds.)
+ScanEngine::ScanEngine() : Nl80211Base("ScanEngine"), m_maxAge(30000)
+{
+	m_dump.reserve(64);
+}
+
+ScanEngine::~ScanEngine()
+{
+	CloseConnection();
+}
+
+void ScanEngine::SetChangeHandler(BssChangeHandler handler)
+{
+	if (m_isOpen)
+	{
+		LogErr(AT, "SetChangeHandler(): already open, ignored.");
+		return;
+	}
+	m_handler = handler;
+}
+
+void ScanEngine::SetMaxAge(milliseconds maxAge)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_maxAge = maxAge;
+}
+
+bool ScanEngine::OpenConnection(const char *interfaceName)
+{
+	CloseConnection();
+	if (!Open())
+	{
+		LogErr(AT, "Can't connect to NL80211.");
+		return false;
+	}
+	if (!GetInterfaceIndex(interfaceName, m_interfaceIndex))
+	{
+		Close();
+		return false;
+	}
+	m_isOpen = true;
+	auto onEvent = [this](uint8_t cmd, struct nlattr **tb)
+	{
+		OnScanEvent(cmd, tb);
+	};
+	m_listener.AddGroup("scan");
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_TRIGGER_SCAN, onEvent));
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_NEW_SCAN_RESULTS, onEvent));
+	m_handlerIds.push_back(m_listener.AddHandler(NL80211_CMD_SCAN_ABORTED, onEvent));
+	if (!m_listener.Start())
+	{
+		LogErr(AT, "OpenConnection(): can't listen for scan events.");
+		CloseConnection();
+		return false;
+	}
+	// Whatever the kernel already has (earlier scans, anybody's):
+	if (DumpResults())
+	{
+		MergeResults();
+	}
+	return true;
+}
+
+bool ScanEngine::CloseConnection()
+{
+	// (Listener first: its thread dumps on our connection.)
+	m_listener.Stop();
+	for (int id : m_handlerIds)
+	{
+		m_listener.RemoveHandler(id);
+	}
+	m_handlerIds.clear();
+	if (m_isOpen)
+	{
+		lock_guard<mutex> lock(m_connMutex);
+		Close();
+		m_isOpen = false;
+	}
+	lock_guard<mutex> lock(m_mutex);
+	if (m_state == ScanState::Running)
+	{
+		m_state = ScanState::Aborted;
+		m_stateChanged.notify_all();
+	}
+	return true;
+}
+
+bool ScanEngine::Trigger(const ScanRequest& request)
+{
+	if (!m_isOpen)
+	{
+		LogErr(AT, "Trigger(): not open.");
+		return false;
+	}
+	{
+		// Before sending: the results can beat the ACK back to us.
+		lock_guard<mutex> lock(m_mutex);
+		m_state = ScanState::Running;
+		m_scanStarted = false;
+	}
+	bool ok;
+	{
+		lock_guard<mutex> lock(m_connMutex);
+		FreeMessage();
+		ok = SetupMessage(0, NL80211_CMD_TRIGGER_SCAN)
+			&& AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex);
+		if (ok && !request.freqs.empty())
+		{
+			ok = AddMessageParameterU32List(NL80211_ATTR_SCAN_FREQUENCIES, request.freqs);
+		}
+		if (ok && !request.ssids.empty())
+		{
+			ok = AddMessageParameterBinaryList(NL80211_ATTR_SCAN_SSIDS, request.ssids);
+		}
+		if (!ok)
+		{
+			FreeMessage();
+			LogErr(AT, "Trigger(): can't build message.");
+		}
+		else
+		{
+			ok = SendAndFreeMessage(true);
+		}
+	}
+	if (!ok)
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_state = ScanState::Failed;
+		m_stateChanged.notify_all();
+		return false;
+	}
+	stringstream s;
+	s << "Trigger(): scanning " << (request.freqs.empty() ? string("all") : to_string(request.freqs.size()))
+		<< " channel(s), " << request.ssids.size() << " SSID(s)";
+	LogInfo(s);
+	return true;
+}
+
+bool ScanEngine::Wait(milliseconds timeout)
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_stateChanged.wait_for(lock, timeout, [this]
+	{
+		return m_state != ScanState::Running;
+	});
+	return m_state == ScanState::Done;
+}
+
+ScanState ScanEngine::GetState()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_state;
+}
+
+void ScanEngine::GetTable(vector<BssEntry>& table)
+{
+	table.clear();
+	lock_guard<mutex> lock(m_mutex);
+	for (const auto& e : m_table)
+	{
+		table.push_back(e.second);
+	}
+}
+
+bool ScanEngine::GetBest(const string& ssid, BssEntry& best)
+{
+	lock_guard<mutex> lock(m_mutex);
+	const BssEntry *found = nullptr;
+	for (const auto& e : m_table)
+	{
+		if (e.second.ssid == ssid && (found == nullptr || e.second.signalMbm > found->signalMbm))
+		{
+			found = &e.second;
+		}
+	}
+	if (found == nullptr)
+	{
+		return false;
+	}
+	best = *found;
+	return true;
+}
+
+void ScanEngine::AgeOut()
+{
+	vector<BssDelta> deltas;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		AgeOut(NowNs(), deltas);
+	}
+	Notify(deltas);
+}
+
+void ScanEngine::AgeOut(int64_t nowNs, vector<BssDelta>& deltas)
+{
+	int64_t oldestNs = nowNs - (int64_t)duration_cast<nanoseconds>(m_maxAge).count();
+	for (auto it = m_table.begin(); it != m_table.end(); )
+	{
+		if (it->second.lastSeenNs < oldestNs)
+		{
+			BssDelta d;
+			d.change = BssChange::Removed;
+			d.bss = it->second;
+			deltas.push_back(d);
+			it = m_table.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void ScanEngine::Notify(const vector<BssDelta>& deltas)
+{
+	if (m_handler && !deltas.empty())
+	{
+		m_handler(deltas);
+	}
+}
+
+// (Listener thread.) Events for other interfaces are skipped; results
+// from scans we didn't trigger still update the table, but only end our
+// scan if it has started: the kernel runs one scan at a time per radio,
+// so once our trigger is sent, the next scan to start on the interface
+// is ours (anybody else's would have made the trigger fail, EBUSY), and
+// results or an abort before that belong to somebody's earlier scan.
+void ScanEngine::OnScanEvent(uint8_t cmd, struct nlattr **tb)
+{
+	if (!tb[NL80211_ATTR_IFINDEX] || nla_get_u32(tb[NL80211_ATTR_IFINDEX]) != m_interfaceIndex)
+	{
+		return;
+	}
+	if (cmd == NL80211_CMD_TRIGGER_SCAN)
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_state == ScanState::Running)
+		{
+			m_scanStarted = true;
+		}
+	}
+	else if (cmd == NL80211_CMD_NEW_SCAN_RESULTS)
+	{
+		bool ok = DumpResults();
+		if (ok)
+		{
+			MergeResults();
+		}
+		lock_guard<mutex> lock(m_mutex);
+		if (m_state == ScanState::Running && m_scanStarted)
+		{
+			m_state = ok ? ScanState::Done : ScanState::Failed;
+			m_stateChanged.notify_all();
+		}
+	}
+	else if (cmd == NL80211_CMD_SCAN_ABORTED)
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_state == ScanState::Running && m_scanStarted)
+		{
+			LogInfo("OnScanEvent(): scan aborted.");
+			m_state = ScanState::Aborted;
+			m_stateChanged.notify_all();
+		}
+	}
+}
+
+// GET_SCAN dump (the kernel's whole BSS cache for the interface) into m_dump.
+bool ScanEngine::DumpResults()
+{
+	lock_guard<mutex> lock(m_connMutex);
+	m_dump.clear();
+	if (!m_isOpen)
+	{
+		return false;
+	}
+	FreeMessage();
+	if (!SetupCallback(scan_handler))
+	{
+		return false;
+	}
+	SetCallbackData(&m_dump);
+	if (!SetupMessage(NLM_F_DUMP, NL80211_CMD_GET_SCAN)
+		|| !AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex))
+	{
+		FreeMessage();
+		LogErr(AT, "DumpResults(): can't build message.");
+		return false;
+	}
+	bool ok = SendWithRepeatingResponses();
+	FreeMessage();
+	SetCallbackData(nullptr);
+	return ok;
+}
+
+// m_dump into m_table: add / refresh / update, then age out; the
+// handler gets the differences.
+void ScanEngine::MergeResults()
+{
+	vector<BssDelta> deltas;
+	{
+		lock_guard<mutex> connLock(m_connMutex);
+		lock_guard<mutex> lock(m_mutex);
+		for (BssEntry& bss : m_dump)
+		{
+			auto it = m_table.find(PackMac(bss.bssid));
+			if (it == m_table.end())
+			{
+				bss.firstSeenNs = bss.lastSeenNs;
+				m_table[PackMac(bss.bssid)] = bss;
+				BssDelta d;
+				d.change = BssChange::Added;
+				d.bss = bss;
+				deltas.push_back(d);
+				continue;
+			}
+			BssEntry& known = it->second;
+			// (An old cache entry the kernel still reports: nothing new.)
+			if (bss.lastSeenNs <= known.lastSeenNs)
+			{
+				continue;
+			}
+			int32_t signalChange = bss.signalMbm - known.signalMbm;
+			bool changed = bss.ssid != known.ssid || bss.freq != known.freq
+				|| bss.capability != known.capability
+				|| signalChange >= ChangeSignalMbm || signalChange <= -ChangeSignalMbm;
+			bss.firstSeenNs = known.firstSeenNs;
+			known = bss;
+			if (changed)
+			{
+				BssDelta d;
+				d.change = BssChange::Updated;
+				d.bss = bss;
+				deltas.push_back(d);
+			}
+		}
+		AgeOut(NowNs(), deltas);
+	}
+	Notify(deltas);
+}
+
+int ScanEngine::scan_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	vector<BssEntry> *dump = (vector<BssEntry> *)info->data;
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
+	struct nlattr *tb_bss[NL80211_BSS_MAX + 1];
+
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	if (dump == nullptr || !tb_msg[NL80211_ATTR_BSS])
+	{
+		return NL_SKIP;
+	}
+	if (nla_parse_nested(tb_bss, NL80211_BSS_MAX, tb_msg[NL80211_ATTR_BSS], NULL) != 0
+		|| !tb_bss[NL80211_BSS_BSSID] || nla_len(tb_bss[NL80211_BSS_BSSID]) < 6)
+	{
+		return NL_SKIP;
+	}
+	BssEntry bss;
+	memcpy(bss.bssid, nla_data(tb_bss[NL80211_BSS_BSSID]), 6);
+	if (tb_bss[NL80211_BSS_FREQUENCY])
+	{
+		bss.freq = nla_get_u32(tb_bss[NL80211_BSS_FREQUENCY]);
+	}
+	if (tb_bss[NL80211_BSS_SIGNAL_MBM])
+	{
+		bss.signalMbm = (int32_t)nla_get_u32(tb_bss[NL80211_BSS_SIGNAL_MBM]);
+	}
+	if (tb_bss[NL80211_BSS_BEACON_INTERVAL])
+	{
+		bss.beaconInterval = nla_get_u16(tb_bss[NL80211_BSS_BEACON_INTERVAL]);
+	}
+	if (tb_bss[NL80211_BSS_CAPABILITY])
+	{
+		bss.capability = nla_get_u16(tb_bss[NL80211_BSS_CAPABILITY]);
+	}
+	if (tb_bss[NL80211_BSS_TSF])
+	{
+		bss.tsf = nla_get_u64(tb_bss[NL80211_BSS_TSF]);
+	}
+	bss.associated = tb_bss[NL80211_BSS_STATUS]
+		&& nla_get_u32(tb_bss[NL80211_BSS_STATUS]) == NL80211_BSS_STATUS_ASSOCIATED;
+	// When the kernel last heard it:
+	bss.lastSeenNs = NowNs();
+	if (tb_bss[NL80211_BSS_SEEN_MS_AGO])
+	{
+		bss.lastSeenNs -= (int64_t)nla_get_u32(tb_bss[NL80211_BSS_SEEN_MS_AGO]) * 1000000LL;
+	}
+	// Probe response IEs if we have them, else the beacon's:
+	struct nlattr *ies = tb_bss[NL80211_BSS_INFORMATION_ELEMENTS] ?
+		tb_bss[NL80211_BSS_INFORMATION_ELEMENTS] : tb_bss[NL80211_BSS_BEACON_IES];
+	if (ies != nullptr)
+	{
+		const uint8_t *p = (const uint8_t *)nla_data(ies);
+		int len = nla_len(ies);
+		bss.ies.assign(p, p + len);
+		// (Stops at the SSID, usually the first element.)
+		IeParser parser;
+		IeTagSet wanted;
+		wanted.Add(IeSsid);
+		IeView ssid;
+		parser.Parse(p, len, wanted);
+		if (parser.Ssid(ssid))
+		{
+			bss.ssid.assign((const char *)ssid.data, ssid.length);
+		}
+	}
+	dump->push_back(bss);
+	return NL_SKIP;
+}
+
+int64_t ScanEngine::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
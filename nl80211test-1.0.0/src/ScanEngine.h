@@ -0,0 +1,138 @@
+// ScanEngine.h
+// Asynchronous scanning on a managed (STA) interface: Trigger() sends
+// NL80211_CMD_TRIGGER_SCAN (optional frequency and SSID lists) and returns
+// once the kernel accepted it. Completion comes in on the "scan" multicast
+// group (NEW_SCAN_RESULTS / SCAN_ABORTED, Nl80211EventListener), no
+// polling. Results (GET_SCAN dump) are merged into a BSS table: new BSSs
+// are added, ones seen again refreshed, ones not seen for MaxAge aged out.
+// The change handler only gets what changed (added / updated / removed).
+// Anybody's scan on the interface (e.g., wpa_supplicant's) refreshes the
+// table too, but doesn't complete ours.
+
+#ifndef SCANENGINE_H_
+#define SCANENGINE_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstring>
+
+#include <stdint.h>
+#include <time.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+#include "Nl80211EventListener.h"
+#include "IeParser.h"
+#include "MacAddress.h"
+
+using namespace std;
+using namespace chrono;
+
+class BssEntry
+{
+public:
+	uint8_t bssid[6] = { 0, 0, 0, 0, 0, 0 };
+	string ssid;              // (empty: hidden, or no SSID element)
+	uint32_t freq = 0;
+	int32_t signalMbm = 0;    // dBm * 100 (0: driver doesn't report it)
+	uint16_t beaconInterval = 0;
+	uint16_t capability = 0;
+	uint64_t tsf = 0;
+	bool associated = false;  // NL80211_BSS_STATUS: we're associated with it
+	int64_t firstSeenNs = 0;  // CLOCK_MONOTONIC
+	int64_t lastSeenNs = 0;
+	vector<uint8_t> ies;      // Information elements (probe response / beacon)
+	string BssidString() const;
+};
+
+enum class BssChange
+{
+	Added = 1,
+	Updated,  // SSID, frequency, capability or signal (ChangeSignalMbm) changed
+	Removed   // Aged out
+};
+
+class BssDelta
+{
+public:
+	BssChange change = BssChange::Added;
+	BssEntry bss;
+};
+
+enum class ScanState
+{
+	Idle = 1,
+	Running,
+	Done,
+	Aborted,
+	Failed
+};
+
+class ScanRequest
+{
+public:
+	vector<uint32_t> freqs;  // MHz (empty: every channel)
+	vector<string> ssids;    // Probe for these ("": wildcard; empty list: passive)
+};
+
+// Runs on the event listener thread, outside the table lock:
+typedef function<void(const vector<BssDelta>& deltas)> BssChangeHandler;
+
+class ScanEngine : public Nl80211Base
+{
+public:
+	ScanEngine();
+	~ScanEngine();
+	// 'interfaceName': a managed interface (monitor interfaces can't scan).
+	bool OpenConnection(const char *interfaceName);
+	bool CloseConnection();
+	// Before OpenConnection():
+	void SetChangeHandler(BssChangeHandler handler);
+	void SetMaxAge(milliseconds maxAge);
+	// False if the kernel refused (EBUSY: a scan is already running).
+	bool Trigger(const ScanRequest& request);
+	// Until our scan is done / aborted, or 'timeout'. True if done.
+	bool Wait(milliseconds timeout);
+	ScanState GetState();
+	void GetTable(vector<BssEntry>& table);
+	// Strongest BSS with 'ssid' (the uplink for the STA), false if none:
+	bool GetBest(const string& ssid, BssEntry& best);
+	// Drop what hasn't been seen for MaxAge (also done after every scan):
+	void AgeOut();
+	static int scan_handler(struct nl_msg *msg, void *arg);
+	// A signal change smaller than this is just a refresh:
+	static const int32_t ChangeSignalMbm = 300;
+private:
+	void OnScanEvent(uint8_t cmd, struct nlattr **tb);
+	bool DumpResults();
+	void MergeResults();
+	// (m_mutex held.)
+	void AgeOut(int64_t nowNs, vector<BssDelta>& deltas);
+	void Notify(const vector<BssDelta>& deltas);
+	static int64_t NowNs();
+	Nl80211EventListener m_listener;
+	vector<int> m_handlerIds;
+	bool m_isOpen = false;
+	uint32_t m_interfaceIndex = 0;
+	// The nl80211 connection: Trigger() (caller's thread) and the
+	// GET_SCAN dumps (listener thread).
+	mutex m_connMutex;
+	vector<BssEntry> m_dump;  // (m_connMutex)
+	mutex m_mutex;
+	condition_variable m_stateChanged;
+	ScanState m_state = ScanState::Idle;
+	// Running, and the kernel's TRIGGER_SCAN event for it came in:
+	bool m_scanStarted = false;
+	unordered_map<uint64_t, BssEntry> m_table;  // Key: PackMac(bssid)
+	BssChangeHandler m_handler;
+	milliseconds m_maxAge;
+};
+
+#endif  // SCANENGINE_H_
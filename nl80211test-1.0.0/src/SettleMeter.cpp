@@ -0,0 +1,283 @@
+// SettleMeter.cpp
+// Channel settle time: read-back polling and first captured frame.
+
+#include "SettleMeter.h"
+
+mutex SettleMeter::s_driversMutex;
+map<string, SettleReport> SettleMeter::s_drivers;
+
+void SettleDistribution::Add(int64_t us)
+{
+	if (m_samples.size() < SampleLimit)
+	{
+		m_samples.push_back(us);
+	}
+	else
+	{
+		m_samples[m_count % SampleLimit] = us;
+	}
+	m_count++;
+}
+
+int64_t SettleDistribution::Percentile(double p) const
+{
+	if (m_samples.empty())
+	{
+		return 0;
+	}
+	vector<int64_t> sorted(m_samples);
+	size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+	if (rank >= sorted.size())
+	{
+		rank = sorted.size() - 1;
+	}
+	nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+int64_t SettleDistribution::Max() const
+{
+	return m_samples.empty() ? 0 : *max_element(m_samples.begin(), m_samples.end());
+}
+
+string SettleReport::Summary() const
+{
+	stringstream s;
+	s << driver << ": read-back (us) n=" << readBack.Count() << " p50/p90/p99/max: "
+		<< readBack.Percentile(50) << "/" << readBack.Percentile(90) << "/"
+		<< readBack.Percentile(99) << "/" << readBack.Max() << ", timeouts: " << timeouts
+		<< "; first frame (us) n=" << firstFrame.Count() << " p50/p90/p99/max: "
+		<< firstFrame.Percentile(50) << "/" << firstFrame.Percentile(90) << "/"
+		<< firstFrame.Percentile(99) << "/" << firstFrame.Max();
+	return s.str();
+}
+
+SettleMeter::SettleMeter() : Log("SettleMeter")
+{
+	m_frameTimeline = &m_timeline;
+	m_lastFrameHop = 0;
+}
+
+SettleMeter::~SettleMeter()
+{
+	Close();
+}
+
+bool SettleMeter::Open(const char *interfaceName)
+{
+	if (m_isOpen)
+	{
+		return true;
+	}
+	if (!m_setter.OpenConnection(interfaceName))
+	{
+		LogErr(AT, string("Open(): can't open ") + interfaceName);
+		return false;
+	}
+	// Hops must not wait for the kernel: that's what we're measuring.
+	m_setter.SetAckMode(AckMode::NoAck);
+	m_driver = DriverName(interfaceName);
+	m_isOpen = true;
+	return true;
+}
+
+bool SettleMeter::Close()
+{
+	if (!m_isOpen)
+	{
+		return true;
+	}
+	m_setter.CloseConnection();
+	m_isOpen = false;
+	return true;
+}
+
+int64_t SettleMeter::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// /sys/class/net/<interface>/device/driver -> .../drivers/<name>
+string SettleMeter::DriverName(const char *interfaceName)
+{
+	string path("/sys/class/net/");
+	path += interfaceName;
+	path += "/device/driver";
+	char target[PATH_MAX];
+	ssize_t len = readlink(path.c_str(), target, sizeof(target) - 1);
+	if (len <= 0)
+	{
+		return "unknown";
+	}
+	target[len] = '\0';
+	string driver(target);
+	size_t slash = driver.rfind('/');
+	return (slash == string::npos) ? driver : driver.substr(slash + 1);
+}
+
+// (s_driversMutex held.)
+SettleReport& SettleMeter::DriverReport(const string& driver)
+{
+	SettleReport& report = s_drivers[driver];
+	report.driver = driver;
+	return report;
+}
+
+bool SettleMeter::MeasureReadBack(const HopPlan& plan, uint32_t rounds,
+	microseconds pollInterval, microseconds timeout)
+{
+	HopPlan checked(plan);
+	string why;
+	if (!checked.Validate(why))
+	{
+		LogErr(AT, "MeasureReadBack(): hop plan rejected, " + why);
+		return false;
+	}
+	if (!m_isOpen)
+	{
+		LogErr(AT, "MeasureReadBack(): not open.");
+		return false;
+	}
+	int64_t timeoutNs = (int64_t)duration_cast<nanoseconds>(timeout).count();
+	for (uint32_t round = 0; round < rounds; round++)
+	{
+		for (const HopEntry& entry : checked.entries)
+		{
+			uint32_t seq;
+			m_hopNumber++;
+			int64_t sentNs = NowNs();
+			m_timeline.Record(TimelineEventType::HopRequested, sentNs, m_hopNumber,
+				entry.channel, entry.freq, entry.width, entry.centerFreq1);
+			if (!m_setter.SetChannel(entry, seq))
+			{
+				m_timeline.Record(TimelineEventType::HopFailed, NowNs(), m_hopNumber, entry.channel);
+				stringstream s;
+				s << "MeasureReadBack(): SetChannel(" << entry.channel << ") failed.";
+				LogErr(AT, s);
+				return false;
+			}
+			bool settled = false;
+			int64_t nowNs = sentNs;
+			while (!settled && nowNs - sentNs < timeoutNs)
+			{
+				ChannelInfo info;
+				bool read = m_setter.ReadBackChannel(info);
+				nowNs = NowNs();
+				settled = read && info.valid && info.freq == entry.freq;
+				if (!settled)
+				{
+					this_thread::sleep_for(pollInterval);
+				}
+			}
+			{
+				lock_guard<mutex> lock(s_driversMutex);
+				SettleReport& report = DriverReport(m_driver);
+				if (settled)
+				{
+					report.readBack.Add((nowNs - sentNs) / 1000);
+				}
+				else
+				{
+					report.timeouts++;
+				}
+			}
+			m_timeline.Record(TimelineEventType::DwellStart, nowNs, m_hopNumber,
+				entry.channel, entry.freq, entry.width, entry.centerFreq1);
+			// Listen (capture may be calling OnFrame()):
+			this_thread::sleep_for(entry.dwell);
+			m_timeline.Record(TimelineEventType::DwellEnd, NowNs(), m_hopNumber,
+				entry.channel, entry.freq, entry.width, entry.centerFreq1);
+		}
+	}
+	return true;
+}
+
+void SettleMeter::SetTimeline(const ChannelTimeline *timeline)
+{
+	m_frameTimeline = (timeline != nullptr) ? timeline : &m_timeline;
+	m_lastFrameHop = 0;
+}
+
+// First frame on the frequency a hop asked for, whether or not the hop
+// "finished" (read-back / DwellStart) yet: the radio is evidently there.
+void SettleMeter::OnFrame(int64_t rxNs, uint32_t freq)
+{
+	ChannelAtTime tuned;
+	if (!m_frameTimeline.load()->Lookup(rxNs, tuned) || tuned.requestedNs == 0
+		|| tuned.hop.freq != freq)
+	{
+		return;
+	}
+	uint64_t last = m_lastFrameHop;
+	while (tuned.hop.hopNumber > last)
+	{
+		if (m_lastFrameHop.compare_exchange_weak(last, tuned.hop.hopNumber))
+		{
+			lock_guard<mutex> lock(s_driversMutex);
+			DriverReport(m_driver).firstFrame.Add((rxNs - tuned.requestedNs) / 1000);
+			return;
+		}
+	}
+}
+
+bool SettleMeter::GetDriverReport(const string& driver, SettleReport& report)
+{
+	lock_guard<mutex> lock(s_driversMutex);
+	auto it = s_drivers.find(driver);
+	if (it == s_drivers.end())
+	{
+		return false;
+	}
+	report = it->second;
+	return true;
+}
+
+void SettleMeter::GetDriverReports(vector<SettleReport>& reports)
+{
+	reports.clear();
+	lock_guard<mutex> lock(s_driversMutex);
+	for (auto& d : s_drivers)
+	{
+		reports.push_back(d.second);
+	}
+}
+
+milliseconds SettleMeter::MinDwell(const string& driver, double listenShare, milliseconds fallback)
+{
+	SettleReport report;
+	if (!GetDriverReport(driver, report) || listenShare <= 0.0 || listenShare >= 1.0)
+	{
+		return fallback;
+	}
+	int64_t settleUs;
+	if (report.firstFrame.Count() >= MinFrameSamples)
+	{
+		settleUs = report.firstFrame.Percentile(99);
+	}
+	else if (report.readBack.Count() > 0)
+	{
+		settleUs = report.readBack.Percentile(99);
+	}
+	else
+	{
+		return fallback;
+	}
+	// settle <= (1 - listenShare) * dwell, rounded up to whole ms:
+	int64_t dwellUs = (int64_t)(settleUs / (1.0 - listenShare));
+	return milliseconds(max((int64_t)1, (dwellUs + 999) / 1000));
+}
+
+void SettleMeter::ApplyMinDwell(const string& driver, ActivityPolicyConfig& config)
+{
+	milliseconds minDwell = MinDwell(driver, 0.8, config.minDwell);
+	if (minDwell > config.minDwell)
+	{
+		config.minDwell = minDwell;
+	}
+	if (config.maxDwell < config.minDwell)
+	{
+		config.maxDwell = config.minDwell;
+	}
+}
@@ -0,0 +1,123 @@
+// SettleMeter.h
+// How long after a channel change is the radio really listening on the
+// new channel? SetChannel() returning (NoAck: the message was sent) says
+// nothing about that. Two measurements, both from when the hop was sent:
+//   Read-back:   poll GET_INTERFACE until the radio reports the new
+//                frequency (resolution: one netlink round trip + poll
+//                interval; mac80211 updates this when the driver call
+//                returns, so it's the driver's retune time).
+//   First frame: a capture thread calls OnFrame() for every frame with
+//                its receive time (CLOCK_MONOTONIC) and channel; the first
+//                frame on a hop's frequency ends that hop's settle time.
+//                Upper bound (depends on traffic), but end to end.
+// (nl80211 has no event for a monitor interface's channel change,
+// CH_SWITCH_NOTIFY is only for CSA in AP / station / mesh modes, so the
+// read-back is polled.)
+// Samples are kept per driver (all meters on that driver share them);
+// MinDwell() / ApplyMinDwell() turn a driver's settle time into the
+// shortest dwell worth scheduling.
+
+#ifndef SETTLEMETER_H_
+#define SETTLEMETER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+
+#include "Log.h"
+#include "HopPlan.h"
+#include "ChannelTimeline.h"
+#include "ChannelSetterNl80211.h"
+#include "DwellPolicies.h"
+
+using namespace std;
+using namespace chrono;
+
+// The last SampleLimit samples (microseconds):
+class SettleDistribution
+{
+public:
+	void Add(int64_t us);
+	uint64_t Count() const { return m_count; }
+	// p: 0..100; 0 if no samples.
+	int64_t Percentile(double p) const;
+	int64_t Max() const;
+	static const size_t SampleLimit = 1024;
+private:
+	vector<int64_t> m_samples;
+	uint64_t m_count = 0;
+};
+
+class SettleReport
+{
+public:
+	string driver;
+	SettleDistribution readBack;
+	SettleDistribution firstFrame;
+	// Read-back never showed the new frequency within the timeout:
+	uint64_t timeouts = 0;
+	string Summary() const;
+};
+
+class SettleMeter : protected Log
+{
+public:
+	SettleMeter();
+	~SettleMeter();
+	bool Open(const char *interfaceName);
+	bool Close();
+	const string& GetDriver() { return m_driver; }
+	// Read-back mode: 'rounds' passes over the plan, NoAck hops, each
+	// followed by read-back polling and then the entry's dwell (frames
+	// to OnFrame() during it count too). Blocks for the whole run.
+	bool MeasureReadBack(const HopPlan& plan, uint32_t rounds,
+		microseconds pollInterval = microseconds(200),
+		microseconds timeout = microseconds(100000));
+	// First-frame mode, any (capture) thread, no locks except once per
+	// hop. 'timeline' is where the hops are recorded: a running
+	// ChannelHopper's GetTimeline(), or nullptr for this meter's own
+	// (MeasureReadBack()). Set before frames arrive.
+	void SetTimeline(const ChannelTimeline *timeline);
+	void OnFrame(int64_t rxNs, uint32_t freq);
+	// Per-driver results:
+	static bool GetDriverReport(const string& driver, SettleReport& report);
+	static void GetDriverReports(vector<SettleReport>& reports);
+	// Shortest dwell that still leaves 'listenShare' of it for listening
+	// after the driver's p99 settle time (first frame if there are enough
+	// samples, else read-back); 'fallback' if nothing was measured.
+	static milliseconds MinDwell(const string& driver, double listenShare = 0.8,
+		milliseconds fallback = milliseconds(50));
+	// Raise config.minDwell to MinDwell(driver) (never lowers it).
+	static void ApplyMinDwell(const string& driver, ActivityPolicyConfig& config);
+	// Kernel driver behind a network interface (sysfs), "unknown" if none:
+	static string DriverName(const char *interfaceName);
+private:
+	static int64_t NowNs();
+	static SettleReport& DriverReport(const string& driver);
+	ChannelSetterNl80211 m_setter;
+	bool m_isOpen = false;
+	string m_driver;
+	ChannelTimeline m_timeline;  // (MeasureReadBack()'s hops)
+	uint64_t m_hopNumber = 0;
+	atomic<const ChannelTimeline *> m_frameTimeline;
+	// Newest hop that already has its first frame:
+	atomic<uint64_t> m_lastFrameHop;
+	// Below this many first-frame samples MinDwell() uses read-back:
+	static const uint64_t MinFrameSamples = 20;
+	static mutex s_driversMutex;
+	static map<string, SettleReport> s_drivers;
+};
+
+#endif  // SETTLEMETER_H_
@@ -0,0 +1,169 @@
+// SimChannelSetter.cpp
+// Virtual-clock channel setter, see SimChannelSetter.h.
+
+#include "SimChannelSetter.h"
+
+// (Unnamed Log: no banner on stdout, hopbench prints CSV / JSON there.)
+SimChannelSetter::SimChannelSetter() : m_random(m_model.seed)
+{
+}
+
+SimChannelSetter::SimChannelSetter(const SimSetterModel& model) :
+	m_model(model), m_random(model.seed)
+{
+}
+
+bool SimChannelSetter::OpenConnection()
+{
+	m_isOpen = true;
+	return true;
+}
+
+bool SimChannelSetter::CloseConnection()
+{
+	m_isOpen = false;
+	m_pending.clear();
+	return true;
+}
+
+void SimChannelSetter::SetAckMode(AckMode mode)
+{
+	m_ackMode = mode;
+}
+
+AckMode SimChannelSetter::GetAckMode()
+{
+	return m_ackMode;
+}
+
+bool SimChannelSetter::LoadHopPlan(const HopPlan& plan)
+{
+	HopPlan checked(plan);
+	string why;
+	if (!checked.Validate(why))
+	{
+		LogErr(AT, "LoadHopPlan(): hop plan rejected, " + why);
+		return false;
+	}
+	m_plan = checked;
+	return true;
+}
+
+bool SimChannelSetter::HopTo(size_t entryIndex, uint32_t& seq)
+{
+	if (entryIndex >= m_plan.Size())
+	{
+		LogErr(AT, "HopTo(): no such hop plan entry.");
+		return false;
+	}
+	const HopEntry& e = m_plan.entries[entryIndex];
+	return Hop(e.freq, e.width, seq);
+}
+
+bool SimChannelSetter::SetChannel(const HopEntry& entry, uint32_t& seq)
+{
+	if (entry.freq == 0)
+	{
+		LogErr(AT, "SetChannel(): entry not validated.");
+		return false;
+	}
+	return Hop(entry.freq, entry.width, seq);
+}
+
+bool SimChannelSetter::SetChannel(const HopEntry& entry)
+{
+	uint32_t seq;
+	return SetChannel(entry, seq);
+}
+
+bool SimChannelSetter::SetChannel(uint32_t channel)
+{
+	uint32_t freq;
+	if (!ChannelTables::ChannelToFrequency(ChannelTables::LegacyBand(channel), channel, freq))
+	{
+		LogErr(AT, "SetChannel(): not a valid channel.");
+		return false;
+	}
+	uint32_t seq;
+	return Hop(freq, ChannelWidth::NoHT20, seq);
+}
+
+bool SimChannelSetter::GetFrequency(uint32_t& freq)
+{
+	if (m_freq == 0)
+	{
+		return false;
+	}
+	// (A read-back is queued behind the channel changes.)
+	m_nowNs = max(m_nowNs, m_busyUntilNs) + m_model.ackReadCostNs;
+	freq = m_freq;
+	return true;
+}
+
+bool SimChannelSetter::Hop(uint32_t freq, ChannelWidth width, uint32_t& seq)
+{
+	if (!m_isOpen)
+	{
+		LogErr(AT, "Hop(): not open.");
+		return false;
+	}
+	m_nowNs += m_model.sendCostNs;
+	seq = ++m_seq;
+	double serviceNs = (double)m_model.serviceNs[(size_t)width % 6];
+	PendingHop hop;
+	hop.seq = seq;
+	hop.freq = freq;
+	hop.doneNs = max(m_nowNs, m_busyUntilNs)
+		+ (int64_t)(serviceNs + m_random.Exponential(m_model.jitterShare * serviceNs));
+	hop.error = (m_random.Uniform() < m_model.failRate) ? EBUSY : 0;
+	m_busyUntilNs = hop.doneNs;
+	if (hop.error == 0)
+	{
+		m_freq = freq;
+	}
+	switch (m_ackMode)
+	{
+		case AckMode::WaitForAck:
+			m_nowNs = hop.doneNs + m_model.ackReadCostNs;
+			return hop.error == 0;
+		case AckMode::Pipelined:
+			m_pending.push_back(hop);
+			return true;
+		default:
+			return true;
+	}
+}
+
+size_t SimChannelSetter::ReadHopAcks(nl80211Ack *acks, size_t maxAcks)
+{
+	if (m_pending.empty() || m_pending.front().doneNs > m_nowNs)
+	{
+		return 0;
+	}
+	m_nowNs += m_model.ackReadCostNs;
+	size_t count = 0;
+	while (count < maxAcks && !m_pending.empty() && m_pending.front().doneNs <= m_nowNs)
+	{
+		acks[count].seq = m_pending.front().seq;
+		acks[count].error = m_pending.front().error;
+		m_pending.pop_front();
+		count++;
+	}
+	return count;
+}
+
+bool SimChannelSetter::WaitForAck(int64_t timeoutNs)
+{
+	if (m_pending.empty())
+	{
+		return false;
+	}
+	int64_t dueNs = m_pending.front().doneNs;
+	if (dueNs > m_nowNs + timeoutNs)
+	{
+		m_nowNs += timeoutNs;
+		return false;
+	}
+	m_nowNs = max(m_nowNs, dueNs);
+	return true;
+}
@@ -0,0 +1,95 @@
+// SimChannelSetter.h
+// Simulated nl80211 channel setter, no radio / no kernel: for hopbench
+// in CI and anything else that wants repeatable hop timing.
+// Same hop API as ChannelSetterNl80211 (AckMode, LoadHopPlan(), HopTo(),
+// ReadHopAcks()) but on its own VIRTUAL clock: every call advances it by
+// a modelled cost, nothing sleeps, so thousands of hops take no time and
+// the same seed gives the same numbers.
+// Model: the kernel / driver handles one channel change at a time (a
+// queue): a hop starts when the previous one is done, takes the width's
+// service time plus exponential jitter, and fails with 'failRate'.
+//   NoAck:       HopTo() costs the send only, failures are never seen.
+//   WaitForAck:  HopTo() returns when that hop is done (its error).
+//   Pipelined:   ReadHopAcks() returns the hops done by now;
+//                WaitForAck() moves the clock to the next one.
+
+#ifndef SIMCHANNELSETTER_H_
+#define SIMCHANNELSETTER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <deque>
+
+#include <stdint.h>
+#include <errno.h>
+
+#include "Log.h"
+#include "HopPlan.h"
+#include "ChannelSetterNl80211.h"
+#include "SimRandom.h"
+#include "IChannelSetter.h"
+
+using namespace std;
+
+class SimSetterModel
+{
+public:
+	int64_t sendCostNs = 8000;      // sendto() of one message
+	int64_t ackReadCostNs = 2000;   // one recv() of ACKs
+	// Driver time per channel change, by ChannelWidth (NoHT20 .. VHT80P80):
+	int64_t serviceNs[6] = { 250000, 250000, 350000, 500000, 800000, 900000 };
+	// Exponential jitter, mean = jitterShare * service time:
+	double jitterShare = 0.2;
+	double failRate = 0.001;        // Hops the "kernel" rejects (EBUSY)
+	uint64_t seed = 1;
+};
+
+class SimChannelSetter : public IChannelSetter, protected Log
+{
+public:
+	SimChannelSetter();
+	SimChannelSetter(const SimSetterModel& model);
+	const char *Name() { return "sim"; }
+	bool OpenConnection();
+	bool OpenConnection(const char *) { return OpenConnection(); }
+	bool CloseConnection();
+	void SetAckMode(AckMode mode);
+	AckMode GetAckMode();
+	bool LoadHopPlan(const HopPlan& plan);
+	bool HopTo(size_t entryIndex, uint32_t& seq);
+	bool SetChannel(const HopEntry& entry, uint32_t& seq);
+	bool SetChannel(const HopEntry& entry);
+	bool SetChannel(uint32_t channel);
+	size_t ReadHopAcks(nl80211Ack *acks, size_t maxAcks);
+	// Pipelined: advance the clock to the next ACK (at most timeoutNs);
+	// false if none is outstanding or it isn't due in time.
+	bool WaitForAck(int64_t timeoutNs);
+	// Virtual CLOCK_MONOTONIC, ns:
+	int64_t NowNs() { return m_nowNs; }
+	// Last frequency a hop actually reached (once its ACK would be due):
+	bool GetFrequency(uint32_t& freq);
+private:
+	bool Hop(uint32_t freq, ChannelWidth width, uint32_t& seq);
+	class PendingHop
+	{
+	public:
+		uint32_t seq;
+		uint32_t freq;
+		int64_t doneNs;
+		int error;
+	};
+	SimSetterModel m_model;
+	SimRandom m_random;
+	bool m_isOpen = false;
+	AckMode m_ackMode = AckMode::NoAck;
+	HopPlan m_plan;
+	int64_t m_nowNs = 0;
+	int64_t m_busyUntilNs = 0;  // Driver's queue
+	uint32_t m_seq = 0;
+	uint32_t m_freq = 0;
+	deque<PendingHop> m_pending;  // (in completion order, it's a queue)
+};
+
+#endif  // SIMCHANNELSETTER_H_
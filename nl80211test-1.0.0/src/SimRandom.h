@@ -0,0 +1,60 @@
+// SimRandom.h
+// xorshift64*: the same numbers on every platform / library, for the
+// offline simulators (dwellsim, SimChannelSetter).
+
+#ifndef SIMRANDOM_H_
+#define SIMRANDOM_H_
+
+#include <cmath>
+
+#include <stdint.h>
+
+using namespace std;
+
+class SimRandom
+{
+public:
+	SimRandom(uint64_t seed) : m_state(seed ? seed : 0x9e3779b97f4a7c15ULL) { }
+	double Uniform()
+	{
+		m_state ^= m_state >> 12;
+		m_state ^= m_state << 25;
+		m_state ^= m_state >> 27;
+		return ((m_state * 0x2545f4914f6cdd1dULL) >> 11) * (1.0 / 9007199254740992.0);
+	}
+	// Poisson(mean): Knuth for small means, rounded normal above that.
+	uint64_t Poisson(double mean)
+	{
+		if (mean <= 0.0)
+		{
+			return 0;
+		}
+		if (mean < 30.0)
+		{
+			double limit = exp(-mean);
+			double p = Uniform();
+			uint64_t k = 0;
+			while (p > limit)
+			{
+				p *= Uniform();
+				k++;
+			}
+			return k;
+		}
+		double u1 = Uniform();
+		double u2 = Uniform();
+		double z = sqrt(-2.0 * log(u1 > 0.0 ? u1 : 1e-12)) * cos(2.0 * M_PI * u2);
+		double v = mean + z * sqrt(mean);
+		return v > 0.0 ? (uint64_t)(v + 0.5) : 0;
+	}
+	// Exponential(mean):
+	double Exponential(double mean)
+	{
+		double u = Uniform();
+		return -mean * log(u > 0.0 ? u : 1e-12);
+	}
+private:
+	uint64_t m_state;
+};
+
+#endif  // SIMRANDOM_H_
@@ -0,0 +1,419 @@
+// StationPoller.cpp
+// NL80211_CMD_GET_STATION dump per poll, per-station deltas in
+// preallocated slots, see StationPoller.h.
+
+#include "StationPoller.h"
+
+StationPoller::StationPoller() : Nl80211Base("StationPoller")
+{
+	memset(m_index, 0, sizeof(m_index));
+}
+
+StationPoller::~StationPoller()
+{
+	CloseConnection();
+}
+
+bool StationPoller::OpenConnection(const char *interfaceName)
+{
+	CloseConnection();
+	if (!Open())
+	{
+		LogErr(AT, "Can't connect to NL80211.");
+		return false;
+	}
+	if (!GetInterfaceIndex(interfaceName, m_interfaceIndex))
+	{
+		Close();
+		return false;
+	}
+	m_isOpen = true;
+	return true;
+}
+
+bool StationPoller::CloseConnection()
+{
+	if (m_isOpen)
+	{
+		Close();
+		m_isOpen = false;
+	}
+	return true;
+}
+
+int64_t StationPoller::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+bool StationPoller::Poll(int64_t timeNs)
+{
+	if (!m_isOpen)
+	{
+		LogErr(AT, "Poll(): not open.");
+		return false;
+	}
+	// (Held for the whole dump: station_handler() writes the slots
+	// directly. A reader waits at most one netlink round trip.)
+	lock_guard<mutex> lock(m_mutex);
+	m_polls++;
+	m_generation++;
+	m_pollNs = timeNs ? timeNs : NowNs();
+	FreeMessage();
+	if (!SetupCallback(station_handler))
+	{
+		m_failedPolls++;
+		return false;
+	}
+	SetCallbackData(this);
+	if (!SetupMessage(NLM_F_DUMP, NL80211_CMD_GET_STATION)
+		|| !AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex))
+	{
+		FreeMessage();
+		SetCallbackData(nullptr);
+		LogErr(AT, "Poll(): can't build message.");
+		m_failedPolls++;
+		return false;
+	}
+	bool ok = SendWithRepeatingResponses();
+	FreeMessage();
+	SetCallbackData(nullptr);
+	if (!ok)
+	{
+		// (Partial dump: don't take the missing stations for gone.)
+		m_failedPolls++;
+		return false;
+	}
+	size_t before = m_count;
+	for (Slot& slot : m_slots)
+	{
+		if (slot.inUse && slot.generation != m_generation)
+		{
+			slot.inUse = false;
+			m_count--;
+			m_departures++;
+		}
+	}
+	if (m_count != before)
+	{
+		// (Linear probing can't just clear an entry; with at most
+		// MaxStations slots a rebuild is cheaper than tombstones.)
+		RebuildIndex();
+	}
+	return true;
+}
+
+// Multiplicative hash of the packed MAC, top bits (the vendor OUI alone
+// would put every phone of one make into the same bucket).
+size_t StationPoller::IndexOf(uint64_t key) const
+{
+	return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 32) % IndexSize;
+}
+
+StationPoller::Slot *StationPoller::FindSlot(uint64_t key)
+{
+	for (size_t i = IndexOf(key), n = 0; n < IndexSize; i = (i + 1) % IndexSize, n++)
+	{
+		if (m_index[i] == 0)
+		{
+			return nullptr;
+		}
+		Slot *slot = &m_slots[m_index[i] - 1];
+		if (slot->stats.key == key)
+		{
+			return slot;
+		}
+	}
+	return nullptr;
+}
+
+StationPoller::Slot *StationPoller::AddSlot(uint64_t key)
+{
+	if (m_count >= MaxStations)
+	{
+		return nullptr;
+	}
+	size_t s = 0;
+	while (m_slots[s].inUse)
+	{
+		s++;
+	}
+	size_t i = IndexOf(key);
+	while (m_index[i] != 0)
+	{
+		i = (i + 1) % IndexSize;
+	}
+	m_index[i] = (uint16_t)(s + 1);
+	m_count++;
+	Slot *slot = &m_slots[s];
+	*slot = Slot();
+	slot->inUse = true;
+	slot->stats.key = key;
+	UnpackMac(key, slot->stats.mac);
+	return slot;
+}
+
+void StationPoller::RebuildIndex()
+{
+	memset(m_index, 0, sizeof(m_index));
+	for (size_t s = 0; s < MaxStations; s++)
+	{
+		if (!m_slots[s].inUse)
+		{
+			continue;
+		}
+		size_t i = IndexOf(m_slots[s].stats.key);
+		while (m_index[i] != 0)
+		{
+			i = (i + 1) % IndexSize;
+		}
+		m_index[i] = (uint16_t)(s + 1);
+	}
+}
+
+// Counters that went backwards (or 'restarted': station reassociated
+// between two polls) start from 0 again: all of 'now' is new.
+uint64_t StationPoller::Delta64(uint64_t now, uint64_t last, bool restarted)
+{
+	return (now >= last && !restarted) ? now - last : now;
+}
+
+uint32_t StationPoller::Delta32(uint32_t now, uint32_t last, bool restarted)
+{
+	return (now >= last && !restarted) ? now - last : now;
+}
+
+// NL80211_STA_INFO_TX_BITRATE / RX_BITRATE (nested), in kbit/s.
+uint32_t StationPoller::BitrateKbps(struct nlattr *rate)
+{
+	struct nlattr *tb_rate[NL80211_RATE_INFO_MAX + 1];
+	if (rate == nullptr || nla_parse_nested(tb_rate, NL80211_RATE_INFO_MAX, rate, NULL) != 0)
+	{
+		return 0;
+	}
+	// (BITRATE is u16 and saturates above 6.5 Gbit/s, prefer BITRATE32.)
+	if (tb_rate[NL80211_RATE_INFO_BITRATE32])
+	{
+		return nla_get_u32(tb_rate[NL80211_RATE_INFO_BITRATE32]) * 100;
+	}
+	if (tb_rate[NL80211_RATE_INFO_BITRATE])
+	{
+		return (uint32_t)nla_get_u16(tb_rate[NL80211_RATE_INFO_BITRATE]) * 100;
+	}
+	return 0;
+}
+
+// One station of the dump into its slot (m_mutex held by Poll()).
+void StationPoller::Update(struct nlattr **tb_sta, const uint8_t *mac)
+{
+	uint64_t key = PackMac(mac);
+	Slot *slot = FindSlot(key);
+	bool isNew = false;
+	if (slot == nullptr)
+	{
+		slot = AddSlot(key);
+		if (slot == nullptr)
+		{
+			m_overflows++;
+			return;
+		}
+		isNew = true;
+		m_arrivals++;
+		slot->stats.firstSeenNs = m_pollNs;
+	}
+	StationStats& st = slot->stats;
+	slot->generation = m_generation;
+	st.lastPollNs = m_pollNs;
+	st.polls++;
+	// Connected time went backwards: it reassociated between two polls
+	// and the driver restarted all of its counters.
+	bool restarted = false;
+	if (tb_sta[NL80211_STA_INFO_CONNECTED_TIME])
+	{
+		uint32_t connectedSec = nla_get_u32(tb_sta[NL80211_STA_INFO_CONNECTED_TIME]);
+		restarted = !isNew && connectedSec < st.connectedSec;
+		st.connectedSec = connectedSec;
+	}
+	if (tb_sta[NL80211_STA_INFO_INACTIVE_TIME])
+	{
+		st.inactiveMs = nla_get_u32(tb_sta[NL80211_STA_INFO_INACTIVE_TIME]);
+	}
+
+	uint64_t rxBytes = st.rxBytes;
+	bool rxBytes64 = slot->rxBytes64;
+	if (tb_sta[NL80211_STA_INFO_RX_BYTES64])
+	{
+		rxBytes = nla_get_u64(tb_sta[NL80211_STA_INFO_RX_BYTES64]);
+		rxBytes64 = true;
+	}
+	else if (tb_sta[NL80211_STA_INFO_RX_BYTES])
+	{
+		rxBytes = nla_get_u32(tb_sta[NL80211_STA_INFO_RX_BYTES]);
+		rxBytes64 = false;
+	}
+	uint64_t txBytes = st.txBytes;
+	bool txBytes64 = slot->txBytes64;
+	if (tb_sta[NL80211_STA_INFO_TX_BYTES64])
+	{
+		txBytes = nla_get_u64(tb_sta[NL80211_STA_INFO_TX_BYTES64]);
+		txBytes64 = true;
+	}
+	else if (tb_sta[NL80211_STA_INFO_TX_BYTES])
+	{
+		txBytes = nla_get_u32(tb_sta[NL80211_STA_INFO_TX_BYTES]);
+		txBytes64 = false;
+	}
+	uint32_t rxPackets = tb_sta[NL80211_STA_INFO_RX_PACKETS] ?
+		nla_get_u32(tb_sta[NL80211_STA_INFO_RX_PACKETS]) : st.rxPackets;
+	uint32_t txPackets = tb_sta[NL80211_STA_INFO_TX_PACKETS] ?
+		nla_get_u32(tb_sta[NL80211_STA_INFO_TX_PACKETS]) : st.txPackets;
+	uint32_t txRetries = tb_sta[NL80211_STA_INFO_TX_RETRIES] ?
+		nla_get_u32(tb_sta[NL80211_STA_INFO_TX_RETRIES]) : st.txRetries;
+	uint32_t txFailed = tb_sta[NL80211_STA_INFO_TX_FAILED] ?
+		nla_get_u32(tb_sta[NL80211_STA_INFO_TX_FAILED]) : st.txFailed;
+	uint32_t txBitrate = BitrateKbps(tb_sta[NL80211_STA_INFO_TX_BITRATE]);
+	uint32_t rxBitrate = BitrateKbps(tb_sta[NL80211_STA_INFO_RX_BITRATE]);
+
+	if (isNew)
+	{
+		st.rxBytesDelta = st.txBytesDelta = 0;
+		st.rxPacketsDelta = st.txPacketsDelta = 0;
+		st.txRetriesDelta = st.txFailedDelta = 0;
+		st.signalDelta = 0;
+		st.txBitrateDelta = st.rxBitrateDelta = 0;
+	}
+	else
+	{
+		// 32 bit byte counters wrap within minutes: unsigned subtraction
+		// is right across a wrap, unless the counters were restarted.
+		st.rxBytesDelta = rxBytes64 && slot->rxBytes64 ? Delta64(rxBytes, st.rxBytes, restarted)
+			: restarted ? rxBytes : (uint32_t)(rxBytes - st.rxBytes);
+		st.txBytesDelta = txBytes64 && slot->txBytes64 ? Delta64(txBytes, st.txBytes, restarted)
+			: restarted ? txBytes : (uint32_t)(txBytes - st.txBytes);
+		// (Packet counters take days to wrap: backwards is a restart.)
+		st.rxPacketsDelta = Delta32(rxPackets, st.rxPackets, restarted);
+		st.txPacketsDelta = Delta32(txPackets, st.txPackets, restarted);
+		st.txRetriesDelta = Delta32(txRetries, st.txRetries, restarted);
+		st.txFailedDelta = Delta32(txFailed, st.txFailed, restarted);
+		st.txBitrateDelta = (int64_t)txBitrate - st.txBitrateKbps;
+		st.rxBitrateDelta = (int64_t)rxBitrate - st.rxBitrateKbps;
+	}
+	st.rxBytes = rxBytes;
+	st.txBytes = txBytes;
+	slot->rxBytes64 = rxBytes64;
+	slot->txBytes64 = txBytes64;
+	st.rxPackets = rxPackets;
+	st.txPackets = txPackets;
+	st.txRetries = txRetries;
+	st.txFailed = txFailed;
+	st.txBitrateKbps = txBitrate;
+	st.rxBitrateKbps = rxBitrate;
+
+	if (tb_sta[NL80211_STA_INFO_SIGNAL])
+	{
+		// (u8 on the wire, but dBm: signed)
+		int8_t signal = (int8_t)nla_get_u8(tb_sta[NL80211_STA_INFO_SIGNAL]);
+		st.signalDelta = (!isNew && st.haveSignal) ? signal - st.signalDbm : 0;
+		st.signalDbm = signal;
+		st.haveSignal = true;
+	}
+	else
+	{
+		st.signalDelta = 0;
+	}
+	if (tb_sta[NL80211_STA_INFO_SIGNAL_AVG])
+	{
+		st.signalAvgDbm = (int8_t)nla_get_u8(tb_sta[NL80211_STA_INFO_SIGNAL_AVG]);
+	}
+}
+
+size_t StationPoller::Count()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_count;
+}
+
+void StationPoller::GetStations(vector<StationStats>& stations)
+{
+	stations.clear();
+	lock_guard<mutex> lock(m_mutex);
+	for (const Slot& slot : m_slots)
+	{
+		if (slot.inUse)
+		{
+			stations.push_back(slot.stats);
+		}
+	}
+}
+
+bool StationPoller::GetStation(const uint8_t *mac, StationStats& station)
+{
+	lock_guard<mutex> lock(m_mutex);
+	Slot *slot = FindSlot(PackMac(mac));
+	if (slot == nullptr)
+	{
+		return false;
+	}
+	station = slot->stats;
+	return true;
+}
+
+string StationPoller::Summary()
+{
+	vector<StationStats> stations;
+	GetStations(stations);
+	stringstream s;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		s << "Stations: " << stations.size() << " now, " << m_polls << " polls, "
+			<< m_failedPolls << " failed, " << m_arrivals << " arrived, "
+			<< m_departures << " left";
+		if (m_overflows)
+		{
+			s << ", " << m_overflows << " not tracked (table full)";
+		}
+		s << endl;
+	}
+	for (const StationStats& st : stations)
+	{
+		s << "  " << st.MacString() << ": rx " << st.rxBytesDelta << " B / "
+			<< st.rxPacketsDelta << " pkts, tx " << st.txBytesDelta << " B / "
+			<< st.txPacketsDelta << " pkts, " << st.txRetriesDelta << " retries, "
+			<< st.txFailedDelta << " failed";
+		if (st.haveSignal)
+		{
+			s << ", " << (int)st.signalDbm << " dBm (" << (st.signalDelta >= 0 ? "+" : "")
+				<< st.signalDelta << ")";
+		}
+		s << ", tx " << st.txBitrateKbps / 1000 << "." << (st.txBitrateKbps % 1000) / 100
+			<< " Mbit/s, rx " << st.rxBitrateKbps / 1000 << "." << (st.rxBitrateKbps % 1000) / 100
+			<< " Mbit/s" << endl;
+	}
+	return s.str();
+}
+
+int StationPoller::station_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	StationPoller *poller = (StationPoller *)info->data;
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
+	struct nlattr *tb_sta[NL80211_STA_INFO_MAX + 1];
+
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	if (poller == nullptr || !tb_msg[NL80211_ATTR_MAC] || !tb_msg[NL80211_ATTR_STA_INFO]
+		|| nla_len(tb_msg[NL80211_ATTR_MAC]) < 6)
+	{
+		return NL_SKIP;
+	}
+	if (nla_parse_nested(tb_sta, NL80211_STA_INFO_MAX, tb_msg[NL80211_ATTR_STA_INFO], NULL) != 0)
+	{
+		return NL_SKIP;
+	}
+	poller->Update(tb_sta, (const uint8_t *)nla_data(tb_msg[NL80211_ATTR_MAC]));
+	return NL_SKIP;
+}
@@ -0,0 +1,136 @@
+// StationPoller.h
+// Associated clients of the AP interface (NL80211_CMD_GET_STATION dump):
+// byte / packet / retry counters, signal and bitrates, with the change
+// since the previous poll. Meant to be polled about once a second.
+// Stations live in a fixed array of slots (MaxStations), found by their
+// packed MAC through an open addressing index: the dump is parsed
+// straight into the slots, so a poll does no allocation of its own and
+// costs one netlink round trip plus a few attribute lookups per station.
+// Stations missing from a dump have left and free their slot.
+// Readers (any thread) copy out under a mutex.
+
+#ifndef STATIONPOLLER_H_
+#define STATIONPOLLER_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <cstring>
+
+#include <stdint.h>
+#include <time.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+#include "MacAddress.h"
+
+using namespace std;
+
+// One station: the driver's totals as of the last poll and the change
+// since the poll before (deltas are 0 on a station's first poll).
+class StationStats
+{
+public:
+	uint8_t mac[6];
+	uint64_t key = 0;          // PackMac(mac)
+	int64_t firstSeenNs = 0;   // CLOCK_MONOTONIC, first poll that had it
+	int64_t lastPollNs = 0;
+	uint64_t polls = 0;        // Polls this station was in
+	uint32_t connectedSec = 0;
+	uint32_t inactiveMs = 0;
+	// Totals (0 if the driver doesn't report one):
+	uint64_t rxBytes = 0;
+	uint64_t txBytes = 0;
+	uint32_t rxPackets = 0;
+	uint32_t txPackets = 0;
+	uint32_t txRetries = 0;
+	uint32_t txFailed = 0;
+	bool haveSignal = false;
+	int8_t signalDbm = 0;      // Last PPDU
+	int8_t signalAvgDbm = 0;
+	uint32_t txBitrateKbps = 0;
+	uint32_t rxBitrateKbps = 0;
+	// Since the previous poll:
+	uint64_t rxBytesDelta = 0;
+	uint64_t txBytesDelta = 0;
+	uint32_t rxPacketsDelta = 0;
+	uint32_t txPacketsDelta = 0;
+	uint32_t txRetriesDelta = 0;
+	uint32_t txFailedDelta = 0;
+	int32_t signalDelta = 0;   // dB
+	int64_t txBitrateDelta = 0;
+	int64_t rxBitrateDelta = 0;
+	StationStats()
+	{
+		memset(mac, 0, sizeof(mac));
+	}
+	string MacString() const
+	{
+		return MacToString(mac);
+	}
+};
+
+class StationPoller : public Nl80211Base
+{
+public:
+	// Slots (hostapd's own default is far higher, but a test AP with more
+	// than this is unlikely; the rest are counted in Summary()):
+	static const size_t MaxStations = 128;
+	StationPoller();
+	~StationPoller();
+	// Opens a connection, kept open between polls.
+	bool OpenConnection(const char *interfaceName);
+	bool CloseConnection();
+	// One GET_STATION dump: updates every reported station's slot, frees
+	// the slots of stations that are gone. 'timeNs' 0: now.
+	bool Poll(int64_t timeNs = 0);
+	// Any thread:
+	size_t Count();
+	void GetStations(vector<StationStats>& stations);
+	bool GetStation(const uint8_t *mac, StationStats& station);
+	// Poll counters and one line per station:
+	string Summary();
+	static int station_handler(struct nl_msg *msg, void *arg);
+	static int64_t NowNs();
+private:
+	class Slot
+	{
+	public:
+		bool inUse = false;
+		uint64_t generation = 0;  // Poll that last reported it
+		// Totals came from NL80211_STA_INFO_RX_BYTES64 / TX_BYTES64
+		// (otherwise 32 bit counters, which wrap within minutes):
+		bool rxBytes64 = false;
+		bool txBytes64 = false;
+		StationStats stats;
+	};
+	// (m_mutex held.)
+	Slot *FindSlot(uint64_t key);
+	Slot *AddSlot(uint64_t key);
+	void RebuildIndex();
+	size_t IndexOf(uint64_t key) const;
+	void Update(struct nlattr **tb_sta, const uint8_t *mac);
+	static uint32_t BitrateKbps(struct nlattr *rate);
+	static uint64_t Delta64(uint64_t now, uint64_t last, bool restarted);
+	static uint32_t Delta32(uint32_t now, uint32_t last, bool restarted);
+	bool m_isOpen = false;
+	uint32_t m_interfaceIndex = 0;
+	mutex m_mutex;
+	Slot m_slots[MaxStations];
+	// Open addressing, linear probing: slot number + 1, 0 is empty.
+	// Twice the slots, so probes stay short even when every slot is full.
+	static const size_t IndexSize = 2 * MaxStations;
+	uint16_t m_index[IndexSize];
+	size_t m_count = 0;
+	uint64_t m_generation = 0;
+	int64_t m_pollNs = 0;  // (Time of the poll in progress)
+	uint64_t m_polls = 0;
+	uint64_t m_failedPolls = 0;
+	uint64_t m_arrivals = 0;
+	uint64_t m_departures = 0;
+	uint64_t m_overflows = 0;  // Stations reported with every slot taken
+};
+
+#endif  // STATIONPOLLER_H_
@@ -0,0 +1,302 @@
+// SurveyCollector.cpp
+// NL80211_CMD_GET_SURVEY per dwell, per-channel deltas, see SurveyCollector.h.
+
+#include "SurveyCollector.h"
+
+SurveyCollector::SurveyCollector() : Nl80211Base("SurveyCollector")
+{
+	// (A dual band radio reports about 40 channels.)
+	m_dump.reserve(64);
+}
+
+SurveyCollector::~SurveyCollector()
+{
+	CloseConnection();
+}
+
+bool SurveyCollector::OpenConnection(const char *interfaceName)
+{
+	CloseConnection();
+	if (!Open())
+	{
+		LogErr(AT, "Can't connect to NL80211.");
+		return false;
+	}
+	if (!GetInterfaceIndex(interfaceName, m_interfaceIndex))
+	{
+		Close();
+		return false;
+	}
+	m_isOpen = true;
+	// Baseline: fills 'last' for every channel the driver reports.
+	if (!Dump())
+	{
+		LogErr(AT, string("OpenConnection(): no survey data from ") + interfaceName);
+		CloseConnection();
+		return false;
+	}
+	lock_guard<mutex> lock(m_mutex);
+	for (const SurveyInfo& info : m_dump)
+	{
+		Series *series = FindSeries(info.freq);
+		if (series == nullptr)
+		{
+			series = AddSeries(info.freq);
+		}
+		series->last = info;
+		series->haveLast = true;
+	}
+	return true;
+}
+
+bool SurveyCollector::CloseConnection()
+{
+	if (m_isOpen)
+	{
+		Close();
+		m_isOpen = false;
+	}
+	return true;
+}
+
+// One GET_SURVEY dump for our interface into m_dump.
+bool SurveyCollector::Dump()
+{
+	m_dump.clear();
+	if (!m_isOpen)
+	{
+		LogErr(AT, "Dump(): not open.");
+		return false;
+	}
+	FreeMessage();
+	if (!SetupCallback(survey_handler))
+	{
+		return false;
+	}
+	SetCallbackData(&m_dump);
+	if (!SetupMessage(NLM_F_DUMP, NL80211_CMD_GET_SURVEY)
+		|| !AddMessageParameterU32(NL80211_ATTR_IFINDEX, m_interfaceIndex))
+	{
+		FreeMessage();
+		LogErr(AT, "Dump(): can't build message.");
+		return false;
+	}
+	bool ok = SendWithRepeatingResponses();
+	FreeMessage();
+	SetCallbackData(nullptr);
+	return ok;
+}
+
+bool SurveyCollector::Collect(uint32_t freq, uint64_t hopNumber, int64_t timeNs, SurveySample& sample)
+{
+	bool ok = Dump();
+	lock_guard<mutex> lock(m_mutex);
+	m_dumps++;
+	if (!ok)
+	{
+		m_failedDumps++;
+		return false;
+	}
+	bool haveSample = false;
+	bool reported = false;
+	for (const SurveyInfo& info : m_dump)
+	{
+		Series *series = FindSeries(info.freq);
+		if (series == nullptr)
+		{
+			series = AddSeries(info.freq);
+		}
+		if (info.freq == freq)
+		{
+			reported = true;
+			if (series->haveLast)
+			{
+				SurveySample& s = series->samples[series->written % SeriesSize];
+				s = SurveySample();
+				s.timeNs = timeNs;
+				s.hopNumber = hopNumber;
+				s.haveNoise = info.haveNoise;
+				s.noiseDbm = info.noiseDbm;
+				if (info.haveTime)
+				{
+					s.activeMs = Delta(info.activeMs, series->last.activeMs);
+					s.busyMs = Delta(info.busyMs, series->last.busyMs);
+					s.extBusyMs = Delta(info.extBusyMs, series->last.extBusyMs);
+					s.rxMs = Delta(info.rxMs, series->last.rxMs);
+					s.txMs = Delta(info.txMs, series->last.txMs);
+				}
+				series->written++;
+				sample = s;
+				haveSample = true;
+			}
+		}
+		// (Other channels: counters only move while the radio is on them,
+		// this just keeps the baseline current.)
+		series->last = info;
+		series->haveLast = true;
+	}
+	if (!reported)
+	{
+		m_notReported++;
+	}
+	return haveSample;
+}
+
+// Counters that went backwards were restarted (some drivers clear them
+// on a channel change or interface restart): all of 'now' is new.
+uint32_t SurveyCollector::Delta(uint64_t now, uint64_t last)
+{
+	return (uint32_t)(now >= last ? now - last : now);
+}
+
+SurveyCollector::Series *SurveyCollector::FindSeries(uint32_t freq)
+{
+	for (unique_ptr<Series>& s : m_series)
+	{
+		if (s->freq == freq)
+		{
+			return s.get();
+		}
+	}
+	return nullptr;
+}
+
+// (The only allocation: a channel seen for the first time.)
+SurveyCollector::Series *SurveyCollector::AddSeries(uint32_t freq)
+{
+	unique_ptr<Series> series(new Series());
+	series->freq = freq;
+	m_series.push_back(move(series));
+	return m_series.back().get();
+}
+
+void SurveyCollector::GetFrequencies(vector<uint32_t>& freqs)
+{
+	freqs.clear();
+	lock_guard<mutex> lock(m_mutex);
+	for (unique_ptr<Series>& s : m_series)
+	{
+		freqs.push_back(s->freq);
+	}
+	sort(freqs.begin(), freqs.end());
+}
+
+bool SurveyCollector::GetSeries(uint32_t freq, vector<SurveySample>& samples)
+{
+	samples.clear();
+	lock_guard<mutex> lock(m_mutex);
+	Series *series = FindSeries(freq);
+	if (series == nullptr || series->written == 0)
+	{
+		return false;
+	}
+	uint64_t first = series->written > SeriesSize ? series->written - SeriesSize : 0;
+	for (uint64_t n = first; n < series->written; n++)
+	{
+		samples.push_back(series->samples[n % SeriesSize]);
+	}
+	return true;
+}
+
+bool SurveyCollector::GetLatest(uint32_t freq, SurveySample& sample)
+{
+	lock_guard<mutex> lock(m_mutex);
+	Series *series = FindSeries(freq);
+	if (series == nullptr || series->written == 0)
+	{
+		return false;
+	}
+	sample = series->samples[(series->written - 1) % SeriesSize];
+	return true;
+}
+
+string SurveyCollector::Summary()
+{
+	vector<uint32_t> freqs;
+	GetFrequencies(freqs);
+	stringstream s;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		s << "Survey: " << m_dumps << " dumps, " << m_failedDumps << " failed, "
+			<< m_notReported << " without the hop's channel" << endl;
+	}
+	vector<SurveySample> samples;
+	for (uint32_t freq : freqs)
+	{
+		if (!GetSeries(freq, samples))
+		{
+			continue;
+		}
+		uint64_t active = 0;
+		uint64_t busy = 0;
+		for (const SurveySample& sample : samples)
+		{
+			active += sample.activeMs;
+			busy += sample.busyMs;
+		}
+		const SurveySample& latest = samples.back();
+		s << "  " << freq << " MHz: " << samples.size() << " samples, busy "
+			<< (active ? busy * 100 / active : 0) << "% of " << active << " ms";
+		if (latest.haveNoise)
+		{
+			s << ", noise " << (int)latest.noiseDbm << " dBm";
+		}
+		s << endl;
+	}
+	return s.str();
+}
+
+int SurveyCollector::survey_handler(struct nl_msg *msg, void *arg)
+{
+	// (static)
+	nl80211CallbackInfo* info = (nl80211CallbackInfo *)arg;
+	vector<SurveyInfo> *dump = (vector<SurveyInfo> *)info->data;
+	struct genlmsghdr *gnlh;
+	struct nlattr *tb_msg[NL80211_ATTR_MAX + 1];
+	struct nlattr *tb_survey[NL80211_SURVEY_INFO_MAX + 1];
+
+	gnlh = (genlmsghdr *)nlmsg_data(nlmsg_hdr(msg));
+	nla_parse(tb_msg, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), NULL);
+	if (dump == nullptr || !tb_msg[NL80211_ATTR_SURVEY_INFO])
+	{
+		return NL_SKIP;
+	}
+	if (nla_parse_nested(tb_survey, NL80211_SURVEY_INFO_MAX, tb_msg[NL80211_ATTR_SURVEY_INFO], NULL) != 0
+		|| !tb_survey[NL80211_SURVEY_INFO_FREQUENCY])
+	{
+		return NL_SKIP;
+	}
+	SurveyInfo s;
+	s.freq = nla_get_u32(tb_survey[NL80211_SURVEY_INFO_FREQUENCY]);
+	s.inUse = (tb_survey[NL80211_SURVEY_INFO_IN_USE] != nullptr);
+	if (tb_survey[NL80211_SURVEY_INFO_NOISE])
+	{
+		s.haveNoise = true;
+		// (u8 on the wire, but dBm: signed)
+		s.noiseDbm = (int8_t)nla_get_u8(tb_survey[NL80211_SURVEY_INFO_NOISE]);
+	}
+	// (Were CHANNEL_TIME, CHANNEL_TIME_BUSY, ... on older kernels, same numbers)
+	if (tb_survey[NL80211_SURVEY_INFO_TIME])
+	{
+		s.haveTime = true;
+		s.activeMs = nla_get_u64(tb_survey[NL80211_SURVEY_INFO_TIME]);
+	}
+	if (tb_survey[NL80211_SURVEY_INFO_TIME_BUSY])
+	{
+		s.busyMs = nla_get_u64(tb_survey[NL80211_SURVEY_INFO_TIME_BUSY]);
+	}
+	if (tb_survey[NL80211_SURVEY_INFO_TIME_EXT_BUSY])
+	{
+		s.extBusyMs = nla_get_u64(tb_survey[NL80211_SURVEY_INFO_TIME_EXT_BUSY]);
+	}
+	if (tb_survey[NL80211_SURVEY_INFO_TIME_RX])
+	{
+		s.rxMs = nla_get_u64(tb_survey[NL80211_SURVEY_INFO_TIME_RX]);
+	}
+	if (tb_survey[NL80211_SURVEY_INFO_TIME_TX])
+	{
+		s.txMs = nla_get_u64(tb_survey[NL80211_SURVEY_INFO_TIME_TX]);
+	}
+	dump->push_back(s);
+	return NL_SKIP;
+}
@@ -0,0 +1,117 @@
+// SurveyCollector.h
+// Per-channel survey statistics (NL80211_CMD_GET_SURVEY): noise floor and
+// the radio's channel time counters (active, busy, extension channel busy,
+// RX, TX). Meant to run at the end of each ChannelHopper dwell
+// (SetDwellEndCallback()), while the radio is still on the channel.
+// The driver's counters are cumulative per channel, so each sample is
+// stored as the delta since the previous sample of that same channel, in a
+// fixed size ring per channel: once a channel has been seen, collecting
+// does no allocation. Readers (any thread) copy out under a mutex.
+
+#ifndef SURVEYCOLLECTOR_H_
+#define SURVEYCOLLECTOR_H_
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include <stdint.h>
+
+#include "Log.h"
+#include "Nl80211Base.h"
+
+using namespace std;
+
+// One channel of a GET_SURVEY dump, as the driver reports it.
+// Times are cumulative, milliseconds (0 if the driver doesn't report one).
+class SurveyInfo
+{
+public:
+	uint32_t freq = 0;
+	bool inUse = false;     // The channel the radio is on now
+	bool haveNoise = false;
+	int8_t noiseDbm = 0;
+	bool haveTime = false;  // (Without it the busy / rx / tx times mean nothing)
+	uint64_t activeMs = 0;
+	uint64_t busyMs = 0;
+	uint64_t extBusyMs = 0;
+	uint64_t rxMs = 0;
+	uint64_t txMs = 0;
+};
+
+// One dwell's worth: deltas since the channel's previous sample.
+class SurveySample
+{
+public:
+	int64_t timeNs = 0;      // CLOCK_MONOTONIC, end of the dwell
+	uint64_t hopNumber = 0;  // (ChannelHopper / ChannelTimeline hop #)
+	bool haveNoise = false;
+	int8_t noiseDbm = 0;
+	uint32_t activeMs = 0;
+	uint32_t busyMs = 0;
+	uint32_t extBusyMs = 0;
+	uint32_t rxMs = 0;
+	uint32_t txMs = 0;
+	// Busy time / time on channel, 0..1:
+	double BusyFraction() const
+	{
+		return activeMs ? min(1.0, (double)busyMs / activeMs) : 0.0;
+	}
+};
+
+class SurveyCollector : public Nl80211Base
+{
+public:
+	// Samples kept per channel (older ones are overwritten):
+	static const size_t SeriesSize = 64;
+	SurveyCollector();
+	~SurveyCollector();
+	// Opens a connection (kept open, one dump per dwell) and takes a
+	// baseline dump, so a channel's first dwell already has a delta if
+	// the driver reports all channels.
+	bool OpenConnection(const char *interfaceName);
+	bool CloseConnection();
+	// End of a dwell on 'freq': dump the survey and append the channel's
+	// delta (and update the baseline of any other channel reported).
+	// False if the dump failed, the driver didn't report 'freq', or this
+	// is the first time we see it (baseline only).
+	bool Collect(uint32_t freq, uint64_t hopNumber, int64_t timeNs, SurveySample& sample);
+	// Any thread: frequencies seen so far, a channel's samples (oldest
+	// first), its latest one.
+	void GetFrequencies(vector<uint32_t>& freqs);
+	bool GetSeries(uint32_t freq, vector<SurveySample>& samples);
+	bool GetLatest(uint32_t freq, SurveySample& sample);
+	// One line per channel: samples, mean busy, latest noise:
+	string Summary();
+	static int survey_handler(struct nl_msg *msg, void *arg);
+private:
+	class Series
+	{
+	public:
+		uint32_t freq = 0;
+		bool haveLast = false;
+		SurveyInfo last;      // Counters at the previous sample
+		uint64_t written = 0; // Samples appended (ring index = written % SeriesSize)
+		SurveySample samples[SeriesSize];
+	};
+	bool Dump();
+	// (m_mutex held.)
+	Series *FindSeries(uint32_t freq);
+	Series *AddSeries(uint32_t freq);
+	static uint32_t Delta(uint64_t now, uint64_t last);
+	bool m_isOpen = false;
+	uint32_t m_interfaceIndex = 0;
+	// Last dump (capacity kept between dumps; hop thread only):
+	vector<SurveyInfo> m_dump;
+	mutex m_mutex;
+	vector<unique_ptr<Series>> m_series;
+	uint64_t m_dumps = 0;
+	uint64_t m_failedDumps = 0;
+	uint64_t m_notReported = 0;
+};
+
+#endif  // SURVEYCOLLECTOR_H_
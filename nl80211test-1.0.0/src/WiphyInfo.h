@@ -0,0 +1,118 @@
+// WiphyInfo.h
+// What nl80211 tells us about a radio's channels (NL80211_CMD_GET_WIPHY,
+// per-frequency flags), which interfaces it can run side by side (also
+// GET_WIPHY) and the regulatory domain (NL80211_CMD_GET_REG).
+
+#ifndef WIPHYINFO_H_
+#define WIPHYINFO_H_
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <linux/nl80211.h>
+
+#include "ChannelTables.h"
+
+using namespace std;
+
+class WiphyChannel
+{
+public:
+	uint32_t freq = 0;          // MHz
+	bool known = false;         // In ChannelTables (band / channel are valid)
+	Band band = Band::Band2GHz;
+	uint32_t channel = 0;
+	bool disabled = false;      // NL80211_FREQUENCY_ATTR_DISABLED
+	bool noIr = false;          // NL80211_FREQUENCY_ATTR_NO_IR (passive only)
+	bool radar = false;         // NL80211_FREQUENCY_ATTR_RADAR (DFS)
+	uint32_t maxTxPowerMbm = 0; // NL80211_FREQUENCY_ATTR_MAX_TX_POWER
+};
+
+class RegRule
+{
+public:
+	uint32_t startKhz = 0;      // NL80211_ATTR_FREQ_RANGE_START
+	uint32_t endKhz = 0;        // NL80211_ATTR_FREQ_RANGE_END
+	uint32_t maxBwKhz = 0;      // NL80211_ATTR_FREQ_RANGE_MAX_BW
+	uint32_t flags = 0;         // NL80211_ATTR_REG_RULE_FLAGS (enum nl80211_reg_rule_flags)
+	uint32_t maxEirpMbm = 0;    // NL80211_ATTR_POWER_RULE_MAX_EIRP
+	// A rule no 20 MHz channel may use. linux/nl80211.h has no "disabled"
+	// rule flag: a range is off limits when no rule covers it, or when
+	// its rule is too narrow for a 20 MHz channel (the kernel's
+	// freq_reg_info() then disables the channel). Not for
+	// NL80211_RRF_AUTO_BW, whose maximum comes from the neighbouring rules:
+	bool Disabled() const
+	{
+		return !(flags & NL80211_RRF_AUTO_BW) && maxBwKhz < 20000;
+	}
+	// Whole 20 MHz channel centered on 'freq' inside this rule?
+	bool Covers(uint32_t freq) const
+	{
+		return (freq - 10) * 1000 >= startKhz && (freq + 10) * 1000 <= endKhz;
+	}
+};
+
+class RegDomain
+{
+public:
+	string alpha2;              // "00" = world, "US", ...
+	vector<RegRule> rules;
+	// (Disabled rules allow nothing, see RegRule::Disabled().)
+	bool Allows(uint32_t freq) const
+	{
+		for (const RegRule& r : rules)
+		{
+			if (!r.Disabled() && r.Covers(freq))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+// Interface types are enum nl80211_iftype; sets of them are bit masks
+// (1 << NL80211_IFTYPE_AP | ...).
+
+// At most 'max' interfaces whose types are all in 'types':
+class IfaceLimit
+{
+public:
+	uint32_t max = 0;           // NL80211_IFACE_LIMIT_MAX
+	uint32_t types = 0;         // NL80211_IFACE_LIMIT_TYPES
+};
+
+// One set of interfaces the radio can run at the same time
+// (NL80211_ATTR_INTERFACE_COMBINATIONS entry):
+class IfaceCombination
+{
+public:
+	vector<IfaceLimit> limits;
+	uint32_t maxInterfaces = 0; // NL80211_IFACE_COMB_MAXNUM (all types together)
+	uint32_t numChannels = 0;   // NL80211_IFACE_COMB_NUM_CHANNELS (different channels)
+	bool staApBeaconMatch = false;  // NL80211_IFACE_COMB_STA_AP_BI_MATCH
+	uint32_t radarDetectWidths = 0; // NL80211_IFACE_COMB_RADAR_DETECT_WIDTHS
+};
+
+class WiphyCapabilities
+{
+public:
+	uint32_t phy = 0;
+	uint32_t supportedTypes = 0;    // NL80211_ATTR_SUPPORTED_IFTYPES
+	// NL80211_ATTR_SOFTWARE_IFTYPES: need no hardware resources and
+	// aren't counted in the combinations (mac80211: monitor, AP VLAN):
+	uint32_t softwareTypes = 0;
+	// Empty: only one (non software) interface at a time.
+	vector<IfaceCombination> combinations;
+	bool Supports(uint32_t iftype) const
+	{
+		return (supportedTypes & (1u << iftype)) != 0;
+	}
+	bool IsSoftware(uint32_t iftype) const
+	{
+		return (softwareTypes & (1u << iftype)) != 0;
+	}
+};
+
+#endif  // WIPHYINFO_H_
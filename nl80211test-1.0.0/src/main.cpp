@@ -31,6 +31,9 @@ Need InterfaceManagerNl80211 (SINGLETON, created by main(),
 -  MAC addresses to ignore for survey
 - Init() get list of physical devices, ensures that we have TWO (not one,
    three is right out...)
+   (Started with --sweep-stale-vifs, as the daemon is, main() calls
+   SetSweepStaleInterfaces(true) first: VIFs a crashed earlier run left
+   are deleted. Without it, Init() leaves them alone.)
 -- CreateInterfaces(): Create virtual interfaces (VIFs)
     "sta0" and "ap0" for the TI (built-in) chip and
     "mon0" MONITOR VIF for the USB radio,
@@ -62,6 +65,8 @@ http://elixir.free-electrons.com/linux/latest/source/include/uapi/linux/nl80211.
 #include <chrono>
 #include <ctime>
 #include <thread>
+#include <map>
+#include <mutex>
 
 using namespace std;
 using namespace chrono;
@@ -76,6 +81,20 @@ using namespace chrono;
 #include "Terminator.h"
 #include "HostapdManager.h"
 #include "ChannelSetterNl80211.h"
+#include "ChannelHopper.h"
+#include "HopPlanBuilder.h"
+#include "HopCoordinator.h"
+#include "SettleMeter.h"
+#include "ChannelSetterProbe.h"
+#include "SurveyCollector.h"
+#include "ScanEngine.h"
+#include "Nl80211EventListener.h"
+#include "MacAddress.h"
+#include "StationPoller.h"
+#include "CqmMonitor.h"
+#include "ApClientRegistry.h"
+#include "InterfaceComboSolver.h"
+#include "Nl80211VifOwner.h"
 #include "TextColor.h"
 
 void wait(const char *msg)
@@ -222,11 +241,21 @@ void SetAnInterfacesMode(InterfaceManagerNl80211 *im)
 			cout << "Unknown value..." << endl;
 			return;
 	}
+	MonitorOptions options;
+	if (type == InterfaceType::Monitor)
+	{
+		cout << "Monitor flags:" << endl << "1: Kernel default" << endl
+			<< "2. Survey (no control / bad FCS frames)" << endl << "3. Everything" << endl << "? ";
+		getline(cin, in);
+		options = MonitorOptions::Preset(in[0] == '2' ? MonitorPreset::Survey :
+			in[0] == '3' ? MonitorPreset::Everything : MonitorPreset::KernelDefault);
+	}
 	cout << "Interface name? " << endl;
 	getline(cin, iface);
 	cout << "Calling nl80211 function. This can take up to forty seconds, please wait..." << endl;
 	auto startTime = system_clock::now();
-	rv = im->SetInterfaceMode(iface.c_str(), type);
+	rv = (type == InterfaceType::Monitor) ? im->SetInterfaceMode(iface.c_str(), type, options)
+		: im->SetInterfaceMode(iface.c_str(), type);
 	auto doneTime = system_clock::now();
 	auto dur = doneTime - startTime;
 	milliseconds ms = duration_cast<milliseconds>(dur);
@@ -368,6 +397,32 @@ bool RunTerminator()
 	return shutdown;
 }
 
+// SurveyHopPlan(): the monitor radio's valid channels (wiphy flags and
+// regulatory domain, see HopPlanBuilder); 1..13 if they can't be read.
+static void SurveyHopPlan(milliseconds dwell, HopPlan& plan, uint32_t& phy)
+{
+	InterfaceManagerNl80211 *im = InterfaceManagerNl80211::GetInstance();
+	HopPlanBuilder builder;
+	HopPlanOptions options;
+	options.dwell = dwell;
+	if (im->GetInterfacePhy(im->GetMonitorInterfaceName(), phy)
+		&& builder.BuildPlan(phy, options, plan))
+	{
+		cout << "Hop plan: " << plan.Size() << " channels valid on phy" << phy << endl;
+		return;
+	}
+	cout << "Can't read the monitor radio's channels, using 1..13." << endl;
+	plan = HopPlan();
+	for (uint32_t chan = 1; chan <= 13; chan++)
+	{
+		plan.Add(chan, dwell);
+	}
+	string why;
+	plan.Validate(why);
+}
+
+// ChannelChangeTest(): watch each channel change by hand (4 s apart).
+// (Hop latency / rate numbers: use hopbench instead.)
 int ChannelChangeTest()
 {
 	int chan;
@@ -390,13 +445,18 @@ int ChannelChangeTest()
 		return false;
 	}
 	
-	for (chan = 1; chan <= 13; chan++)
+	HopPlan plan;
+	uint32_t phy = 0;
+	SurveyHopPlan(milliseconds(4000), plan, phy);
+	for (const HopEntry& entry : plan.entries)
 	{
-		cout << endl << "Setting to chan: " << chan << "..." << endl;
+		uint32_t seq;
+		chan = entry.channel;
+		cout << endl << "Setting to chan: " << chan << " (" << entry.freq << " MHz)..." << endl;
 		//auto startTime = system_clock::now();
 		time_point<system_clock>startTime = system_clock::now();
 		// rv = cs.SetChannel2(chan);
-    rv = cs.SetChannel(chan);
+    rv = cs.SetChannel(entry, seq);
 		if (!rv)
 		{
 			cout << "SetChannel() failed... Channel Change Test aborted." << endl << endl;
@@ -423,6 +483,476 @@ int ChannelChangeTest()
 	return false;
 }
 
+// ChannelHopperTest(): Same channels as ChannelChangeTest() but run
+// by ChannelHopper (absolute deadlines), 250 ms dwell, for 15 seconds.
+// A regulatory domain change during the test switches the plan.
+// Each dwell ends with a survey dump (channel busy time, noise).
+void ChannelHopperTest()
+{
+	ChannelHopper hopper;
+	HopPlanBuilder builder;  // (after hopper: stops watching first)
+	HopPlan plan;
+	HopStats stats;
+	uint32_t phy = 0;
+	HopPlanOptions options;
+	SurveyHopPlan(options.dwell, plan, phy);
+	// Fastest channel setter backend that works on this radio:
+	ChannelSetterProbe probe;
+	vector<SetterProbeResult> results;
+	SetterBackend backend = SetterBackend::Nl80211SetChannel;
+	const char *monitor = InterfaceManagerNl80211::GetInstance()->GetMonitorInterfaceName();
+	probe.Probe(monitor, plan, 2, results, backend);
+	for (const SetterProbeResult& r : results)
+	{
+		cout << "  " << r.Summary() << endl;
+	}
+	ShowResult("ChannelHopper SetBackend()", hopper.SetBackend(backend));
+	SurveyCollector survey;
+	if (survey.OpenConnection(monitor))
+	{
+		hopper.SetDwellEndCallback([&survey, &hopper](const HopEntry& entry,
+			uint64_t hopNumber, int64_t, int64_t endNs)
+			{
+				SurveySample sample;
+				if (survey.Collect(entry.freq, hopNumber, endNs, sample))
+				{
+					ChannelActivity activity;
+					activity.busyFraction = sample.BusyFraction();
+					hopper.ReportActivity(activity);
+				}
+			});
+	}
+	else
+	{
+		cout << "  (No survey data on " << monitor << ")" << endl;
+	}
+	bool rv = hopper.Start(plan);
+	ShowResult("ChannelHopper Start()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	builder.Watch(phy, options, [&hopper](const HopPlan& newPlan)
+		{
+			hopper.UpdatePlan(newPlan);
+		});
+	for (int i = 0; i < 15; i++)
+	{
+		this_thread::sleep_for(seconds(1));
+		hopper.GetStats(stats);
+		cout << stats.Summary() << endl;
+		// What a capture thread would tag a frame received right now with:
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ChannelAtTime tuned;
+		if (hopper.GetTimeline().Lookup((int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec, tuned))
+		{
+			cout << "  Now: " << (tuned.state == TunedState::OnChannel ? "on channel " : "not on channel ")
+				<< tuned.hop.channel << (tuned.acked ? " (ACKed)" : "") << endl;
+		}
+	}
+	hopper.Stop();
+	hopper.GetStats(stats);
+	cout << "Channel Hopper Test complete: " << stats.Summary() << endl;
+	cout << survey.Summary();
+	vector<HopRecord> failed;
+	hopper.GetFailedHops(failed);
+	for (const HopRecord& r : failed)
+	{
+		cout << "  Failed hop #" << r.hopNumber << ", channel " << r.channel
+			<< ": " << strerror(r.error) << endl;
+	}
+	cout << endl;
+}
+
+// MultiRadioHopTest(): every monitor interface hops its own share of
+// the channels (HopCoordinator) for 15 seconds.
+void MultiRadioHopTest(InterfaceManagerNl80211 *im)
+{
+	HopCoordinator coordinator;
+	vector<string> names;
+	im->GetMonitorInterfaceNames(names);
+	for (const string& name : names)
+	{
+		string s = "HopCoordinator AddRadio(" + name + ")";
+		ShowResult(s.c_str(), coordinator.AddRadio(name.c_str()));
+	}
+	bool rv = coordinator.Start();
+	ShowResult("HopCoordinator Start()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	vector<RadioAssignment> assignments;
+	for (int i = 0; i < 15; i++)
+	{
+		this_thread::sleep_for(seconds(1));
+		coordinator.CheckHealth();
+	}
+	coordinator.Stop();
+	coordinator.GetAssignments(assignments);
+	for (const RadioAssignment& a : assignments)
+	{
+		cout << "  " << a.interfaceName << " (phy" << a.phy << ")"
+			<< (a.healthy ? "" : " FAILED") << ": " << a.plan.Size() << " channels, sweep "
+			<< duration_cast<milliseconds>(a.sweepTime).count() << " ms:";
+		for (const HopEntry& e : a.plan.entries)
+		{
+			cout << " " << e.channel;
+		}
+		cout << endl;
+	}
+	cout << "Multi-Radio Hop Test complete, revisit time "
+		<< duration_cast<milliseconds>(coordinator.GetRevisitTime()).count() << " ms" << endl << endl;
+}
+
+// SettleTimeTest(): how long each monitor radio takes to really be on a
+// new channel (read-back), and the shortest dwell that leaves for the
+// activity-adaptive dwell policy.
+void SettleTimeTest(InterfaceManagerNl80211 *im)
+{
+	vector<string> names;
+	im->GetMonitorInterfaceNames(names);
+	HopPlan plan;
+	uint32_t phy = 0;
+	SurveyHopPlan(milliseconds(100), plan, phy);
+	for (const string& name : names)
+	{
+		SettleMeter meter;
+		string s = "SettleMeter Open(" + name + ")";
+		bool rv = meter.Open(name.c_str());
+		ShowResult(s.c_str(), rv);
+		if (!rv)
+		{
+			continue;
+		}
+		cout << name << " (" << meter.GetDriver() << "): " << plan.Size()
+			<< " channels x 3 rounds..." << endl;
+		meter.MeasureReadBack(plan, 3);
+	}
+	vector<SettleReport> reports;
+	SettleMeter::GetDriverReports(reports);
+	for (const SettleReport& r : reports)
+	{
+		ActivityPolicyConfig config;
+		SettleMeter::ApplyMinDwell(r.driver, config);
+		cout << "  " << r.Summary() << endl
+			<< "  => minimum dwell " << config.minDwell.count() << " ms" << endl;
+	}
+	cout << "Settle Time Test complete..." << endl << endl;
+}
+
+// ScanTest(): two scans on the station interface; the second one only
+// reports what changed since the first.
+void ScanTest(InterfaceManagerNl80211 *im)
+{
+	ScanEngine scanner;
+	scanner.SetChangeHandler([](const vector<BssDelta>& deltas)
+		{
+			for (const BssDelta& d : deltas)
+			{
+				cout << "  " << (d.change == BssChange::Added ? "+ " :
+					d.change == BssChange::Updated ? "* " : "- ")
+					<< d.bss.BssidString() << " " << d.bss.freq << " MHz "
+					<< d.bss.signalMbm / 100 << " dBm [" << d.bss.ssid << "]" << endl;
+			}
+		});
+	const char *sta = im->GetWpaSupplicantInterfaceName();
+	bool rv = scanner.OpenConnection(sta);
+	ShowResult("ScanEngine OpenConnection()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		ScanRequest request;
+		request.ssids.push_back("");  // (Wildcard probe)
+		rv = scanner.Trigger(request) && scanner.Wait(seconds(10));
+		ShowResult("ScanEngine scan", rv);
+	}
+	vector<BssEntry> table;
+	scanner.GetTable(table);
+	BssEntry best;
+	if (!table.empty() && scanner.GetBest(table[0].ssid, best))
+	{
+		cout << "  Best for [" << best.ssid << "]: " << best.BssidString()
+			<< " " << best.signalMbm / 100 << " dBm" << endl;
+	}
+	scanner.CloseConnection();
+	cout << "Scan Test complete, " << table.size() << " BSSs" << endl << endl;
+}
+
+// ProbeRequestTest(): device presence on the AP interface, no monitor
+// mode: probe requests (NL80211_CMD_REGISTER_FRAME) for 15 seconds,
+// counted per transmitter address.
+void ProbeRequestTest(InterfaceManagerNl80211 *im)
+{
+	Nl80211EventListener listener;
+	mutex devicesMutex;
+	map<string, int> devices;  // (address -> probe requests)
+	const char *ap = im->GetApInterfaceName();
+	listener.AddFrameRegistration(ap, MgmtProbeRequest, vector<uint8_t>());
+	listener.AddFrameHandler([&devicesMutex, &devices](const MgmtFrame& frame)
+		{
+			const uint8_t *a = frame.Source();
+			if (a == nullptr)
+			{
+				return;
+			}
+			string s = MacToString(a);
+			lock_guard<mutex> lock(devicesMutex);
+			if (devices[s]++ == 0)
+			{
+				cout << "  New device " << s << " on " << frame.freq << " MHz"
+					<< (frame.haveSignal ? ", " + to_string(frame.signalDbm) + " dBm" : string("")) << endl;
+			}
+		});
+	bool rv = listener.Start();
+	ShowResult("Probe request listener Start()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	this_thread::sleep_for(seconds(15));
+	listener.Stop();
+	lock_guard<mutex> lock(devicesMutex);
+	cout << "Probe Request Test complete, " << devices.size() << " device(s):" << endl;
+	for (const auto& d : devices)
+	{
+		cout << "  " << d.first << ": " << d.second << " probe requests" << endl;
+	}
+	cout << endl;
+}
+
+// StationPollTest(): associated clients of the AP (hostapd running),
+// one GET_STATION dump a second for 10 seconds.
+void StationPollTest(InterfaceManagerNl80211 *im)
+{
+	StationPoller poller;
+	bool rv = poller.OpenConnection(im->GetApInterfaceName());
+	ShowResult("StationPoller OpenConnection()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	steady_clock::time_point next = steady_clock::now();
+	for (int i = 0; i < 10; i++)
+	{
+		steady_clock::time_point start = steady_clock::now();
+		rv = poller.Poll();
+		duration<double, micro> took = steady_clock::now() - start;
+		cout << "  Poll " << i + 1 << ": " << (rv ? "OK" : "failed") << ", "
+			<< poller.Count() << " stations, " << (int)took.count() << " us" << endl;
+		next += seconds(1);
+		this_thread::sleep_until(next);
+	}
+	cout << poller.Summary();
+	poller.CloseConnection();
+	cout << "Station Poll Test complete..." << endl << endl;
+}
+
+// CqmTest(): link quality events on the station interface (associated,
+// wpa_supplicant running) for 30 seconds; walk away from the AP.
+void CqmTest(InterfaceManagerNl80211 *im)
+{
+	CqmMonitor cqm;
+	cqm.SetEventHandler([](const CqmEvent& event)
+		{
+			cout << "  CQM: " << event.Describe() << endl;
+		});
+	bool rv = cqm.OpenConnection(im->GetWpaSupplicantInterfaceName());
+	ShowResult("CqmMonitor OpenConnection()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	CqmConfig config;
+	config.rssiThresholdsDbm.push_back(-70);
+	config.rssiHysteresisDb = 4;
+	rv = cqm.Configure(config);
+	ShowResult("CqmMonitor Configure(-70 dBm, 4 dB)", rv);
+	if (rv)
+	{
+		this_thread::sleep_for(seconds(30));
+	}
+	cout << cqm.Summary() << endl;
+	cqm.CloseConnection();
+	cout << "CQM Test complete..." << endl << endl;
+}
+
+// CqmMessageCheck() helpers: the CQM nest of an encoded SET_CQM.
+static bool ParseCqmMessage(const vector<uint8_t>& msg, struct nlattr **tb_cqm)
+{
+	struct nlmsghdr *hdr = (struct nlmsghdr *)msg.data();
+	struct genlmsghdr *gnlh = (struct genlmsghdr *)nlmsg_data(hdr);
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	if (msg.size() < NLMSG_HDRLEN + GENL_HDRLEN || gnlh->cmd != NL80211_CMD_SET_CQM
+		|| genlmsg_parse(hdr, 0, tb, NL80211_ATTR_MAX, NULL) != 0 || !tb[NL80211_ATTR_CQM])
+	{
+		return false;
+	}
+	return nla_parse_nested(tb_cqm, NL80211_ATTR_CQM_MAX, tb[NL80211_ATTR_CQM], NULL) == 0;
+}
+
+// RSSI settings (one threshold) and nothing else:
+static bool IsCqmRssiMessage(const vector<uint8_t>& msg, int32_t thresholdDbm, uint32_t hysteresisDb)
+{
+	struct nlattr *c[NL80211_ATTR_CQM_MAX + 1];
+	return ParseCqmMessage(msg, c)
+		&& c[NL80211_ATTR_CQM_RSSI_THOLD] && nla_len(c[NL80211_ATTR_CQM_RSSI_THOLD]) == sizeof(int32_t)
+		&& (int32_t)nla_get_u32(c[NL80211_ATTR_CQM_RSSI_THOLD]) == thresholdDbm
+		&& c[NL80211_ATTR_CQM_RSSI_HYST] && nla_get_u32(c[NL80211_ATTR_CQM_RSSI_HYST]) == hysteresisDb
+		&& !c[NL80211_ATTR_CQM_TXE_RATE] && !c[NL80211_ATTR_CQM_TXE_PKTS] && !c[NL80211_ATTR_CQM_TXE_INTVL];
+}
+
+// TX error settings and nothing else:
+static bool IsCqmTxeMessage(const vector<uint8_t>& msg, uint32_t rate, uint32_t packets, uint32_t interval)
+{
+	struct nlattr *c[NL80211_ATTR_CQM_MAX + 1];
+	return ParseCqmMessage(msg, c)
+		&& c[NL80211_ATTR_CQM_TXE_RATE] && nla_get_u32(c[NL80211_ATTR_CQM_TXE_RATE]) == rate
+		&& c[NL80211_ATTR_CQM_TXE_PKTS] && nla_get_u32(c[NL80211_ATTR_CQM_TXE_PKTS]) == packets
+		&& c[NL80211_ATTR_CQM_TXE_INTVL] && nla_get_u32(c[NL80211_ATTR_CQM_TXE_INTVL]) == interval
+		&& !c[NL80211_ATTR_CQM_RSSI_THOLD] && !c[NL80211_ATTR_CQM_RSSI_HYST];
+}
+
+// CqmMessageCheck(): the SET_CQM messages CqmMonitor builds (no radio
+// needed). The kernel only reads the RSSI or the TX error settings of
+// one message, so they must never share one.
+void CqmMessageCheck()
+{
+	CqmMonitor cqm;
+	vector<vector<uint8_t>> m;
+	CqmConfig rssi;
+	rssi.rssiThresholdsDbm.push_back(-70);
+	rssi.rssiHysteresisDb = 4;
+	CqmConfig txe;
+	txe.txeRatePercent = 50;
+	txe.txePackets = 20;
+	txe.txeIntervalSec = 10;
+	CqmConfig both = rssi;
+	both.txeRatePercent = 50;
+	both.txePackets = 20;
+	both.txeIntervalSec = 10;
+	CqmConfig off;
+	ShowResult("RSSI only: one RSSI message",
+		cqm.EncodeConfig(rssi, false, false, m) && m.size() == 1 && IsCqmRssiMessage(m[0], -70, 4));
+	ShowResult("TX errors only: one TXE message, RSSI left alone",
+		cqm.EncodeConfig(txe, false, false, m) && m.size() == 1 && IsCqmTxeMessage(m[0], 50, 20, 10));
+	ShowResult("Both: RSSI message, then TXE message",
+		cqm.EncodeConfig(both, false, false, m) && m.size() == 2
+		&& IsCqmRssiMessage(m[0], -70, 4) && IsCqmTxeMessage(m[1], 50, 20, 10));
+	ShowResult("TX errors only, RSSI was on: RSSI off, TXE message",
+		cqm.EncodeConfig(txe, true, false, m) && m.size() == 2
+		&& IsCqmRssiMessage(m[0], 0, off.rssiHysteresisDb) && IsCqmTxeMessage(m[1], 50, 20, 10));
+	ShowResult("All off (both on): RSSI 0, TXE 0/0/0",
+		cqm.EncodeConfig(off, true, true, m) && m.size() == 2
+		&& IsCqmRssiMessage(m[0], 0, off.rssiHysteresisDb) && IsCqmTxeMessage(m[1], 0, 0, 0));
+	ShowResult("All off (nothing on): no messages",
+		cqm.EncodeConfig(off, false, false, m) && m.empty());
+	cout << "CQM Message Check complete..." << endl << endl;
+}
+
+// ApClientTest(): clients joining / leaving the AP (hostapd running)
+// for 30 seconds, as they happen.
+void ApClientTest(InterfaceManagerNl80211 *im)
+{
+	ApClientRegistry registry;
+	registry.AddSubscriber([](const ApClientEvent& event)
+		{
+			cout << "  " << (event.change == ApClientChange::Joined ? "Joined " :
+				event.change == ApClientChange::Left ? "Left   " : "Failed ")
+				<< event.client.MacString() << endl;
+		});
+	bool rv = registry.OpenConnection(im->GetApInterfaceName());
+	ShowResult("ApClientRegistry OpenConnection()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	cout << "  " << registry.AssociatedCount() << " clients already associated" << endl;
+	this_thread::sleep_for(seconds(30));
+	registry.CloseConnection();
+	cout << registry.Summary();
+	cout << "AP Client Registry Test complete..." << endl << endl;
+}
+
+// InterfaceComboTest(): what each radio says it can run side by side,
+// and where an AP, a station (on a channel of its own) and a monitor
+// interface would go on otherwise empty radios.
+void InterfaceComboTest()
+{
+	Nl80211WiphyReader reader;
+	vector<WiphyCapabilities> caps;
+	bool rv = reader.GetAllWiphyCapabilities(caps);
+	ShowResult("GetAllWiphyCapabilities()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	InterfaceComboSolver solver;
+	for (const WiphyCapabilities& c : caps)
+	{
+		cout << "  " << InterfaceComboSolver::Describe(c) << endl;
+		solver.AddPhy(c, vector<VifRole>());
+	}
+	vector<VifRole> wanted;
+	wanted.push_back(VifRole("ap", InterfaceType::Ap));
+	wanted.push_back(VifRole("sta", InterfaceType::Station, true));
+	wanted.push_back(VifRole("mon", InterfaceType::Monitor));
+	VifSolution solution;
+	if (solver.Solve(wanted, solution))
+	{
+		for (const VifAssignment& a : solution.assignments)
+		{
+			cout << "  " << a.role.name << " -> phy" << a.phy << endl;
+		}
+	}
+	else
+	{
+		cout << "  Not possible: " << solution.reason << endl;
+	}
+	cout << "Interface Combination Test complete..." << endl << endl;
+}
+
+// OwnedVifTest(): a socket owned STA interface on the monitor radio,
+// then close the socket and time how long until the kernel removed it.
+void OwnedVifTest(InterfaceManagerNl80211 *im)
+{
+	const char *name = "wpa9";
+	uint32_t phy;
+	bool rv = im->GetInterfaceList() && im->GetInterfacePhy(im->GetMonitorInterfaceName(), phy);
+	ShowResult("Monitor radio's phy", rv);
+	if (!rv)
+	{
+		return;
+	}
+	Nl80211VifOwner owner;
+	rv = owner.OpenConnection() && owner.CreateOwnedInterface(name, phy, InterfaceType::Station);
+	ShowResult("CreateOwnedInterface()", rv);
+	if (!rv)
+	{
+		return;
+	}
+	cout << "  " << name << ": ifindex " << if_nametoindex(name) << endl;
+	steady_clock::time_point start = steady_clock::now();
+	owner.CloseConnection();
+	while (if_nametoindex(name) != 0 && steady_clock::now() - start < seconds(2))
+	{
+		this_thread::sleep_for(milliseconds(1));
+	}
+	duration<double, milli> took = steady_clock::now() - start;
+	bool gone = (if_nametoindex(name) == 0);
+	cout << "  " << name << (gone ? " gone after " : " still there after ")
+		<< took.count() << " ms" << endl;
+	if (!gone)
+	{
+		im->DeleteInterface(name);
+	}
+	cout << "Socket Owned VIF Test complete..." << endl << endl;
+}
+
 int main(int argc, char* argv[])
 {
 	Log l;
@@ -432,7 +962,31 @@ int main(int argc, char* argv[])
 	//   IInterfaceManager im;  <== A ptr in real use,
 	//   this is a Singleton class; main instantiates
 	_YELLOW("main(): **MUST** run this program as root (sudo)!");
+	// --sweep-stale-vifs: daemon startup, no other instance running
+	// (see SetSweepStaleInterfaces()).
+	// --any-phy-count: test boxes with other than TWO radios; Init()
+	// otherwise insists on exactly two phys.
+	bool sweepStaleVifs = false;
+	bool strictPhyCountCheck = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--sweep-stale-vifs") == 0)
+		{
+			sweepStaleVifs = true;
+		}
+		else if (strcmp(argv[i], "--any-phy-count") == 0)
+		{
+			strictPhyCountCheck = false;
+		}
+		else
+		{
+			cout << "Unknown option: " << argv[i] << endl;
+			cout << "Usage: " << argv[0] << " [--sweep-stale-vifs] [--any-phy-count]" << endl;
+			return 1;
+		}
+	}
 	InterfaceManagerNl80211 *im = InterfaceManagerNl80211::GetInstance();
+	im->SetSweepStaleInterfaces(sweepStaleVifs);
 	cout << "main(): calling Init()..." << endl;
 	// Init() gets all current Wi-Fi interfaces into a list for us.
 	// Init() also calls SetWirelessPowerSaveOff([name]) for every Wi-Fi
@@ -453,7 +1007,7 @@ int main(int argc, char* argv[])
 	//   and this doesn't seem to be a problem anymore, new interfaces
 	//   show up in iwconfig as "Power Management:off"
 	
-	rv = im->Init();
+	rv = im->Init(strictPhyCountCheck);
 	if (!rv)
 	{
 		cout << "main(): Init() failed!" << endl;
@@ -474,7 +1028,18 @@ int main(int argc, char* argv[])
 			"2. Setup Interfaces" << endl <<
 			"3. Start Hostapd" << endl <<
 			"4. Run Channel Change Test" << endl <<
-			"5. Quit" << endl <<
+			"5. Run Channel Hopper Test" << endl <<
+			"6. Run Multi-Radio Hop Test" << endl <<
+			"7. Run Settle Time Test" << endl <<
+			"8. Run Scan Test" << endl <<
+			"9. Run Probe Request Test" << endl <<
+			"a. Run AP Station Poll Test" << endl <<
+			"b. Run Link Quality (CQM) Test" << endl <<
+			"e. Run CQM Message Check (no radio)" << endl <<
+			"r. Run AP Client Registry Test" << endl <<
+			"i. Run Interface Combination Test" << endl <<
+			"o. Run Socket Owned VIF Test" << endl <<
+			"0. Quit" << endl <<
 			"? ";
 		getline(cin, in);
 		switch (in[0])
@@ -493,7 +1058,45 @@ int main(int argc, char* argv[])
 			case 'c':
 				 quit = ChannelChangeTest();
 				 break;
-			case '5':
+			case '5':  // Channel Hopper Test
+			case 'h':
+				ChannelHopperTest();
+				break;
+			case '6':  // Multi-Radio Hop Test
+			case 'm':
+				MultiRadioHopTest(im);
+				break;
+			case '7':  // Settle Time Test
+			case 's':
+				SettleTimeTest(im);
+				break;
+			case '8':  // Scan Test
+			case 'n':
+				ScanTest(im);
+				break;
+			case '9':  // Probe Request Test
+			case 'p':
+				ProbeRequestTest(im);
+				break;
+			case 'a':  // AP Station Poll Test
+				StationPollTest(im);
+				break;
+			case 'b':  // Link Quality (CQM) Test
+				CqmTest(im);
+				break;
+			case 'e':  // CQM Message Check
+				CqmMessageCheck();
+				break;
+			case 'r':  // AP Client Registry Test
+				ApClientTest(im);
+				break;
+			case 'i':  // Interface Combination Test
+				InterfaceComboTest();
+				break;
+			case 'o':  // Socket Owned VIF Test
+				OwnedVifTest(im);
+				break;
+			case '0':
 			case 'q':
 				quit = true;
 				break;